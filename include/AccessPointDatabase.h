@@ -0,0 +1,83 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef ACCESSPOINTDATABASE_H_
+#define ACCESSPOINTDATABASE_H_
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <WifiScan.h>
+
+typedef struct _AccessPointDatabaseStats {
+    uint64_t trainedScans;
+    uint64_t trainedSamples;
+    uint64_t localFixes;
+    uint64_t localFailures;
+    uint64_t evictions;
+    uint64_t accessPoints;
+} AccessPointDatabaseStats;
+
+// Access point positions learned from GPS fixes taken together with a Wi-Fi scan.
+// Every bssid keeps a signal weighted centroid, the observed signal range and the
+// spread of the samples around the centroid. Scans are resolved offline with a
+// weighted centroid of the known access points.
+class AccessPointDatabase {
+public:
+    AccessPointDatabase(const char *path, size_t capacity);
+
+    AccessPointDatabase(const AccessPointDatabase &) = delete;
+
+    AccessPointDatabase &operator=(const AccessPointDatabase &) = delete;
+
+    void train(const WifiScan &scan, double latitude, double longitude, double accuracy);
+
+    // returns the number of known access points used, 0 if the scan can not be resolved;
+    // a fix from fewer than minAccessPoints is not filled in and counts as a failure
+    int locate(const WifiScan &scan, int minAccessPoints, double *latitude, double *longitude, double *accuracy);
+
+    void getStats(AccessPointDatabaseStats *stats);
+
+    bool load();
+
+    // synced to flash before the rename; written gets the bytes written, 0 if clean
+    bool save(size_t *written);
+
+private:
+    struct ApRecord {
+        double latitude;
+        double longitude;
+        double weight;
+        uint32_t lastSeen;      // seconds since epoch
+        uint16_t samples;
+        uint16_t spread;        // meters
+        int8_t minSignal;
+        int8_t maxSignal;
+        std::list<uint64_t>::iterator lru;
+    };
+
+    void evictOldest();
+
+    std::string mPath;
+    size_t mCapacity;
+    bool mDirty;
+    std::unordered_map<uint64_t, ApRecord> mRecords;
+    std::list<uint64_t> mLru;           // most recently seen first
+    AccessPointDatabaseStats mStats;
+};
+
+#endif /* ACCESSPOINTDATABASE_H_ */
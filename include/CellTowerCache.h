@@ -0,0 +1,98 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef CELLTOWERCACHE_H_
+#define CELLTOWERCACHE_H_
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+struct CellTowerKey {
+    uint16_t mcc;
+    uint16_t mnc;
+    uint32_t lac;       // LAC or TAC
+    uint64_t cid;
+
+    bool operator==(const CellTowerKey &other) const {
+        return mcc == other.mcc && mnc == other.mnc && lac == other.lac && cid == other.cid;
+    }
+};
+
+struct CellTowerKeyHash {
+    size_t operator()(const CellTowerKey &key) const {
+        uint64_t hash = ((uint64_t) key.mcc << 48) ^ ((uint64_t) key.mnc << 32) ^ key.lac;
+        return std::hash<uint64_t>()(hash ^ (key.cid * 0x9E3779B97F4A7C15ULL));
+    }
+};
+
+typedef struct _CellTowerCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t expired;
+    uint64_t evictions;
+    uint64_t networkFills;
+    uint64_t gpsFills;
+    uint64_t entries;
+} CellTowerCacheStats;
+
+// Serving cell positions keyed by (MCC, MNC, LAC/TAC, CID). Entries come from the
+// web service answer to a cell only query or are built up from GPS fixes taken
+// while camped on the cell.
+class CellTowerCache {
+public:
+    CellTowerCache(const char *path, size_t capacity, int64_t ttlMs);
+
+    CellTowerCache(const CellTowerCache &) = delete;
+
+    CellTowerCache &operator=(const CellTowerCache &) = delete;
+
+    bool lookup(const CellTowerKey &key, double *latitude, double *longitude, double *accuracy);
+
+    void insertNetworkPosition(const CellTowerKey &key, double latitude, double longitude, double accuracy);
+
+    void addGpsSample(const CellTowerKey &key, double latitude, double longitude, double accuracy);
+
+    void getStats(CellTowerCacheStats *stats);
+
+    bool load();
+
+    // synced to flash before the rename; written gets the bytes written, 0 if clean
+    bool save(size_t *written);
+
+private:
+    struct Entry {
+        double latitude;
+        double longitude;
+        double accuracy;
+        int64_t timestamp;      // ms since epoch
+        int64_t lastUsed;
+        uint32_t samples;       // 0 for a web service position
+    };
+
+    void makeRoom();
+
+    std::string mPath;
+    size_t mCapacity;
+    int64_t mTtlMs;
+    bool mDirty;
+    std::unordered_map<CellTowerKey, Entry, CellTowerKeyHash> mEntries;
+    CellTowerCacheStats mStats;
+};
+
+#endif /* CELLTOWERCACHE_H_ */
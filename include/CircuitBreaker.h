@@ -0,0 +1,85 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef CIRCUITBREAKER_H_
+#define CIRCUITBREAKER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define CIRCUIT_FAILURE_THRESHOLD    5
+#define CIRCUIT_OPEN_MS              30000
+#define CIRCUIT_MAX_OPEN_MS          (10 * 60 * 1000)
+
+typedef struct _CircuitBreakerStats {
+    std::string endpoint;
+    const char *state;
+    unsigned int consecutiveFailures;
+    uint64_t trips;
+    uint64_t rejected;
+    int64_t retryInMs;
+} CircuitBreakerStats;
+
+// Per endpoint breaker. Closed passes requests and counts consecutive
+// failures, after failureThreshold of them it opens and fails requests fast
+// for the open period. Once that is over it is half-open and lets a single
+// probe through: success closes it, failure opens it again for twice as
+// long, up to maxOpenMs.
+class CircuitBreaker {
+public:
+    CircuitBreaker(unsigned int failureThreshold, int64_t openMs, int64_t maxOpenMs);
+
+    // probe is set when the request is the half-open probe
+    bool allowRequest(const std::string &endpoint, int64_t nowUs, bool *probe);
+
+    bool isOpen(const std::string &endpoint, int64_t nowUs) const;
+
+    void recordResult(const std::string &endpoint, bool success, int64_t nowUs);
+
+    // the probe ended without a result, e.g. it was cancelled
+    void cancelProbe(const std::string &endpoint);
+
+    void getStats(std::vector<CircuitBreakerStats> &stats, int64_t nowUs) const;
+
+private:
+    enum State {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    };
+
+    struct Endpoint {
+        State state;
+        unsigned int consecutiveFailures;
+        bool probeInFlight;
+        int64_t openUntil;
+        int64_t openPeriodUs;
+        uint64_t trips;
+        uint64_t rejected;
+    };
+
+    void trip(Endpoint &endpoint, int64_t openPeriodUs, int64_t nowUs);
+
+    unsigned int mFailureThreshold;
+    int64_t mOpenUs;
+    int64_t mMaxOpenUs;
+    std::unordered_map<std::string, Endpoint> mEndpoints;
+};
+
+#endif /* CIRCUITBREAKER_H_ */
@@ -0,0 +1,120 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef DNSRESOLVER_H_
+#define DNSRESOLVER_H_
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glib.h>
+#include <pbnjson.h>
+
+#define DNS_MAX_PARALLEL_LOOKUPS    4
+#define DNS_CACHE_MAX_ENTRIES       64
+#define DNS_MIN_TTL_S               5
+#define DNS_MAX_TTL_S               3600
+#define DNS_HOSTS_TTL_S             300     // names answered by /etc/hosts carry no TTL
+#define DNS_NEGATIVE_TTL_S          30
+#define DNS_FAILURE_TTL_S           5       // server failure, retried soon
+#define DNS_LOOKUP_TIMEOUT_MS       10000
+
+typedef struct _DnsResolverStats {
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t negativeHits;
+    uint64_t misses;
+    uint64_t shared;        // callers that joined a lookup already running
+    uint64_t failures;
+    uint64_t entries;
+} DnsResolverStats;
+
+// Process-wide IPv4 resolver. Lookups run on a small thread pool, so the
+// servers of one caller resolve in parallel and a thread that needs an
+// address only waits for its own. Answers are cached for the TTL of their
+// records, names that do not exist for DNS_NEGATIVE_TTL_S. Callers on the
+// main loop use prefetch and isUnresolvable only, they never block.
+class DnsResolver {
+public:
+    static DnsResolver *getInstance() {
+        static DnsResolver resolver;
+        return &resolver;
+    }
+
+    ~DnsResolver();
+
+    DnsResolver(const DnsResolver &) = delete;
+
+    DnsResolver &operator=(const DnsResolver &) = delete;
+
+    // blocking, from worker threads only
+    bool resolve(const std::string &host, std::vector<struct in_addr> &addresses);
+
+    // starts the lookups of hosts not cached yet, all at once
+    void prefetch(const std::vector<std::string> &hosts);
+
+    // the name is known not to exist right now, without a lookup; server
+    // failures and timeouts do not count, they may pass on the next try
+    bool isUnresolvable(const std::string &host);
+
+    void getStats(DnsResolverStats *stats);
+
+    // the "dns" section of getServiceMetrics, false when out of memory
+    bool appendStats(jvalue_ref parent);
+
+    // asks only this server from now on and drops the cache, NULL goes back
+    // to resolv.conf; for tests
+    void setNameServer(const struct sockaddr_in *server);
+
+    static std::string hostOfUrl(const std::string &url);
+
+private:
+    struct Entry {
+        std::vector<struct in_addr> addresses;
+        int64_t expiresAt;      // monotonic us
+        bool pending;
+        bool missing;           // NXDOMAIN or no A record, not a server failure
+    };
+
+    DnsResolver();
+
+    static void lookupCb(gpointer data, gpointer user_data);
+
+    static bool query(const char *host, const struct sockaddr_in *server, std::vector<struct in_addr> &addresses,
+                      uint32_t *ttl, bool *missing);
+
+    void startLookup(const std::string &host, Entry &entry);
+
+    void lookup(const std::string &host);
+
+    bool isFresh(const Entry &entry, int64_t now) const;
+
+    void evict(int64_t now);
+
+    std::mutex mLock;
+    std::condition_variable mResolved;
+    std::unordered_map<std::string, Entry> mCache;
+    GThreadPool *mPool;
+    DnsResolverStats mStats;
+    struct sockaddr_in mNameServer;
+    bool mHasNameServer;
+};
+
+#endif /* DNSRESOLVER_H_ */
@@ -67,7 +67,7 @@ public:
     static void gpsXtraDownloadRequestCb(void *user_data);
     static void xtraTimeCb(int64_t utcTime, int64_t timeReference, int uncertainty);
     static void xtraDataCb(char *data, int length);
-    static void xtraDataDownloadThread(void *arg);
+    static void xtraDataDownloadTask(void *arg);
     static void geofenceResumeCb(int32_t geofence_id, int32_t status, void *user_data);
     static void geofencePauseCb(int32_t geofence_id, int32_t status, void *user_data);
     static void geofenceRemoveCb(int32_t geofence_id, int32_t status, void *user_data);
@@ -82,6 +82,7 @@ public:
 
 private:
     bool mXtraDefault =false;
+    unsigned int mXtraTaskId = 0;
     NtpClient client;
     DownloadStateEType mDownloadNtpDataStatus ;
 public:
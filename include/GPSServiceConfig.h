@@ -56,6 +56,10 @@ public:
     unsigned long mLgeTlsMode;
     unsigned long mLgeGPSPositionMode;
     char mChipsetID[GPS_MAX_PARAM_STRING];
+    unsigned long mStoreDurabilityMode;
+    unsigned long mStoreMaxWritesPerHour;
+    unsigned long mStoreMaxBytesPerHour;
+    unsigned long mStoreFlushInterval;
 };
 
 #endif /* GPSSERVICECONFIG_H_ */
@@ -0,0 +1,90 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GEOCODEBATCH_H_
+#define GEOCODEBATCH_H_
+
+#include <stddef.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <pbnjson.h>
+#include <luna-service2/lunaservice.h>
+#include <MapServicesInterface.h>
+
+/*
+ * One getGeoCodeBatch or getReverseGeocodeBatch call. Items with the same key
+ * share one request, at most as many requests are out at a time as the
+ * geocoding class of NetworkRequestManager transfers at once. A subscribed
+ * caller gets every item as it is answered and a closing reply, any other
+ * caller one reply with all results in item order.
+ */
+class GeocodeBatch {
+public:
+    typedef std::function<void(GeocodeBatch *)> FinishedCb;
+
+    GeocodeBatch(LSHandle *sh, LSMessage *message, MapServicesInterface *geocoder, bool reverse,
+                 FinishedCb finishedCb);
+
+    ~GeocodeBatch();
+
+    GeocodeBatch(const GeocodeBatch &) = delete;
+
+    GeocodeBatch &operator=(const GeocodeBatch &) = delete;
+
+    // query as built for getGeoCodeLocation or getReverseLocation
+    void addItem(const std::string &query, const std::string &key);
+
+    // finishedCb may run, and the batch be gone, before this returns
+    void start();
+
+    // drops the outstanding requests, no further reply is sent
+    void cancel();
+
+private:
+    struct Request {
+        std::string query;
+        std::vector<size_t> items;
+    };
+
+    void sendNext();
+
+    void handleAnswer(size_t request, const std::string &response, int error);
+
+    void completeRequest(size_t request, const char *response, int errorCode);
+
+    jvalue_ref createItemResult(size_t item, const char *response, int errorCode);
+
+    void reply(jvalue_ref serviceObject);
+
+    void finish();
+
+    LSHandle *mHandle;
+    LSMessage *mMessage;
+    MapServicesInterface *mGeocoder;
+    bool mReverse;
+    bool mStreaming;
+    FinishedCb mFinishedCb;
+    size_t mItems;
+    size_t mNext;
+    size_t mInFlight;
+    size_t mMaxInFlight;
+    std::vector<Request> mRequests;
+    std::unordered_map<std::string, size_t> mRequestIndex;
+    std::vector<jvalue_ref> mResults;   // per item, kept until the single reply
+};
+
+#endif /* GEOCODEBATCH_H_ */
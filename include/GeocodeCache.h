@@ -0,0 +1,105 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef GEOCODECACHE_H_
+#define GEOCODECACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include <pbnjson.h>
+
+#define GEOCODE_CACHE_MAX_ENTRIES       256
+#define GEOCODE_CACHE_MAX_BYTES         (512 * 1024)
+#define GEOCODE_CACHE_MAX_ENTRY_BYTES   (32 * 1024)
+#define GEOCODE_CACHE_TTL_MS            (24 * 60 * 60 * 1000LL)
+#define GEOCODE_CANDIDATE_MIN_PREFIX    2
+#define GEOCODE_CANDIDATES_MAX          10
+
+typedef struct _GeocodeCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t evictions;
+    uint64_t entries;
+    uint64_t bytes;
+    uint64_t candidateLookups;
+    uint64_t candidatesServed;
+} GeocodeCacheStats;
+
+typedef struct _GeocodeCandidate {
+    std::string address;        // normalized
+    std::string response;
+} GeocodeCandidate;
+
+// Forward geocoding answers keyed by the normalized address and the rest of
+// the query. Entries are ordered by address so that the answers for every
+// address starting with what a user has typed so far form one range.
+class GeocodeCache {
+public:
+    static GeocodeCache *getInstance() {
+        static GeocodeCache cache(GEOCODE_CACHE_MAX_ENTRIES, GEOCODE_CACHE_MAX_BYTES);
+        return &cache;
+    }
+
+    GeocodeCache(size_t maxEntries, size_t maxBytes);
+
+    GeocodeCache(const GeocodeCache &) = delete;
+
+    GeocodeCache &operator=(const GeocodeCache &) = delete;
+
+    // NFKC, case folded, '+' and runs of white space turned into one space
+    static std::string normalize(const std::string &text);
+
+    // query as built for getGeoCodeLocation, "address=...&components=...&language=..."
+    static std::string makeKey(const std::string &query);
+
+    bool lookup(const std::string &key, int64_t nowMs, std::string &response);
+
+    void store(const std::string &key, const std::string &response, int64_t nowMs);
+
+    // answers for addresses starting with the address of query, same other parameters
+    size_t findCandidates(const std::string &query, int64_t nowMs, size_t maxResults,
+                          std::vector<GeocodeCandidate> &candidates);
+
+    void getStats(GeocodeCacheStats *stats) const;
+
+    // the "geocodeCache" section of getServiceMetrics, false when out of memory
+    bool appendStats(jvalue_ref parent) const;
+
+private:
+    struct Entry {
+        std::string response;
+        int64_t expiresAt;      // ms since epoch
+        std::list<std::string>::iterator lru;
+    };
+
+    static void splitQuery(const std::string &query, std::string &address, std::string &params);
+
+    void erase(std::map<std::string, Entry>::iterator it);
+
+    size_t mMaxEntries;
+    size_t mMaxBytes;
+    size_t mBytes;
+    std::list<std::string> mLru;            // most recently used first
+    std::map<std::string, Entry> mEntries;  // "<address>\x1f<params>"
+    GeocodeCacheStats mStats;
+};
+
+#endif /* GEOCODECACHE_H_ */
@@ -0,0 +1,65 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#ifndef GEOLOCATIONQUERYBUILDER_H_
+#define GEOLOCATIONQUERYBUILDER_H_
+
+#include <stddef.h>
+#include <glib.h>
+
+// Writes geolocation request bodies straight into a buffer that is kept across
+// queries, with no whitespace and members in the order they are added. The
+// result must equal jvalue_tostring_simple() of the pbnjson query that was built
+// before; tests/GeolocationQueryBuilderTest.cpp compares the two.
+class GeolocationQueryBuilder {
+public:
+    GeolocationQueryBuilder();
+
+    ~GeolocationQueryBuilder();
+
+    GeolocationQueryBuilder(const GeolocationQueryBuilder &) = delete;
+
+    GeolocationQueryBuilder &operator=(const GeolocationQueryBuilder &) = delete;
+
+    void begin();
+
+    // value must already be serialized JSON
+    void appendRawMember(const char *name, const char *value);
+
+    void beginArray(const char *name);
+
+    void appendAccessPoint(const char *macAddress, int signalStrength);
+
+    void endArray();
+
+    bool hasMembers() const { return mMembers > 0; }
+
+    // valid until the next begin()
+    const char *finish();
+
+private:
+    void appendString(const char *value);
+
+    void appendName(const char *name);
+
+    GString *mBuffer;
+    unsigned int mMembers;
+    unsigned int mItems;
+};
+
+#endif /* GEOLOCATIONQUERYBUILDER_H_ */
@@ -0,0 +1,35 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#ifndef GEOLOCATIONRESPONSEPARSER_H_
+#define GEOLOCATIONRESPONSEPARSER_H_
+
+typedef enum {
+    GEO_RESPONSE_OK = 0,
+    GEO_RESPONSE_ERROR_BODY,    // well formed, carries an "error" member
+    GEO_RESPONSE_INCOMPLETE,    // well formed, a position member is missing or not a plain number
+    GEO_RESPONSE_MALFORMED
+} GeoResponseResult;
+
+// Single pass extraction of location.lat, location.lng and accuracy from a geolocation
+// web service reply. The body is validated as JSON on the way, nothing is allocated.
+// Anything other than GEO_RESPONSE_OK should be handed to the full DOM parser.
+GeoResponseResult geolocationResponseExtract(const char *body, double *latitude, double *longitude,
+                                             double *accuracy);
+
+#endif /* GEOLOCATIONRESPONSEPARSER_H_ */
@@ -18,14 +18,58 @@
 #ifndef _GPS_STORED_DATA_H_
 #define _GPS_STORED_DATA_H_
 #include <glib.h>
+#include <pbnjson.h>
 #include <Position.h>
 #include <Location.h>
 
 G_BEGIN_DECLS
 
+/*
+ * How the persisted fixes reach flash
+ *  FSYNC_ALWAYS : every fix is written and fsynced as it arrives
+ *  PERIODIC     : fixes are coalesced in memory and written once per flush interval
+ *  ON_SUSPEND   : fixes stay in memory until suspend or shutdown
+ */
+typedef enum {
+    STORE_DURABILITY_FSYNC_ALWAYS = 0,
+    STORE_DURABILITY_PERIODIC,
+    STORE_DURABILITY_ON_SUSPEND
+} StoreDurabilityMode;
+
+/*
+ * Hourly write budget shared by all position stores, a zero cap means unlimited
+ */
+typedef struct _StoreWritePolicy {
+    StoreDurabilityMode mode;
+    guint maxWritesPerHour;
+    guint64 maxBytesPerHour;
+    guint flushIntervalSec;
+} StoreWritePolicy;
+
+typedef struct _StoreWriteStats {
+    guint64 requestedWrites;    /* fixes handed to set_store_position */
+    guint64 coalescedWrites;    /* fixes replaced in memory before reaching flash */
+    guint64 deferredWrites;     /* flush attempts held back by the budget */
+    guint64 overBudgetWrites;   /* forced flushes done beyond the budget */
+    guint64 failedWrites;
+    guint64 diskWrites;
+    guint64 fsyncCount;
+    guint64 logicalBytes;       /* payload of all requested fixes */
+    guint64 physicalBytes;      /* bytes actually written to flash */
+    guint windowWrites;
+    guint64 windowBytes;
+} StoreWriteStats;
+
+
 void set_store_position(int64_t timestamp, gdouble latitude, gdouble longitude, gdouble altitude, gdouble speed,
                         gdouble direction, gdouble hor_accuracy, gdouble ver_accuracy , const char *path);
 int get_stored_position(Position *position, Accuracy *accuracy, const char *path);
+void set_store_write_policy(const StoreWritePolicy *policy);
+void get_store_write_stats(StoreWriteStats *stats);
+gboolean store_write_allowed(guint64 bytes);
+void store_write_done(guint64 bytes);
+gboolean append_store_write_stats(jvalue_ref parent);
+void flush_stored_positions(void);
 
 G_END_DECLS
 
@@ -0,0 +1,91 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef HTTPCONNECTIONPOOL_H_
+#define HTTPCONNECTIONPOOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <glib.h>
+#include <loc_http.h>
+
+#define HTTP_POOL_MAX_IDLE_PER_HOST    4
+#define HTTP_POOL_IDLE_TIMEOUT_MS      30000
+
+typedef struct _HttpConnectionPoolStats {
+    uint64_t requests;
+    uint64_t reused;
+    uint64_t newTasks;          // created because no idle task was pooled, not TCP or TLS handshakes
+    uint64_t unhealthy;
+    uint64_t expired;
+    uint64_t overflow;
+    uint64_t idleConnections;
+    uint64_t hosts;
+} HttpConnectionPoolStats;
+
+// Keeps finished http tasks per scheme://host[:port] so the next request to
+// the same host runs on the same curl handle and its kept-alive connection
+// instead of a new TCP and TLS handshake. Whether curl still holds that
+// connection is up to curl, the pool counts tasks only. Released tasks are
+// owned by the pool, it destroys them when unhealthy, over the per host limit
+// or idle for longer than the idle timeout.
+class HttpConnectionPool {
+public:
+    HttpConnectionPool(size_t maxIdlePerHost, int64_t idleTimeoutMs);
+
+    ~HttpConnectionPool();
+
+    static std::string hostKey(const std::string &url);
+
+    // the most recently used idle task of host, NULL if there is none
+    HttpReqTask *acquire(const std::string &host);
+
+    void recordNewTask();
+
+    // healthy when the last transfer completed with an http answer
+    void release(const std::string &host, HttpReqTask *task, bool healthy);
+
+    void expire(int64_t nowUs);
+
+    void clear();
+
+    void getStats(HttpConnectionPoolStats *stats) const;
+
+private:
+    struct IdleTask {
+        HttpReqTask *task;
+        int64_t idleSince;
+    };
+
+    static gboolean sweepCallback(gpointer data);
+
+    size_t mMaxIdlePerHost;
+    int64_t mIdleTimeoutUs;
+    guint mSweepTimerId;
+    std::unordered_map<std::string, std::vector<IdleTask>> mIdle;
+    uint64_t mRequests;
+    uint64_t mReused;
+    uint64_t mNewTasks;
+    uint64_t mUnhealthy;
+    uint64_t mExpired;
+    uint64_t mOverflow;
+};
+
+#endif /* HTTPCONNECTIONPOOL_H_ */
@@ -26,6 +26,18 @@ class HttpInterface {
 public:
     virtual void handleResponse(HttpReqTask *task) = 0;
 
+    /*Called instead of handleResponse when the request deadline expires, with httpResponseCode 0.
+      The transfer is already stopped, the task still has to be cleared.*/
+    virtual void handleTimeout(HttpReqTask *task) {
+        handleResponse(task);
+    }
+
+    /*A successful answer to a request sent with a cache lifetime is stored unless the client
+      finds an error in its body.*/
+    virtual bool isCacheable(const HttpReqTask *task) {
+        return true;
+    }
+
 };
 
 #endif
@@ -0,0 +1,89 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef HTTPRESPONSECACHE_H_
+#define HTTPRESPONSECACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#define HTTP_CACHE_MAX_BYTES          (512 * 1024)
+#define HTTP_CACHE_MAX_ENTRY_BYTES    (64 * 1024)
+#define HTTP_CACHE_MAX_STALE_MS       (7 * 24 * 60 * 60 * 1000LL)
+
+typedef struct _HttpResponseCacheStats {
+    uint64_t hits;
+    uint64_t staleHits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t evictions;
+    uint64_t bytes;
+    uint64_t entries;
+} HttpResponseCacheStats;
+
+// Bodies of successful GET responses keyed by the SHA-1 of the URL, so no
+// API key or signature ends up on disk. Each entry is fresh for the
+// lifetime given when it was stored, and may still be served stale in place
+// of a failed request for up to HTTP_CACHE_MAX_STALE_MS. The least recently
+// used entries go first once the byte budget is exceeded. The disk tier is
+// optional, with an empty path the cache lives in memory only.
+class HttpResponseCache {
+public:
+    HttpResponseCache(const char *path, size_t maxBytes);
+
+    HttpResponseCache(const HttpResponseCache &) = delete;
+
+    HttpResponseCache &operator=(const HttpResponseCache &) = delete;
+
+    // fresh entries only unless allowStale
+    bool lookup(const std::string &url, int64_t nowMs, bool allowStale, std::string &body);
+
+    void store(const std::string &url, const char *body, int64_t ttlMs, int64_t nowMs);
+
+    void getStats(HttpResponseCacheStats *stats) const;
+
+    bool load();
+
+    bool save();
+
+private:
+    struct Entry {
+        std::string body;
+        int64_t storedAt;       // ms since epoch
+        int64_t expiresAt;
+        std::list<std::string>::iterator lru;
+    };
+
+    static std::string makeKey(const std::string &url);
+
+    void insert(const std::string &key, const std::string &body, int64_t storedAt, int64_t expiresAt);
+
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+
+    std::string mPath;
+    size_t mMaxBytes;
+    size_t mBytes;
+    bool mDirty;
+    std::list<std::string> mLru;        // most recently used first
+    std::unordered_map<std::string, Entry> mEntries;
+    HttpResponseCacheStats mStats;
+};
+
+#endif /* HTTPRESPONSECACHE_H_ */
@@ -45,6 +45,8 @@
 #define PROP(name, type)                    "\"" #name "\":{\"type\":\"" #type "\"}"
 #define PROP_WITH_OPT(name, type, ...)      "\"" #name "\":{\"type\":\"" #type "\"," #__VA_ARGS__ "}"
 #define ENUM_PROP(name, type, ...)          "\"" #name "\":{\"type\":\"" #type "\",\"enum\":[" #__VA_ARGS__ "]}"
+#define SCHEMA_VALUE_(value)                #value
+#define SCHEMA_VALUE(value)                 SCHEMA_VALUE_(value)    // a macro, expanded first
 #define ARRAY(name, type)                   "\"" #name "\":{\"type\":\"array\", \"items\":{\"type\":\"" #type "\"}}"
 #define OBJSCHEMA_1(param)                  "{\"type\":\"object\",\"properties\":{" param "}}"
 #define OBJSCHEMA_2(p1, p2)                 "{\"type\":\"object\",\"properties\":{" p1 "," p2 "}}"
@@ -0,0 +1,68 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef LASTPOSITIONINDEX_H_
+#define LASTPOSITIONINDEX_H_
+
+#include <mutex>
+#include <vector>
+#include <Position.h>
+#include <Location.h>
+
+enum LastPositionSource {
+    LAST_POSITION_GPS = 0,
+    LAST_POSITION_NETWORK,
+    LAST_POSITION_MOCK,
+    LAST_POSITION_MAX
+};
+
+struct LastPositionCandidate {
+    LastPositionSource source;
+    HandlerTypes handler;       // handler the fix was delivered for
+    Position position;
+    Accuracy accuracy;
+};
+
+// Latest fix of every position source, kept in memory so that cached position
+// queries never touch the stores on flash.
+class LastPositionIndex {
+public:
+    LastPositionIndex();
+
+    LastPositionIndex(const LastPositionIndex &) = delete;
+
+    LastPositionIndex &operator=(const LastPositionIndex &) = delete;
+
+    // load the persisted GPS and network fixes, called once at startup
+    void warmUp();
+
+    void update(LastPositionSource source, HandlerTypes handler, const Position &position, const Accuracy &accuracy);
+
+    // maximumAge in ms and maximumAccuracy in meters, 0 disables the constraint
+    // HANDLER_HYBRID matches fixes of every handler
+    int getCandidates(HandlerTypes handler, long long maximumAge, double maximumAccuracy,
+                      std::vector<LastPositionCandidate> &candidates);
+
+    static const char *getSourceName(LastPositionSource source);
+
+private:
+    std::mutex mLock;
+    bool mValid[LAST_POSITION_MAX];
+    LastPositionCandidate mEntries[LAST_POSITION_MAX];
+};
+
+#endif /* LASTPOSITIONINDEX_H_ */
@@ -26,6 +26,11 @@
 #define INVALID_PARAM -1.0
 #define LOCATION_DB_PREF_PATH_GPS      "/var/location/location_gps.xml"
 #define LOCATION_DB_PREF_PATH_NETWORK  "/var/location/location_network.xml"
+#define LOCATION_WIFI_FINGERPRINT_PATH "/var/location/location_wifi_fingerprint.dat"
+#define LOCATION_AP_DATABASE_PATH      "/var/location/location_ap.db"
+#define LOCATION_CELL_CACHE_PATH       "/var/location/location_cell.dat"
+#define LOCATION_HTTP_CACHE_PATH       "/var/location/location_http_cache.dat"
+#define LOCATION_REVGEO_CACHE_PATH     "/var/location/location_revgeo_cache.dat"
 
 typedef enum {
     HANDLER_NETWORK = 0,
@@ -44,6 +44,8 @@
 #include <PositionProviderInterface.h>
 #include <GPSPositionProvider.h>
 #include <Position.h>
+#include <LastPositionIndex.h>
+#include <GeocodeBatch.h>
 
 #define SHORT_RESPONSE_TIME                 10000
 #define MEDIUM_RESPONSE_TIME                100000
@@ -135,6 +137,7 @@ typedef struct _PositionData {
     char *key2;
     char *retString1;
     char *retString2;
+    int error;
 } PositionData;
 
 class LocationService : public IConnectivityListener,public ILocationCallbacks {
@@ -335,6 +338,7 @@ public:
         }
 
         isInternetConnectionAvailable = state;
+        NetworkRequestManager::getInstance()->setOnline(state);
     }
 
     bool getConnectionManagerState() {
@@ -360,6 +364,7 @@ public:
         if (state == true) {
             LS_LOG_INFO("sleepd suspended\n");
             stopGpsEngine();
+            flush_stored_positions();
         } else {
             LS_LOG_INFO("sleepd resume\n");
             resumeGpsEngine();
@@ -463,6 +468,8 @@ public:
 
     void getLocRequestStopSubscription(LSHandle *sh, LSMessage *message);
 
+    void updateNetworkSubscriberInterval(LSMessage *leaving);
+
     bool LSMessageRemoveReqList(LSMessage *message);
 
     bool removeTimer(LSMessage *message);
@@ -514,6 +521,8 @@ private:
     LocationWebServiceProvider *mLBSProvider;
     NetworkPositionProvider *mNetworkProvider;
     GPSPositionProvider *mGPSProvider;
+    LastPositionIndex mLastPositions;
+    std::unordered_map<std::string, GeocodeBatch *> mGeocodeBatches;     // by unique token of the call
     ConnectionStateObserver * connectionStateObserverObj;
     static const char *geofenceStateText[GEOFENCE_MAXIMUM];
 
@@ -530,6 +539,9 @@ private:
     LOCATION_SERVICE_METHOD(getNmeaData);
     LOCATION_SERVICE_METHOD(getReverseLocation);
     LOCATION_SERVICE_METHOD(getGeoCodeLocation);
+    LOCATION_SERVICE_METHOD(getGeoCodeCandidates);
+    LOCATION_SERVICE_METHOD(getGeoCodeBatch);
+    LOCATION_SERVICE_METHOD(getReverseGeocodeBatch);
     LOCATION_SERVICE_METHOD(getAllLocationHandlers);
     LOCATION_SERVICE_METHOD(getGpsStatus);
     LOCATION_SERVICE_METHOD(setState);
@@ -552,6 +564,7 @@ private:
     LOCATION_SERVICE_METHOD(enableMockLocation);
     LOCATION_SERVICE_METHOD(disableMockLocation);
     LOCATION_SERVICE_METHOD(setMockLocation);
+    LOCATION_SERVICE_METHOD(getServiceMetrics);
 
     gboolean _TimerCallbackLocationUpdate(void *data);
 
@@ -561,6 +574,12 @@ private:
 
     void reverseGeocodingCb(GeoAddress& address, int errCode, LSMessage *message);
 
+    void startGeocodeBatch(LSHandle *sh, LSMessage *message, GeocodeBatch *batch);
+
+    void geocodeBatchFinished(GeocodeBatch *batch);
+
+    bool cancelGeocodeBatch(LSMessage *message);
+
     void geofence_add_reply(int32_t geofence_id, int32_t status);
 
     void geofence_breach_reply(int32_t geofence_id, int32_t status, int64_t timestamp, double latitude,
@@ -580,10 +599,13 @@ private:
 
     int getHandlerVal(char *handlerName);
 
-    Position comparePositionTimeStamps(Position pos1, Position pos2, Accuracy acc1, Accuracy acc2, Accuracy *retAcc);
+    Position comparePositionTimeStamps(const Position &pos1, const Position &pos2, const Accuracy &acc1,
+                                       const Accuracy &acc2, Accuracy *retAcc);
 
     void getReverseGeocodeData(jvalue_ref *parsedObj, GString **pos_data, Position *pos);
 
+    void appendReverseGeocodeParams(jvalue_ref *parsedObj, GString *posData);
+
     void getGeocodeData(jvalue_ref *parsedObj, GString *addressData);
 
     void printMessageDetails(const char *usage, LSMessage *msg, LSHandle *sh);
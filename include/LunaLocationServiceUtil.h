@@ -80,6 +80,53 @@
             PROP(region, string)\
         ))
 
+/*
+ * result_type and location_type filters of getReverseLocation and getReverseGeocodeBatch
+ */
+#define PROP_REVERSE_RESULT_TYPE                            \
+        STRICT_ENUM_ARRAY(result_type, string, \
+            "street_address", \
+            "route", \
+            "intersection", \
+            "political", \
+            "country", \
+            "administrative_area_level_1", \
+            "administrative_area_level_2", \
+            "administrative_area_level_3", \
+            "administrative_area_level_4", \
+            "administrative_area_level_5", \
+            "colloquial_area", \
+            "locality", \
+            "ward", \
+            "sublocality", \
+            "neighborhood", \
+            "premise", \
+            "subpremise", \
+            "postal_code", \
+            "natural_feature", \
+            "airport", \
+            "park", \
+            "point_of_interest", \
+            "floor", \
+            "establishment", \
+            "parking", \
+            "post_box", \
+            "postal_town", \
+            "room", \
+            "street_number", \
+            "bus_station", \
+            "train_station", \
+            "transit_station"\
+        )
+
+#define PROP_REVERSE_LOCATION_TYPE                          \
+        STRICT_ENUM_ARRAY(location_type, string, \
+            "ROOFTOP", \
+            "RANGE_INTERPOLATED", \
+            "GEOMETRIC_CENTER", \
+            "APPROXIMATE"\
+        )
+
 /*
 * JSON SCHEMA: getReverseLocation
 */
@@ -88,49 +135,46 @@
             PROP_WITH_OPT(latitude, number, "minimum":-90, "maximum":90), \
             PROP_WITH_OPT(longitude, number, "minimum":-180, "maximum":180), \
             PROP(language, string), \
-            STRICT_ENUM_ARRAY(result_type, string, \
-                "street_address", \
-                "route", \
-                "intersection", \
-                "political", \
-                "country", \
-                "administrative_area_level_1", \
-                "administrative_area_level_2", \
-                "administrative_area_level_3", \
-                "administrative_area_level_4", \
-                "administrative_area_level_5", \
-                "colloquial_area", \
-                "locality", \
-                "ward", \
-                "sublocality", \
-                "neighborhood", \
-                "premise", \
-                "subpremise", \
-                "postal_code", \
-                "natural_feature", \
-                "airport", \
-                "park", \
-                "point_of_interest", \
-                "floor", \
-                "establishment", \
-                "parking", \
-                "post_box", \
-                "postal_town", \
-                "room", \
-                "street_number", \
-                "bus_station", \
-                "train_station", \
-                "transit_station"\
-            ), \
-            STRICT_ENUM_ARRAY(location_type, string, \
-                "ROOFTOP", \
-                "RANGE_INTERPOLATED", \
-                "GEOMETRIC_CENTER", \
-                "APPROXIMATE"\
-            )\
+            PROP_REVERSE_RESULT_TYPE, \
+            PROP_REVERSE_LOCATION_TYPE\
         ) \
         REQUIRED_2(latitude, longitude))
 
+#define GEOCODE_BATCH_MAX_ITEMS                             50
+
+/*
+ * JSON SCHEMA: getGeoCodeBatch (string addresses[], [string language], [string region], [bool subscribe])
+ */
+#define JSCHEMA_GET_GEOCODE_BATCH                           STRICT_SCHEMA(\
+        PROPS_4(\
+            "\"addresses\":{\"type\":\"array\", \"items\":{\"type\":\"string\"}, \"minItems\":1, \"maxItems\":" SCHEMA_VALUE(GEOCODE_BATCH_MAX_ITEMS) "}", \
+            PROP(language, string), \
+            PROP(region, string), \
+            PROP(subscribe, boolean)\
+        ) \
+        REQUIRED_1(addresses))
+
+/*
+ * JSON SCHEMA: getReverseGeocodeBatch (object locations[] {double latitude, double longitude},
+ *                                      [string language], [string result_type[]],
+ *                                      [string location_type[]], [bool subscribe])
+ */
+#define JSCHEMA_GET_REVERSE_GEOCODE_BATCH                   STRICT_SCHEMA(\
+        PROPS_5(\
+            "\"locations\":{\"type\":\"array\", \"items\":" STRICT_SCHEMA(\
+                PROPS_2(\
+                    PROP_WITH_OPT(latitude, number, "minimum":-90, "maximum":90), \
+                    PROP_WITH_OPT(longitude, number, "minimum":-180, "maximum":180)\
+                ) \
+                REQUIRED_2(latitude, longitude)\
+            ) ", \"minItems\":1, \"maxItems\":" SCHEMA_VALUE(GEOCODE_BATCH_MAX_ITEMS) "}", \
+            PROP(language, string), \
+            PROP_REVERSE_RESULT_TYPE, \
+            PROP_REVERSE_LOCATION_TYPE, \
+            PROP(subscribe, boolean)\
+        ) \
+        REQUIRED_1(locations))
+
 /*
  * JSON SCHEMA: getGpsSatelliteData ([bool subscribe])
  */
@@ -255,14 +299,35 @@
 
 
 /*
- * JSON SCHEMA: getCachedPosition ([integer maximumAge], [string Handler])
+ * JSON SCHEMA: getCachedPosition ([integer maximumAge], [string Handler],
+ *                                 [number maximumAccuracy], [bool allCandidates])
  */
 
 
 #define JSCHEMA_GET_CACHED_POSITION                         STRICT_SCHEMA(\
-        PROPS_2(\
+        PROPS_4(\
             PROP_WITH_OPT(maximumAge, integer, "minimum":0, "exclusiveMinimum": true), \
-            ENUM_PROP(Handler, string, "gps", "network", "passive")))
+            ENUM_PROP(Handler, string, "gps", "network", "passive"), \
+            PROP_WITH_OPT(maximumAccuracy, number, "minimum":0, "exclusiveMinimum": true), \
+            PROP(allCandidates, boolean)))
+
+/*
+ * JSON SCHEMA: getGeoCodeCandidates (string address, [string language], [string region],
+ *                                    [integer maxResults])
+ */
+#define JSCHEMA_GET_GEOCODE_CANDIDATES                      STRICT_SCHEMA(\
+        PROPS_4(\
+            PROP(address, string), \
+            PROP(language, string), \
+            PROP(region, string), \
+            PROP_WITH_OPT(maxResults, integer, "minimum":1, "maximum":10)\
+        ) \
+        REQUIRED_1(address))
+
+/*
+ * JSON SCHEMA: getServiceMetrics ()
+ */
+#define JSCHEMA_GET_SERVICE_METRICS                         SCHEMA_NONE
 
 
 bool LSMessageInitErrorReply();
@@ -271,6 +336,8 @@ void LSMessageReleaseErrorReply();
 
 char *LSMessageGetErrorReply(int errorCode);
 
+const char *LSMessageGetErrorText(int errorCode);
+
 void LSMessageReplyError(LSHandle *sh, LSMessage *message, int errorCode);
 void LSMessageReplyCustomError(LSHandle *sh, LSMessage *message, int errorCode);
 bool LSMessageReplySubscriptionSuccess(LSHandle *sh, LSMessage *message);
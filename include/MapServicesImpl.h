@@ -20,6 +20,8 @@
 
 
 #include <memory>
+#include <list>
+#include <unordered_map>
 #include <algorithm>
 #include <string.h>
 #include <loc_http.h>
@@ -27,6 +29,8 @@
 #include <HttpInterface.h>
 #include <MapServicesInterface.h>
 #include <NetworkRequestManager.h>
+#include <GeocodeCache.h>
+#include <ReverseGeocodeCache.h>
 #include <loc_log.h>
 
 #define STRINGIFY(x) #x
@@ -42,13 +46,49 @@ public:
 
     virtual ~MapServicesImpl();
 
-    ErrorCodes geoCode(GeoAddress& address, GeoCodeCb geocodeCallback, bool isSync, LSMessage *message);
+    ErrorCodes geoCode(GeoAddress& address, GeoCodeCb geocodeCallback, bool isSync, LSMessage *message,
+                       unsigned int timeoutMs = GEOCODE_TIMEOUT_MS);
     ErrorCodes reverseGeoCode(GeoLocation& geolocation, ReverseGeoCodeCb revGeocodeCallback, bool isSync,
-                              LSMessage *message);
+                              LSMessage *message, unsigned int timeoutMs = GEOCODE_TIMEOUT_MS);
+    bool cancelRequest(LSMessage *message);
 
-    ErrorCodes lbsPostQuery(std::string url, bool isSync, LSMessage *message);
-    std::string formatUrl(std::string address, std::string url, const char *key);
+    std::string formatUrl(const std::string &geoData, const std::string &url);
     void handleResponse(HttpReqTask *task);
+    void handleTimeout(HttpReqTask *task);
+    bool isCacheable(const HttpReqTask *task);
+
+private:
+    // everything needed to answer one request, kept until it is answered or cancelled
+    struct GeocodeRequest {
+        GeoCodeCb geoCodeCb;
+        ReverseGeoCodeCb revGeoCodeCb;
+        LSMessage *message;
+        std::string key;        // in GeocodeCache or ReverseGeocodeCache, empty if not cached
+        int64_t startTime;      // monotonic us
+        bool reverse;
+    };
+
+    struct CachedAnswer {
+        MapServicesImpl *impl;
+        GeocodeRequest request;
+        std::string response;
+        guint sourceId;
+    };
+
+    void answer(HttpReqTask *task, bool timedOut);
+
+    ErrorCodes lbsPostQuery(const std::string &url, bool isSync, const GeocodeRequest &request,
+                            unsigned int timeoutMs);
+
+    ErrorCodes deliverCachedAnswer(const GeocodeRequest &request, const std::string &response);
+
+    static gboolean deliverCachedAnswerCb(gpointer data);
+
+    static void deliver(const GeocodeRequest &request, const char *response, int error);
+
+    std::unordered_map<HttpReqTask *, GeocodeRequest> mRequests;
+    std::list<CachedAnswer *> mCachedAnswers;
+    const GeocodeRequest *mSyncRequest;     // answered inside initiateTransaction, before its task is known
 };
 
 #endif  //H_MapServicesImpl
@@ -30,6 +30,8 @@
 typedef std::function<void(GeoLocation&, int, LSMessage *)> GeoCodeCb;
 typedef std::function<void(GeoAddress&, int, LSMessage *)> ReverseGeoCodeCb;
 
+#define GEOCODE_TIMEOUT_MS      15000   // default deadline of one request, network included
+
 class MapServicesInterface {
 public:
 
@@ -39,21 +41,24 @@ public:
     virtual ~MapServicesInterface() {
     }
 
-    virtual ErrorCodes geoCode(GeoAddress& address, GeoCodeCb geocodeCallback, bool isSync, LSMessage *message) {
+    /*The callback is kept with the request, any number of requests can be in flight.*/
+    virtual ErrorCodes geoCode(GeoAddress& address, GeoCodeCb geocodeCallback, bool isSync, LSMessage *message,
+                               unsigned int timeoutMs = GEOCODE_TIMEOUT_MS) {
         LS_LOG_ERROR("No support for geocode");
         return ERROR_NOT_IMPLEMENTED;
     }
 
     virtual ErrorCodes reverseGeoCode(GeoLocation& geolocation, ReverseGeoCodeCb revGecodeCallback, bool isSync,
-                                      LSMessage *message) {
+                                      LSMessage *message, unsigned int timeoutMs = GEOCODE_TIMEOUT_MS) {
         LS_LOG_ERROR("No support for reverseGeoCode");
         return ERROR_NOT_IMPLEMENTED;
     }
 
-public:
-
-    GeoCodeCb mGeoCodeCb = nullptr;
-    ReverseGeoCodeCb mRevGeoCodeCb = nullptr;
+    /*Drops the requests made for message without calling their callbacks, true if there were any.
+      The caller then owns the reply to message.*/
+    virtual bool cancelRequest(LSMessage *message) {
+        return false;
+    }
 
 };
 
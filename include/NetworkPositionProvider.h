@@ -33,6 +33,13 @@
 #include <NetworkRequestManager.h>
 #include <PositionProviderInterface.h>
 #include <IConnectivityListener.h>
+#include <WifiScan.h>
+#include <WifiFingerprintCache.h>
+#include <AccessPointDatabase.h>
+#include <CellTowerCache.h>
+#include <NetworkScanScheduler.h>
+#include <GeolocationQueryBuilder.h>
+#include <PositioningBackends.h>
 
 class NetworkDataClient;
 
@@ -44,8 +51,7 @@ typedef struct NetworkPositionData {
     double lastLongitude;
     double lastAccuracy;
     request_state_cellid_type requestState;
-    GHashTable *wifiAccessPointsList;
-    GHashTable *lastAps;
+    WifiScan lastAps;       // scan of the last posted wifi query
     int64_t lastTimeStamp;
 
     NetworkPositionData() {
@@ -53,23 +59,15 @@ typedef struct NetworkPositionData {
         lastLongitude = 0;
         lastAccuracy = 0;
         lastTimeStamp = 0;
-        lastAps = NULL;
         cellInfo = NULL;
         curCellid = 0;
         nwGeolocationKey = NULL;
         requestState = REQUEST_NONE;
-        wifiAccessPointsList = NULL;
     }
 
     ~NetworkPositionData() {
         delete nwGeolocationKey;
         delete cellInfo;
-
-        if (lastAps)
-            g_hash_table_destroy(lastAps);
-
-        if (wifiAccessPointsList)
-            g_hash_table_destroy(wifiAccessPointsList);
     }
 
     void resetData() {
@@ -78,15 +76,7 @@ typedef struct NetworkPositionData {
         lastAccuracy = 0;
         lastTimeStamp = 0;
 
-        if (lastAps) {
-            g_hash_table_destroy(lastAps);
-            lastAps = NULL;
-        }
-
-        if (wifiAccessPointsList) {
-            g_hash_table_destroy(wifiAccessPointsList);
-            wifiAccessPointsList = NULL;
-        }
+        lastAps.clear();
 
         if (cellInfo) {
             g_free(cellInfo);
@@ -109,7 +99,7 @@ public:
 
     NetworkPositionProvider(LSHandle *sh);
 
-    ~NetworkPositionProvider() { }
+    ~NetworkPositionProvider();
 
     void enable();
 
@@ -129,6 +119,18 @@ public:
 
     void Handle_SuspendedNotification(bool status);
 
+    // the network positioning sections of getServiceMetrics, false when out of memory
+    bool appendStats(jvalue_ref parent);
+
+    void setSubscriberInterval(int intervalMs);
+
+    // main loop only; true if the GPS fix should be sent to network subscribers,
+    // network scanning and queries are paused while this holds
+    bool feedFromGpsFix(int64_t timestamp, double accuracy);
+
+    // may be called from any thread, training is done on the main loop
+    void trainFromGpsFix(double latitude, double longitude, double accuracy, double speed);
+
 private:
 
     static bool serviceStatusCb(LSHandle *sh, const char *serviceName, bool connected, void *ctx);
@@ -137,22 +139,53 @@ private:
 
     static gboolean networkUpdateCallback(void *obj);
 
+    void scheduleScan();
+
+    void requestScan();
+
     int parseHTTPResponse(char *body, double *latitude, double *longitude, double *accuracy);
 
     char *readApiKey();
 
     char *updateCellData();
 
-    char *createCellWifiCombinedQuery();
+    const char *createCellWifiCombinedQuery();
+
+    const char *createCellQuery();
 
-    char *createCellQuery();
+    const char *createWifiQuery();
 
-    char *createWifiQuery();
+    bool networkPostQuery(const char *post_data, const char *apikey, gboolean sync,
+                          const WifiScan &scan = WifiScan());
 
-    bool networkPostQuery(char *post_data, const char *apikey, gboolean sync);
+    bool sendBackendQuery(size_t backend, const char *url, const char *postData, gboolean sync,
+                          const WifiScan &scan);
+
+    static gboolean hedgeCallback(gpointer data);
+
+    bool settleBackendQuery(HttpReqTask *task, WifiScan &scan);
+
+    void cancelHedge();
+
+    void cancelBackendQueries();
+
+    // force ignores the minimum interval and the write budget, for deinit
+    void saveCaches(bool force);
+
+    static gboolean gpsFeedExpired(gpointer data);
+
+    void stopGpsFeed(bool resume);
 
     void handleResponse(HttpReqTask *task);
 
+    void updatePosition(double latitude, double longitude, double accuracy);
+
+    bool resolveLocally(int minAccessPoints);
+
+    bool resolveFromCellCache();
+
+    static gboolean trainCallback(gpointer data);
+
     void onUpdateCellData(const char *cellData);
 
     void onUpdateWifiData(GHashTable *wifiAccessPoints);
@@ -170,11 +203,9 @@ private:
 
     bool triggerPostQuery();
 
-    template<typename T>
-    bool parseWifiData(T& jsonObj);
+    bool parseWifiData(GeolocationQueryBuilder &query);
 
-    template<typename T>
-    bool parseCellData(T& jsonObj);
+    bool parseCellData(GeolocationQueryBuilder &query);
 
 private:
 
@@ -191,6 +222,50 @@ private:
     bool mwifiStatus;
     bool mConnectivityStatus;
     bool misFirstCellResponse;
+    WifiFingerprintCache mFingerprintCache;
+    int64_t mQueryStartTime;
+    AccessPointDatabase mApDatabase;
+    WifiScan mLastScan;
+    int64_t mLastScanTime;
+
+    struct TrainingFix {
+        double latitude;
+        double longitude;
+        double accuracy;
+        double speed;
+        int64_t time;           // monotonic us, 0 for none
+    };
+
+    TrainingFix mLastFix;       // the last fix accurate enough to train with
+    int64_t mTrainedScanTime;   // each scan trains the database once
+    CellTowerCache mCellCache;
+    CellTowerKey mServingCell;
+    bool mServingCellValid;
+    bool mCellQueryPending;
+    int64_t mCellDataTime;
+    int64_t mLastCacheSave;
+    size_t mLastCacheSaveBytes;
+    NetworkScanScheduler mScanScheduler;
+    GeolocationQueryBuilder mQueryBuilder;
+
+    struct BackendQuery {
+        HttpReqTask *task;
+        size_t backend;
+        uint32_t queryId;
+        WifiScan scan;      // the answer is cached under this fingerprint
+    };
+
+    PositioningBackends mBackends;
+    std::vector<BackendQuery> mBackendQueries;
+    uint32_t mQueryId;
+    uint32_t mAnsweredQueryId;
+    std::string mHedgeBody;
+    WifiScan mHedgeScan;
+    guint mHedgeTimerId;
+    bool mGpsFeedActive;
+    guint mGpsFeedTimerId;
+    uint64_t mGpsFedFixes;
+    bool mFixPending;   // started, no fix delivered yet
 };
 
 
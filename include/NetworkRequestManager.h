@@ -23,11 +23,55 @@
 #include <mutex>
 #include <iostream>
 #include <unordered_map>
+#include <deque>
+#include <vector>
 #include <HttpInterface.h>
+#include <HttpConnectionPool.h>
+#include <CircuitBreaker.h>
+#include <HttpResponseCache.h>
 #include <NetworkRequestManagerDefines.h>
 #include <location_errors.h>
 #include <luna-service2/lunaservice.h>
-
+#include <glib.h>
+#include <pbnjson.h>
+
+
+typedef struct _HttpDeferredStats {
+    uint64_t deferred;
+    uint64_t replayed;
+    uint64_t expired;
+    uint64_t rejected;
+    uint64_t queued;
+} HttpDeferredStats;
+
+// classes of outbound requests, highest priority first
+typedef enum {
+    HTTP_PRIORITY_FOREGROUND_POSITION = 0,  // a client waits on a fix
+    HTTP_PRIORITY_BACKGROUND_POSITION,      // periodic refresh of a tracked position
+    HTTP_PRIORITY_GEOCODING,
+    HTTP_PRIORITY_PREFETCH,
+    HTTP_PRIORITY_MAX
+} HttpPriority;
+
+typedef struct _HttpPriorityStats {
+    const char *name;
+    unsigned int limit;         // concurrent transfers allowed to the class
+    unsigned int active;
+    unsigned int queued;
+    uint64_t sent;
+    uint64_t waited;            // sent after waiting for a free slot
+    uint64_t expired;
+    uint64_t rejected;
+    uint64_t totalWaitMs;
+    uint64_t maxWaitMs;
+} HttpPriorityStats;
+
+typedef struct _HttpRequestOptions {
+    unsigned int timeoutMs;     // deadline of the whole exchange, 0 for none
+    unsigned int maxRetries;    // for idempotent requests only
+    int64_t cacheTtlMs;         // GET responses stay fresh this long, 0 to bypass the cache
+    HttpPriority priority;
+} HttpRequestOptions;
 
 class NetworkRequestManager {
 
@@ -45,17 +89,117 @@ public:
     void deInit();
 
     ErrorCodes initiateTransaction(const char **headers, int size, std::string url, bool isSync, LSMessage *message,
-                                   HttpInterface *client, char *post_data = NULL);
+                                   HttpInterface *client, char *post_data = NULL, HttpReqTask **task = NULL,
+                                   const HttpRequestOptions *options = NULL);
+
+    bool cancelTransaction(HttpReqTask *task);
 
-    void cancelTransaction(HttpReqTask *task);
+    // cancels every transaction whose client or message is owner
+    int cancelTransactions(const void *owner);
 
     void clearTransaction(HttpReqTask *task);
 
+    void getConnectionStats(HttpConnectionPoolStats *stats) const;
+
+    uint64_t getCoalescedRequests() const { return mCoalescedRequests; }
+
+    uint64_t getRetries() const { return mRetries; }
+
+    void getCircuitStats(std::vector<CircuitBreakerStats> &stats) const;
+
+    // while offline async requests are queued, and replayed once online again
+    void setOnline(bool online);
+
+    bool isOnline() const { return mOnline; }
+
+    void getDeferredStats(HttpDeferredStats *stats) const;
+
+    void getCacheStats(HttpResponseCacheStats *stats) const;
+
+    void getPriorityStats(std::vector<HttpPriorityStats> &stats) const;
+
+    // concurrent transfers allowed to priority, callers pacing themselves stay within it
+    unsigned int getPriorityLimit(HttpPriority priority) const;
+
+    // how long the last attempt of task was on the wire, without its time in a queue or
+    // waiting for a retry; -1 when task did not go out itself (cached or coalesced)
+    int64_t getAttemptLatencyMs(HttpReqTask *task) const;
+
+    // the HTTP sections of getServiceMetrics, false when out of memory
+    bool appendStats(jvalue_ref parent) const;
+
     //callback from loc_http
     static void handleDataCb(HttpReqTask *task, void *user_data);
 
 private:
 
+    typedef struct _HttpTransaction {
+        HttpInterface *client;
+        LSMessage *message;
+        guint timerId;
+        guint retryTimerId;
+        guint deliverId;    // pending delivery of a cached response
+        bool removed;   // not added to loc_http: timed out, waiting for a retry, or a follower
+        bool completed;
+        bool pooled;
+        bool probe;     // the half-open probe of its endpoint
+        bool queued;    // waiting for a free slot of its class, or for the network
+        bool deferred;  // queued while offline
+        bool active;    // counted against the limit of its class
+        HttpPriority priority;
+        int64_t queuedAt;
+        int64_t sentAt;     // the current attempt was handed to loc_http
+        unsigned int retries;
+        unsigned int maxRetries;
+        int64_t cacheTtlMs;
+        std::string host;
+        std::string url;
+        std::string key;                        // coalescing key while the transfer is shared
+        HttpReqTask *leader;                    // transfer a coalesced request waits on
+        std::vector<HttpReqTask *> followers;
+    } HttpTransaction;
+
+    static gboolean handleDeadlineCb(gpointer data);
+
+    static gboolean handleRetryCb(gpointer data);
+
+    static bool isFailure(const HttpReqTask *task);
+
+    bool scheduleRetry(HttpReqTask *task, HttpTransaction &transaction);
+
+    void finishTransaction(HttpReqTask *task);
+
+    bool mustWait(HttpPriority priority) const;
+
+    ErrorCodes queueTransaction(HttpReqTask *task, HttpReqTask **outTask, unsigned int timeoutMs);
+
+    void unqueue(HttpReqTask *task, HttpTransaction &transaction);
+
+    void setActive(HttpTransaction &transaction, bool active);
+
+    int nextPriority() const;
+
+    void scheduleDispatch();
+
+    static gboolean dispatchQueuedCb(gpointer data);
+
+    void dispatchQueued();
+
+    ErrorCodes serveFromCache(const std::string &body, LSMessage *message, HttpInterface *client, HttpReqTask **task);
+
+    static gboolean deliverCachedCb(gpointer data);
+
+    void applyCache(HttpReqTask *task, HttpTransaction &transaction);
+
+    static std::string coalescingKey(const std::string &url, const char *post_data);
+
+    static void copyResult(const HttpReqTask *from, HttpReqTask *to);
+
+    ErrorCodes attachFollower(HttpReqTask *leader, LSMessage *message, HttpInterface *client, HttpReqTask **task,
+                              unsigned int timeoutMs);
+
+    void detachFollower(HttpReqTask *task, HttpTransaction &transaction);
+
     NetworkRequestManager();
 
     NetworkRequestManager(const NetworkRequestManager &rhs) = delete; // prevent copy construction
@@ -64,7 +208,23 @@ private:
 private:
 
     std::bitset<sizeof(unsigned long)> _attributes;
-    std::unordered_map<HttpReqTask *, HttpInterface *> httpRequestList;
+    std::unordered_map<HttpReqTask *, HttpTransaction> httpRequestList;
+    HttpConnectionPool mConnectionPool;
+    std::unordered_map<std::string, HttpReqTask *> inflightRequests;
+    CircuitBreaker mCircuitBreaker;
+    bool mOnline;
+    bool mReplaying;    // the backlog of an offline period is paced out
+    guint mDispatchId;
+    std::deque<HttpReqTask *> mQueued[HTTP_PRIORITY_MAX];
+    unsigned int mActive[HTTP_PRIORITY_MAX];
+    unsigned int mActiveTotal;
+    uint64_t mVirtualTime;                      // weighted-fair clock, advanced on every dispatch
+    uint64_t mFinishTag[HTTP_PRIORITY_MAX];
+    HttpPriorityStats mPriorityStats[HTTP_PRIORITY_MAX];
+    HttpDeferredStats mDeferredStats;
+    HttpResponseCache mResponseCache;
+    uint64_t mCoalescedRequests;
+    uint64_t mRetries;
 
 };
 
@@ -0,0 +1,75 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#ifndef NETWORKSCANSCHEDULER_H_
+#define NETWORKSCANSCHEDULER_H_
+
+#include <stdint.h>
+
+typedef struct _NetworkScanStats {
+    uint64_t scans;
+    uint64_t httpRequests;
+    uint64_t unchangedScans;
+    uint64_t deliveredFixes;
+    int64_t lastStalenessMs;
+    int64_t avgStalenessMs;
+    int64_t maxStalenessMs;
+    uint32_t intervalMs;
+    uint64_t gpsFedFixes;       // filled in by the provider
+    bool gpsFeedActive;
+} NetworkScanStats;
+
+// Picks the period of the network provider scan timer. The interval doubles while
+// consecutive scans bring nothing new and falls back to the floor as soon as the
+// access points churn or GPS reports that the device is moving. The floor is the
+// tightest minimumInterval among the network subscribers.
+class NetworkScanScheduler {
+public:
+    NetworkScanScheduler();
+
+    void reset();
+
+    // the tightest minimumInterval of the live subscribers, 0 for none
+    void setSubscriberInterval(uint32_t intervalMs);
+
+    uint32_t getInterval() const { return mIntervalMs; }
+
+    // returns true if the interval became shorter
+    bool onScanResult(bool changed, int64_t nowUs);
+
+    bool onMotion(double speed, int64_t nowUs);
+
+    void recordScan() { mStats.scans++; }
+
+    void recordHttpRequest() { mStats.httpRequests++; }
+
+    void recordDelivery(int64_t stalenessMs);
+
+    void getStats(NetworkScanStats *stats) const;
+
+private:
+    uint32_t getFloor() const;
+
+    uint32_t mIntervalMs;
+    uint32_t mSubscriberIntervalMs;
+    int64_t mLastMotionUs;
+    int64_t mStalenessSumMs;
+    NetworkScanStats mStats;
+};
+
+#endif /* NETWORKSCANSCHEDULER_H_ */
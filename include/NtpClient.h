@@ -108,11 +108,14 @@ private :
     NtpDownloadState mDownloadNtpDataStatus;
     GPSServiceConfig *mConfig;
     INtpClinetCallback *mCallback;
+    unsigned int mTaskId;
 public:
     NtpClient();
 
     bool start(GPSServiceConfig *config, INtpClinetCallback *callback);
 
+    void stop();
+
     GPSServiceConfig *getConfig() const {
         return mConfig;
     }
@@ -126,7 +129,7 @@ public:
     }
 
 private:
-    static void ntpDownloadThread(void *arg);
+    static void ntpDownloadTask(void *arg);
 
     int64_t static getElapsedRealtime();
 };
@@ -0,0 +1,92 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#ifndef POSITIONINGBACKENDS_H_
+#define POSITIONINGBACKENDS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define POSITIONING_BACKEND_LATENCY_SAMPLES    32
+
+typedef struct _PositioningBackendStats {
+    std::string name;
+    uint64_t requests;
+    uint64_t hedgedRequests;
+    uint64_t successes;
+    uint64_t failures;
+    uint64_t wins;
+    int64_t p95LatencyMs;
+} PositioningBackendStats;
+
+// Geolocation web services that accept the same request body. Index 0 is the
+// primary, the others are read from a JSON file of the form
+//   { "backends": [ { "name": "...", "url": "https://...?key=", "apiKey": "..." } ] }
+// where the request URL is url followed by apiKey.
+class PositioningBackends {
+public:
+    PositioningBackends();
+
+    void setPrimary(const std::string &name);
+
+    bool load(const char *path);
+
+    size_t size() const { return mBackends.size(); }
+
+    const std::string &getName(size_t index) const { return mBackends[index].name; }
+
+    // secondary backends only, the primary URL is built by the provider
+    std::string getUrl(size_t index) const;
+
+    // how long to wait for a backend before hedging, its p95 latency once known
+    int64_t getHedgeDelayMs(size_t index) const;
+
+    void recordRequest(size_t index, bool hedged);
+
+    // latencyMs is negative when the answer did not come from the backend itself
+    void recordResult(size_t index, bool success, int64_t latencyMs);
+
+    void recordWin(size_t index);
+
+    void getStats(std::vector<PositioningBackendStats> &stats) const;
+
+private:
+    struct Backend {
+        std::string name;
+        std::string url;
+        std::string apiKey;
+        int64_t latencies[POSITIONING_BACKEND_LATENCY_SAMPLES];
+        size_t latencyCount;
+        size_t latencyNext;
+        uint64_t requests;
+        uint64_t hedgedRequests;
+        uint64_t successes;
+        uint64_t failures;
+        uint64_t wins;
+    };
+
+    static Backend makeBackend(const std::string &name, const std::string &url, const std::string &apiKey);
+
+    static int64_t percentile95(const Backend &backend);
+
+    std::vector<Backend> mBackends;
+};
+
+#endif /* POSITIONINGBACKENDS_H_ */
@@ -0,0 +1,112 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef REVERSEGEOCODECACHE_H_
+#define REVERSEGEOCODECACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <pbnjson.h>
+#include <Location.h>
+
+#define REVGEO_CACHE_MAX_ENTRIES      256
+#define REVGEO_CACHE_MAX_ENTRY_BYTES  (32 * 1024)
+#define REVGEO_CACHE_TTL_MS           (24 * 60 * 60 * 1000LL)
+#define REVGEO_CELL_DEFAULT_LENGTH    8       // geohash of ~38 x 19 m, street address level
+#define REVGEO_LATENCY_SAMPLES        128
+
+typedef struct _ReverseGeocodeCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t evictions;
+    uint64_t entries;
+    double hitRatio;
+    int64_t latencyP50Ms;       // of the last REVGEO_LATENCY_SAMPLES requests, hits and misses
+    int64_t latencyP90Ms;
+    int64_t latencyP99Ms;
+} ReverseGeocodeCacheStats;
+
+// Reverse geocoding answers keyed by the geohash cell of the coordinate,
+// together with the rest of the query (language, result and location types)
+// and the provider. The cell is as coarse as the finest result type asked
+// for allows, a request for the country shares its answer with a whole
+// region while a street address needs the device to stay within tens of
+// metres. Least recently used entries go first once the cache is full.
+class ReverseGeocodeCache {
+public:
+    static ReverseGeocodeCache *getInstance() {
+        static ReverseGeocodeCache cache(LOCATION_REVGEO_CACHE_PATH, REVGEO_CACHE_MAX_ENTRIES);
+        return &cache;
+    }
+
+    ReverseGeocodeCache(const char *path, size_t maxEntries);
+
+    ReverseGeocodeCache(const ReverseGeocodeCache &) = delete;
+
+    ReverseGeocodeCache &operator=(const ReverseGeocodeCache &) = delete;
+
+    static std::string geohash(double latitude, double longitude, unsigned int length);
+
+    // params is the query after the coordinate, e.g. "language=en&result_type=locality"
+    static std::string makeKey(double latitude, double longitude, const std::string &params,
+                               const std::string &provider);
+
+    bool lookup(const std::string &key, int64_t nowMs, std::string &response);
+
+    void store(const std::string &key, const std::string &response, int64_t nowMs);
+
+    void recordLatency(int64_t latencyMs);
+
+    void getStats(ReverseGeocodeCacheStats *stats) const;
+
+    // the "reverseGeocodeCache" section of getServiceMetrics, false when out of memory
+    bool appendStats(jvalue_ref parent) const;
+
+    bool load();
+
+    bool save();
+
+private:
+    struct Entry {
+        std::string response;
+        int64_t expiresAt;      // ms since epoch
+        std::list<std::string>::iterator lru;
+    };
+
+    static unsigned int cellLength(const std::string &params);
+
+    void insert(const std::string &key, const std::string &response, int64_t expiresAt);
+
+    void erase(std::unordered_map<std::string, Entry>::iterator it);
+
+    int64_t percentile(std::vector<int64_t> &sorted, unsigned int percent) const;
+
+    std::string mPath;
+    size_t mMaxEntries;
+    bool mDirty;
+    std::list<std::string> mLru;        // most recently used first
+    std::unordered_map<std::string, Entry> mEntries;
+    std::vector<int64_t> mLatencies;    // ring of the last samples
+    size_t mNextLatency;
+    ReverseGeocodeCacheStats mStats;
+};
+
+#endif /* REVERSEGEOCODECACHE_H_ */
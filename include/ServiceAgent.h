@@ -32,6 +32,8 @@
 #define SUBSC_GPS_ENGINE_STATUS "getGpsStatus"
 #define SUBSC_GET_GEOCODE_KEY "getGeoCodeLocation"
 #define SUBSC_GET_REVGEOCODE_KEY "getReverseLocation"
+#define SUBSC_GET_GEOCODE_BATCH_KEY "getGeoCodeBatch"
+#define SUBSC_GET_REVGEOCODE_BATCH_KEY "getReverseGeocodeBatch"
 #define SUBSC_GET_STATE_KEY "getState"
 #define SUBSC_GETALLLOCATIONHANDLERS "getAllLocationHandlers"
 #define SUBSC_GEOFENCE_STATUS_KEY "geofenceStatus"
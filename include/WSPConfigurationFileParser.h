@@ -44,6 +44,7 @@ public:
 
     std::string getWSPname() { return wspName;}
     std::string getKey() { return apiKey;}
+    const std::string &getDecodedKey() const { return decodedKey; }
 
     std::string getUrl(FeatureType featureType) {
 	return mSupportedFeaturesKeyUrlMap[mSupportedFeatureList[featureType]];
@@ -59,6 +60,7 @@ private:
     std::string filePath;
     std::string wspName;
     std::string apiKey;
+    std::string decodedKey;
     std::string url;
 
     SupportedFeaturesKeyUrlMap mSupportedFeaturesKeyUrlMap;
@@ -0,0 +1,93 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef WIFIFINGERPRINTCACHE_H_
+#define WIFIFINGERPRINTCACHE_H_
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <WifiScan.h>
+
+typedef struct _WifiFingerprintCacheStats {
+    uint64_t lookups;
+    uint64_t exactHits;
+    uint64_t fuzzyHits;
+    uint64_t misses;
+    uint64_t expired;
+    uint64_t evictions;
+    uint64_t entries;
+    double avgRoundTripMs;      // measured web service round trip
+    double latencySavedMs;      // round trips avoided by hits
+} WifiFingerprintCacheStats;
+
+// Maps normalized Wi-Fi fingerprints (sorted packed bssids) to resolved positions.
+// A scan hits either on the exact bssid set or on a weighted Jaccard similarity
+// above the fuzzy threshold, entries expire after the TTL and the least recently
+// used one is evicted when the cache is full.
+class WifiFingerprintCache {
+public:
+    WifiFingerprintCache(const char *path, size_t capacity, int64_t ttlMs, double fuzzyThreshold);
+
+    WifiFingerprintCache(const WifiFingerprintCache &) = delete;
+
+    WifiFingerprintCache &operator=(const WifiFingerprintCache &) = delete;
+
+    bool lookup(const WifiScan &scan, double *latitude, double *longitude, double *accuracy);
+
+    void insert(const WifiScan &scan, double latitude, double longitude, double accuracy);
+
+    void recordRoundTrip(int64_t elapsedMs);
+
+    void getStats(WifiFingerprintCacheStats *stats);
+
+    bool load();
+
+    // synced to flash before the rename; written gets the bytes written, 0 if clean
+    bool save(size_t *written);
+
+    static double weightedJaccard(const WifiScan &a, const WifiScan &b);
+
+private:
+    struct Entry {
+        uint64_t key;
+        int64_t timestamp;
+        double latitude;
+        double longitude;
+        double accuracy;
+        WifiScan scan;
+    };
+
+    typedef std::list<Entry>::iterator EntryIter;
+
+    static uint64_t fingerprintKey(const WifiScan &scan);
+
+    void removeEntry(EntryIter it);
+
+    void touch(EntryIter it);
+
+    std::string mPath;
+    size_t mCapacity;
+    int64_t mTtlMs;
+    double mFuzzyThreshold;
+    bool mDirty;
+    std::list<Entry> mEntries;      // most recently used first
+    std::unordered_map<uint64_t, EntryIter> mIndex;
+    WifiFingerprintCacheStats mStats;
+};
+
+#endif /* WIFIFINGERPRINTCACHE_H_ */
@@ -0,0 +1,47 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#ifndef WIFISCAN_H_
+#define WIFISCAN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <glib.h>
+
+#define WIFI_BSSID_STR_LEN    18
+
+struct WifiAccessPoint {
+    uint64_t bssid;     // 48-bit MAC address in the low bits
+    int signal;         // dBm
+};
+
+// access points of one scan, sorted by bssid
+typedef std::vector<WifiAccessPoint> WifiScan;
+
+bool wifiBssidPack(const char *bssid, uint64_t *packed);
+
+void wifiBssidUnpack(uint64_t packed, char *bssid, size_t len);
+
+// build a sorted scan from a bssid string -> signal table, malformed bssids are skipped
+void wifiScanFromTable(GHashTable *accessPoints, WifiScan &scan);
+
+// sum of absolute signal changes between two sorted scans, an access point seen in only
+// one of them counts with its full signal; vanished gets the number of dropped access points
+int wifiScanSignalChange(const WifiScan &current, const WifiScan &previous, unsigned int *vanished);
+
+#endif /* WIFISCAN_H_ */
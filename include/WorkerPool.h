@@ -0,0 +1,116 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <pbnjson.h>
+
+#define WORKER_POOL_THREADS     2
+#define WORKER_POOL_MAX_QUEUED  16
+
+typedef enum {
+    WORKER_PRIORITY_HIGH = 0,
+    WORKER_PRIORITY_NORMAL,
+    WORKER_PRIORITY_LOW,
+    WORKER_PRIORITY_MAX
+} WorkerPriority;
+
+typedef void (*WorkerFunc)(void *data);
+
+typedef struct _WorkerPoolStats {
+    unsigned int threads;
+    unsigned int maxThreads;
+    unsigned int busy;
+    unsigned int queued;
+    unsigned int maxQueued;     // deepest the queue has been
+    unsigned int queueLimit;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t cancelled;
+    uint64_t rejected;
+} WorkerPoolStats;
+
+// Fixed set of threads for blocking background I/O such as NTP and XTRA
+// downloads. Threads are started on demand up to the limit and then kept.
+// Tasks run highest priority first, FIFO within a priority. A task still
+// queued can be cancelled, a running one can only be waited for, so a task
+// must not outlive what it works on. stop() drops the queue and joins.
+class WorkerPool {
+public:
+    static WorkerPool *getInstance() {
+        static WorkerPool pool(WORKER_POOL_THREADS, WORKER_POOL_MAX_QUEUED);
+        return &pool;
+    }
+
+    WorkerPool(size_t maxThreads, size_t maxQueued);
+
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // returns 0 when the queue is full or the pool is stopped, release frees
+    // data of a task that is cancelled before it runs
+    unsigned int submit(const char *name, WorkerPriority priority, WorkerFunc func, void *data,
+                        WorkerFunc release = NULL);
+
+    // true when the task was dropped from the queue; a running task is waited for if wait is set
+    bool cancel(unsigned int id, bool wait);
+
+    void stop();
+
+    void getStats(WorkerPoolStats *stats);
+
+    // the "workerPool" section of getServiceMetrics, false when out of memory
+    bool appendStats(jvalue_ref parent);
+
+private:
+    struct Task {
+        unsigned int id;
+        const char *name;
+        WorkerFunc func;
+        WorkerFunc release;
+        void *data;
+    };
+
+    void run();
+
+    bool isRunning(unsigned int id) const;
+
+    std::mutex mLock;
+    std::condition_variable mWork;
+    std::condition_variable mDone;
+    std::deque<Task> mQueues[WORKER_PRIORITY_MAX];
+    std::vector<std::thread> mThreads;
+    std::vector<unsigned int> mRunning;
+    size_t mMaxThreads;
+    size_t mMaxQueued;
+    size_t mQueued;
+    unsigned int mNextId;
+    bool mStopping;
+    WorkerPoolStats mStats;
+};
+
+#endif /* WORKERPOOL_H_ */
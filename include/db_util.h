@@ -98,6 +98,16 @@ int deleteKey(DBHandle *handle, char *key);
  */
 int commit(DBHandle *handle);
 
+/**
+ * <Funciton>       commitSync
+ * <Description>    Flush the modified xml to the file and optionally fsync it
+ * @param           <DBHandle> <In> <DBHandled intialized in create>
+ * @param           <syncToDisk> <In> <fsync the file after it is written>
+ * @param           <bytesWritten> <Out> <number of bytes written to the file, may be NULL>
+ * @return          int
+ */
+int commitSync(DBHandle *handle, int syncToDisk, int *bytesWritten);
+
 /**
  * <Funciton>       isFileExists
  * <Description>    Check if the file exists
@@ -0,0 +1,199 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <string.h>
+#include <glib.h>
+#include <loc_log.h>
+#include <GeocodeCache.h>
+
+#define GEOCODE_KEY_SEPARATOR   '\x1f'
+
+GeocodeCache::GeocodeCache(size_t maxEntries, size_t maxBytes)
+    : mMaxEntries(maxEntries),
+      mMaxBytes(maxBytes),
+      mBytes(0) {
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+std::string GeocodeCache::normalize(const std::string &text) {
+    gchar *normalized = NULL;
+    gchar *folded = NULL;
+    std::string result;
+    bool space = false;
+
+    // full width forms and composed characters compare equal after NFKC
+    if (g_utf8_validate(text.c_str(), text.size(), NULL))
+        normalized = g_utf8_normalize(text.c_str(), text.size(), G_NORMALIZE_NFKC);
+
+    if (normalized)
+        folded = g_utf8_casefold(normalized, -1);
+
+    const char *input = folded ? folded : text.c_str();
+
+    for (const char *p = input; *p; p++) {
+        unsigned char c = (unsigned char) *p;
+
+        if (c == '+' || c < 0x20 || g_ascii_isspace(c)) {
+            space = !result.empty();
+            continue;
+        }
+
+        // "main st , city" and "main st, city" are the same address
+        if (space && c != ',')
+            result += ' ';
+
+        space = false;
+        result += (char) c;
+    }
+
+    g_free(normalized);
+    g_free(folded);
+
+    return result;
+}
+
+void GeocodeCache::splitQuery(const std::string &query, std::string &address, std::string &params) {
+    static const std::string addressParam = "address=";
+
+    if (query.compare(0, addressParam.size(), addressParam) != 0) {
+        address.clear();
+        params = normalize(query);
+        return;
+    }
+
+    size_t end = query.find('&');
+
+    address = normalize(query.substr(addressParam.size(),
+                                     end == std::string::npos ? std::string::npos : end - addressParam.size()));
+    params = end == std::string::npos ? std::string() : normalize(query.substr(end));
+}
+
+std::string GeocodeCache::makeKey(const std::string &query) {
+    std::string address;
+    std::string params;
+
+    splitQuery(query, address, params);
+
+    return address + GEOCODE_KEY_SEPARATOR + params;
+}
+
+bool GeocodeCache::lookup(const std::string &key, int64_t nowMs, std::string &response) {
+    auto it = mEntries.find(key);
+
+    if (it == mEntries.end() || nowMs >= it->second.expiresAt) {
+        if (it != mEntries.end())
+            erase(it);
+
+        mStats.misses++;
+        return false;
+    }
+
+    mLru.splice(mLru.begin(), mLru, it->second.lru);
+    response = it->second.response;
+    mStats.hits++;
+
+    return true;
+}
+
+void GeocodeCache::store(const std::string &key, const std::string &response, int64_t nowMs) {
+    if (response.empty() || response.size() > GEOCODE_CACHE_MAX_ENTRY_BYTES)
+        return;
+
+    auto it = mEntries.find(key);
+
+    if (it != mEntries.end())
+        erase(it);
+
+    while (!mLru.empty() &&
+           (mEntries.size() >= mMaxEntries || mBytes + key.size() + response.size() > mMaxBytes)) {
+        erase(mEntries.find(mLru.back()));
+        mStats.evictions++;
+    }
+
+    mLru.push_front(key);
+
+    Entry entry = {response, nowMs + GEOCODE_CACHE_TTL_MS, mLru.begin()};
+    mEntries[key] = entry;
+    mBytes += key.size() + response.size();
+    mStats.stores++;
+}
+
+void GeocodeCache::erase(std::map<std::string, Entry>::iterator it) {
+    mBytes -= it->first.size() + it->second.response.size();
+    mLru.erase(it->second.lru);
+    mEntries.erase(it);
+}
+
+size_t GeocodeCache::findCandidates(const std::string &query, int64_t nowMs, size_t maxResults,
+                                    std::vector<GeocodeCandidate> &candidates) {
+    std::string prefix;
+    std::string params;
+
+    candidates.clear();
+    splitQuery(query, prefix, params);
+    mStats.candidateLookups++;
+
+    if (prefix.size() < GEOCODE_CANDIDATE_MIN_PREFIX)
+        return 0;
+
+    for (auto it = mEntries.lower_bound(prefix);
+         it != mEntries.end() && candidates.size() < maxResults &&
+         it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        size_t separator = it->first.find(GEOCODE_KEY_SEPARATOR);
+
+        if (separator == std::string::npos || it->first.compare(separator + 1, std::string::npos, params) != 0)
+            continue;
+
+        if (nowMs >= it->second.expiresAt)
+            continue;
+
+        GeocodeCandidate candidate = {it->first.substr(0, separator), it->second.response};
+        candidates.push_back(candidate);
+    }
+
+    mStats.candidatesServed += candidates.size();
+
+    return candidates.size();
+}
+
+void GeocodeCache::getStats(GeocodeCacheStats *stats) const {
+    *stats = mStats;
+    stats->entries = mEntries.size();
+    stats->bytes = mBytes;
+}
+
+bool GeocodeCache::appendStats(jvalue_ref parent) const {
+    jvalue_ref object = jobject_create();
+    GeocodeCacheStats stats;
+
+    if (jis_null(object))
+        return false;
+
+    getStats(&stats);
+
+    jobject_put(object, J_CSTR_TO_JVAL("hits"), jnumber_create_i64(stats.hits));
+    jobject_put(object, J_CSTR_TO_JVAL("misses"), jnumber_create_i64(stats.misses));
+    jobject_put(object, J_CSTR_TO_JVAL("stores"), jnumber_create_i64(stats.stores));
+    jobject_put(object, J_CSTR_TO_JVAL("evictions"), jnumber_create_i64(stats.evictions));
+    jobject_put(object, J_CSTR_TO_JVAL("entries"), jnumber_create_i64(stats.entries));
+    jobject_put(object, J_CSTR_TO_JVAL("bytes"), jnumber_create_i64(stats.bytes));
+    jobject_put(object, J_CSTR_TO_JVAL("candidateLookups"), jnumber_create_i64(stats.candidateLookups));
+    jobject_put(object, J_CSTR_TO_JVAL("candidatesServed"), jnumber_create_i64(stats.candidatesServed));
+    jobject_put(parent, J_CSTR_TO_JVAL("geocodeCache"), object);
+
+    return true;
+}
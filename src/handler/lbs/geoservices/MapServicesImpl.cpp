@@ -15,27 +15,54 @@
 // SPDX-License-Identifier: Apache-2.0
 
 
+#include <stdio.h>
+#include <curl/curl.h>
 #include <MapServicesImpl.h>
 
 #include <WSPConfigurationFileParser.h>
 
 using namespace std;
 
-#define GEOCODEMETHOD    "getGeoCodeLocation"
-#define REVGEOMETHOD       "getReverseLocation"
+#define LBS_QUERY_MAX_RETRIES    2
+#define LBS_CACHE_TTL_MS         (24 * 60 * 60 * 1000LL)
 
 void MapServicesImpl::handleResponse(HttpReqTask *task) {
+    answer(task, false);
+}
+
+void MapServicesImpl::handleTimeout(HttpReqTask *task) {
+    answer(task, true);
+}
+
+// a timeout is told apart from a failed exchange, callers report them differently
+void MapServicesImpl::answer(HttpReqTask *task, bool timedOut) {
     int error = ERROR_NONE;
     char *response = NULL;
-    LSMessage *message = NULL;
+    GeocodeRequest request;
 
     if (!task) {
         return;
     }
 
-    message = (LSMessage *) task->message;
+    auto it = mRequests.find(task);
+
+    if (it != mRequests.end()) {
+        request = it->second;
+        mRequests.erase(it);
+    } else if (mSyncRequest) {
+        request = *mSyncRequest;
+        mSyncRequest = NULL;
+    } else {
+        LS_LOG_ERROR("no geocode request for task %p", task);
+        NetworkRequestManager::getInstance()->clearTransaction(task);
+        return;
+    }
 
-    if (HTTP_STATUS_CODE_SUCCESS == task->curlDesc.httpResponseCode) {
+    if (timedOut || task->curlDesc.curlResultCode == CURLE_OPERATION_TIMEDOUT) {
+        LS_LOG_INFO("geocode request %p timed out", request.message);
+        error = ERROR_TIMEOUT;
+        response = g_strdup("HTTP Connection timed out");
+    } else if (HTTP_STATUS_CODE_SUCCESS == task->curlDesc.httpResponseCode) {
         response = g_strdup(task->responseData);
         LS_LOG_DEBUG("cbHttpResponsee %s", response);
     } else {
@@ -44,33 +71,71 @@ void MapServicesImpl::handleResponse(HttpReqTask *task) {
         response = g_strdup("HTTP Connection failed");
     }
 
+    if (error == ERROR_NONE && !request.key.empty() && isCacheable(task)) {
+        if (request.reverse)
+            ReverseGeocodeCache::getInstance()->store(request.key, response, g_get_real_time() / 1000);
+        else
+            GeocodeCache::getInstance()->store(request.key, response, g_get_real_time() / 1000);
+    }
+
+    if (request.reverse)
+        ReverseGeocodeCache::getInstance()->recordLatency((g_get_monotonic_time() - request.startTime) / 1000);
+
     NetworkRequestManager::getInstance()->clearTransaction(task);
 
-    LS_LOG_INFO("cbHttpResponse : %d %p", error, message);
+    LS_LOG_INFO("cbHttpResponse : %d %p", error, request.message);
 
-    if (!strcmp(LSMessageGetMethod(message), GEOCODEMETHOD)) {
-        GeoLocation geolocation(response);
-        mGeoCodeCb(geolocation, error, message);
-    } else if (!strcmp(LSMessageGetMethod(message), REVGEOMETHOD)) {
-        GeoAddress geoaddr(response);
-        mRevGeoCodeCb(geoaddr, error, message);
-    }
+    deliver(request, response, error);
 
     if (response)
         free(response);
 
 }
 
+void MapServicesImpl::deliver(const GeocodeRequest &request, const char *response, int error) {
+    if (request.reverse) {
+        GeoAddress geoaddr(response);
+        request.revGeoCodeCb(geoaddr, error, request.message);
+    } else {
+        GeoLocation geolocation(response);
+        request.geoCodeCb(geolocation, error, request.message);
+    }
+}
+
+// quota and key errors come with a 200 status, only real answers are cached
+bool MapServicesImpl::isCacheable(const HttpReqTask *task) {
+    static const char *transientStatus[] = {
+        "OVER_QUERY_LIMIT", "OVER_DAILY_LIMIT", "REQUEST_DENIED", "INVALID_REQUEST", "UNKNOWN_ERROR"
+    };
+
+    if (!task->responseData)
+        return false;
+
+    for (const char *status : transientStatus) {
+        if (strstr(task->responseData, status))
+            return false;
+    }
+
+    return true;
+}
+
 MapServicesImpl::MapServicesImpl(WSPConfigurationFileParser* confData)
-    : configurationData(confData) {
+    : configurationData(confData),
+      mSyncRequest(NULL) {
     LS_LOG_DEBUG("===MapServicesImpl Ctor====");
 }
 
 MapServicesImpl::~MapServicesImpl() {
     LS_LOG_DEBUG("===MapServicesImpl Dtor====");
+
+    for (CachedAnswer *cached : mCachedAnswers) {
+        g_source_remove(cached->sourceId);
+        delete cached;
+    }
 }
 
-ErrorCodes MapServicesImpl::geoCode(GeoAddress& address, GeoCodeCb geoCodeCb, bool isSync, LSMessage *message) {
+ErrorCodes MapServicesImpl::geoCode(GeoAddress& address, GeoCodeCb geoCodeCb, bool isSync, LSMessage *message,
+                                    unsigned int timeoutMs) {
     LS_LOG_DEBUG("MapServicesImpl Geocode %s %p", address.toString().c_str(), message);
 
     if (nullptr == geoCodeCb) {
@@ -88,14 +153,30 @@ ErrorCodes MapServicesImpl::geoCode(GeoAddress& address, GeoCodeCb geoCodeCb, bo
         return ERROR_LICENSE_KEY_INVALID;
     }
 
-    this->mGeoCodeCb = geoCodeCb;
+    GeocodeRequest request = GeocodeRequest();
+    request.geoCodeCb = geoCodeCb;
+    request.message = message;
+    request.startTime = g_get_monotonic_time();
+    request.reverse = false;
+
+    string query = address.toString();
+
+    // spelling variants of the same address share one answer
+    if (!isSync) {
+        string response;
+
+        request.key = GeocodeCache::makeKey(query);
+
+        if (GeocodeCache::getInstance()->lookup(request.key, g_get_real_time() / 1000, response))
+            return deliverCachedAnswer(request, response);
+    }
 
-    string strFormattedUrl = formatUrl(address.toString(), configurationData->getUrl(GEO_CODE),  configurationData->getKey().c_str());
-    return lbsPostQuery(strFormattedUrl, isSync, message);
+    string strFormattedUrl = formatUrl(query, configurationData->getUrl(GEO_CODE));
+    return lbsPostQuery(strFormattedUrl, isSync, request, timeoutMs);
 }
 
 ErrorCodes MapServicesImpl::reverseGeoCode(GeoLocation& geolocation, ReverseGeoCodeCb revGeocodeCallback, bool isSync,
-                                         LSMessage *message) {
+                                         LSMessage *message, unsigned int timeoutMs) {
     LS_LOG_DEBUG("MapServicesImpl reverseGeoCode %s %p", geolocation.toString().c_str(), message);
 
     if (nullptr == revGeocodeCallback) {
@@ -113,116 +194,139 @@ ErrorCodes MapServicesImpl::reverseGeoCode(GeoLocation& geolocation, ReverseGeoC
         return ERROR_LICENSE_KEY_INVALID;
     }
 
-    this->mRevGeoCodeCb = revGeocodeCallback;
+    GeocodeRequest request = GeocodeRequest();
+    request.revGeoCodeCb = revGeocodeCallback;
+    request.message = message;
+    request.startTime = g_get_monotonic_time();
+    request.reverse = true;
 
-    string strFormattedUrl = formatUrl(geolocation.toString(), configurationData->getUrl(REVERSE_GEOCODE),  configurationData->getKey().c_str());
-    return lbsPostQuery(strFormattedUrl, isSync, message);
-}
+    string query = geolocation.toString();
+    double latitude = 0;
+    double longitude = 0;
 
-string MapServicesImpl::formatUrl(string geoData, std::string url, const char *key) {
-    guchar *decodedKey = NULL;
-    gsize size = 0;
-    gsize len;
-    GHmac *hmac = NULL;
-    gchar *encodedSignature = NULL;
-    guint8 *buffer = NULL;
-    string finalURL;
-    string encodedSignatureStr;
-    string urlToSign;
-    std::string subUrlToSign;
-    std::string stDecodeKey;
-    std::string tmpDecodeKey;
-    std::size_t pos;
-    int retAPIKey = LOC_SECURITY_ERROR_FAILURE;
-
-    if (url.empty()) {
-        LS_LOG_ERROR("URL not valid");
-        goto EXIT;
-    }
+    // nearby coordinates share the answer of their cell, see ReverseGeocodeCache
+    if (!isSync && sscanf(query.c_str(), "latlng=%lf,%lf", &latitude, &longitude) == 2) {
+        size_t params = query.find('&');
+        string response;
 
-    pos = url.find(".com/");
-    if (pos ==std::string::npos) {
-        LS_LOG_ERROR("URL not valid");
-        goto EXIT;
-    }
-    subUrlToSign = url.substr (pos+strlen(".com"));
+        request.key = ReverseGeocodeCache::makeKey(latitude, longitude,
+                                                   params == string::npos ? string() : query.substr(params + 1),
+                                                   configurationData->getWSPname());
 
-    if (subUrlToSign.empty()) {
-        LS_LOG_ERROR("URL not valid");
-        goto EXIT;
+        if (ReverseGeocodeCache::getInstance()->lookup(request.key, g_get_real_time() / 1000, response))
+            return deliverCachedAnswer(request, response);
     }
 
-    //Decode the private key
-  /*retAPIKey = locSecurityBase64DecodeData(key, &decodedKey);
+    string strFormattedUrl = formatUrl(query, configurationData->getUrl(REVERSE_GEOCODE));
+    return lbsPostQuery(strFormattedUrl, isSync, request, timeoutMs);
+}
 
-    if (LOC_SECURITY_ERROR_SUCCESS  != retAPIKey) {
-        LS_LOG_ERROR("Decoding the private key failed");
-        goto EXIT;
-    }*/
+bool MapServicesImpl::cancelRequest(LSMessage *message) {
+    bool found = false;
 
-     //Decode the private key
-    decodedKey = g_base64_decode(key, &size);
-    if (NULL == decodedKey) {
-        goto EXIT;
-    }
+    for (auto it = mRequests.begin(); it != mRequests.end(); ) {
+        if (it->second.message != message) {
+            ++it;
+            continue;
+        }
 
-    tmpDecodeKey = string(reinterpret_cast< const char * > (decodedKey));
-    stDecodeKey.assign(tmpDecodeKey, 0, size-1);
-    urlToSign = subUrlToSign + geoData + "&key=" + stDecodeKey;
+        HttpReqTask *task = it->first;
 
-    hmac = g_hmac_new(G_CHECKSUM_SHA1, decodedKey, size);
-    if (NULL == hmac) {
-        goto EXIT;
+        it = mRequests.erase(it);
+        NetworkRequestManager::getInstance()->cancelTransaction(task);
+        found = true;
     }
 
-    g_hmac_update(hmac, (const unsigned char *) urlToSign.c_str(), -1);
-    buffer = (guint8 *) g_malloc(strlen(urlToSign.c_str())+1);
-    if (NULL == buffer) {
-        goto EXIT;
+    for (auto it = mCachedAnswers.begin(); it != mCachedAnswers.end(); ) {
+        if ((*it)->request.message != message) {
+            ++it;
+            continue;
+        }
+
+        g_source_remove((*it)->sourceId);
+        delete *it;
+        it = mCachedAnswers.erase(it);
+        found = true;
     }
 
-    len = urlToSign.length();
-    g_hmac_get_digest(hmac, buffer, &len);
+    if (found)
+        LS_LOG_INFO("geocode requests of %p cancelled", message);
 
-    //Encode the binary signature into base64 for use within a URL
-    encodedSignature = g_base64_encode(buffer, len);
+    return found;
+}
 
-    if (NULL == encodedSignature) {
-        goto EXIT;
-    }
+// the caller takes its reference on message after we return, answer from the main loop
+ErrorCodes MapServicesImpl::deliverCachedAnswer(const GeocodeRequest &request, const string &response) {
+    CachedAnswer *cached = new CachedAnswer();
 
-    encodedSignatureStr = string((const char *) encodedSignature);
+    cached->impl = this;
+    cached->request = request;
+    cached->response = response;
+    cached->sourceId = g_idle_add(&deliverCachedAnswerCb, cached);
+    mCachedAnswers.push_back(cached);
 
-    //make url-safe by replacing '+' and '/' characters
-    replace(encodedSignatureStr.begin(), encodedSignatureStr.end(), '/', '_');
-    replace(encodedSignatureStr.begin(), encodedSignatureStr.end(), '+', '-');
+    LS_LOG_DEBUG("%s of %p answered from cache", request.reverse ? "reverse geocode" : "geocode", request.message);
 
-    finalURL = url;
-    finalURL.append(geoData);
-    finalURL.append("&key=");
-    finalURL.append(stDecodeKey);
+    return ERROR_NONE;
+}
 
-    LS_LOG_DEBUG("url: formatted succesfully");
+gboolean MapServicesImpl::deliverCachedAnswerCb(gpointer data) {
+    CachedAnswer *cached = (CachedAnswer *) data;
+
+    cached->impl->mCachedAnswers.remove(cached);
+
+    if (cached->request.reverse)
+        ReverseGeocodeCache::getInstance()->recordLatency((g_get_monotonic_time() - cached->request.startTime) / 1000);
 
-    EXIT:
+    deliver(cached->request, cached->response.c_str(), ERROR_NONE);
+    delete cached;
+
+    return G_SOURCE_REMOVE;
+}
+
+string MapServicesImpl::formatUrl(const string &geoData, const string &url) {
+    const string &key = configurationData->getDecodedKey();
+    string finalURL;
 
-    if (decodedKey != NULL)
-        g_free(decodedKey);
+    if (url.empty() || url.find(".com/") == string::npos) {
+        LS_LOG_ERROR("URL not valid");
+        return finalURL;
+    }
 
-    if (hmac != NULL)
-        g_hmac_unref(hmac);
+    if (key.empty()) {
+        LS_LOG_ERROR("Decoding the private key failed");
+        return finalURL;
+    }
 
-    if (encodedSignature != NULL)
-        g_free(encodedSignature);
+    // built in one allocation from the key decoded at configuration load
+    finalURL.reserve(url.size() + geoData.size() + strlen("&key=") + key.size());
+    finalURL.append(url);
+    finalURL.append(geoData);
+    finalURL.append("&key=");
+    finalURL.append(key);
 
-    if (buffer != NULL)
-        g_free(buffer);
+    LS_LOG_DEBUG("url: formatted succesfully");
 
     return finalURL;
 }
 
-ErrorCodes MapServicesImpl::lbsPostQuery(string url, bool isSync, LSMessage *message) {
+ErrorCodes MapServicesImpl::lbsPostQuery(const string &url, bool isSync, const GeocodeRequest &request,
+                                         unsigned int timeoutMs) {
     LS_LOG_DEBUG("==lbsPostQuery==");
-    return NetworkRequestManager::getInstance()->initiateTransaction(NULL, 0, url, isSync, message, this);
+    // geocoding queries are plain GETs, safe to repeat and to answer from cache;
+    // those with a key are kept by the geocoding caches, not a second time by url
+    int64_t cacheTtlMs = request.key.empty() ? LBS_CACHE_TTL_MS : 0;
+    HttpRequestOptions options = {timeoutMs, LBS_QUERY_MAX_RETRIES, cacheTtlMs, HTTP_PRIORITY_GEOCODING};
+    HttpReqTask *task = NULL;
+    ErrorCodes error;
+
+    mSyncRequest = isSync ? &request : NULL;
+    error = NetworkRequestManager::getInstance()->initiateTransaction(NULL, 0, url, isSync, request.message, this,
+                                                                      NULL, &task, &options);
+    mSyncRequest = NULL;
+
+    if (error == ERROR_NONE && !isSync && task)
+        mRequests[task] = request;
+
+    return error;
 }
-
@@ -0,0 +1,318 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <glib.h>
+#include <loc_log.h>
+#include <ReverseGeocodeCache.h>
+
+#define REVGEO_CACHE_MAGIC      "LRG1"
+#define REVGEO_CACHE_MAX_KEY    512
+
+static const char geohashAlphabet[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+
+/*
+ * Geohash length needed to resolve each result type without crossing into a
+ * neighbouring answer too often; unlisted types need the default, street level.
+ */
+static const struct {
+    const char *type;
+    unsigned int length;
+} resultTypeCells[] = {
+    {"country",                     3},     // ~156 km
+    {"administrative_area_level_1", 4},     // ~39 km
+    {"administrative_area_level_2", 5},     // ~4.9 km
+    {"administrative_area_level_3", 5},
+    {"colloquial_area",             5},
+    {"locality",                    5},
+    {"postal_town",                 5},
+    {"administrative_area_level_4", 6},     // ~1.2 km
+    {"administrative_area_level_5", 6},
+    {"sublocality",                 6},
+    {"neighborhood",                6},
+    {"postal_code",                 6},
+    {"political",                   6},
+    {"route",                       7},     // ~153 m
+    {"intersection",                7},
+};
+
+ReverseGeocodeCache::ReverseGeocodeCache(const char *path, size_t maxEntries)
+    : mPath(path ? path : ""),
+      mMaxEntries(maxEntries),
+      mDirty(false),
+      mNextLatency(0) {
+    memset(&mStats, 0, sizeof(mStats));
+    mLatencies.reserve(REVGEO_LATENCY_SAMPLES);
+    load();
+}
+
+std::string ReverseGeocodeCache::geohash(double latitude, double longitude, unsigned int length) {
+    double latRange[2] = {-90.0, 90.0};
+    double lngRange[2] = {-180.0, 180.0};
+    std::string hash;
+    unsigned int bits = 0;
+    unsigned int value = 0;
+    bool even = true;
+
+    while (hash.size() < length) {
+        double *range = even ? lngRange : latRange;
+        double coordinate = even ? longitude : latitude;
+        double mid = (range[0] + range[1]) / 2;
+
+        value <<= 1;
+
+        if (coordinate >= mid) {
+            value |= 1;
+            range[0] = mid;
+        } else {
+            range[1] = mid;
+        }
+
+        even = !even;
+
+        if (++bits == 5) {
+            hash += geohashAlphabet[value];
+            bits = 0;
+            value = 0;
+        }
+    }
+
+    return hash;
+}
+
+unsigned int ReverseGeocodeCache::cellLength(const std::string &params) {
+    size_t start = params.find("result_type=");
+    unsigned int length = 0;
+
+    if (start == std::string::npos)
+        return REVGEO_CELL_DEFAULT_LENGTH;
+
+    start += strlen("result_type=");
+
+    size_t end = params.find('&', start);
+    std::string types = params.substr(start, end == std::string::npos ? std::string::npos : end - start);
+
+    // several types are joined with '|', the finest of them decides
+    for (size_t pos = 0; pos <= types.size(); ) {
+        size_t next = types.find('|', pos);
+        std::string type = types.substr(pos, next == std::string::npos ? std::string::npos : next - pos);
+        unsigned int typeLength = REVGEO_CELL_DEFAULT_LENGTH;
+
+        for (size_t i = 0; i < G_N_ELEMENTS(resultTypeCells); i++) {
+            if (type == resultTypeCells[i].type) {
+                typeLength = resultTypeCells[i].length;
+                break;
+            }
+        }
+
+        length = std::max(length, typeLength);
+
+        if (next == std::string::npos)
+            break;
+
+        pos = next + 1;
+    }
+
+    return length ? length : REVGEO_CELL_DEFAULT_LENGTH;
+}
+
+std::string ReverseGeocodeCache::makeKey(double latitude, double longitude, const std::string &params,
+                                         const std::string &provider) {
+    return geohash(latitude, longitude, cellLength(params)) + "|" + params + "|" + provider;
+}
+
+bool ReverseGeocodeCache::lookup(const std::string &key, int64_t nowMs, std::string &response) {
+    auto it = mEntries.find(key);
+
+    if (it == mEntries.end() || nowMs >= it->second.expiresAt) {
+        if (it != mEntries.end()) {
+            erase(it);
+            mDirty = true;
+        }
+
+        mStats.misses++;
+        return false;
+    }
+
+    mLru.splice(mLru.begin(), mLru, it->second.lru);
+    response = it->second.response;
+    mStats.hits++;
+
+    return true;
+}
+
+void ReverseGeocodeCache::store(const std::string &key, const std::string &response, int64_t nowMs) {
+    if (key.empty() || key.size() > REVGEO_CACHE_MAX_KEY || response.empty() ||
+        response.size() > REVGEO_CACHE_MAX_ENTRY_BYTES)
+        return;
+
+    insert(key, response, nowMs + REVGEO_CACHE_TTL_MS);
+    mStats.stores++;
+    mDirty = true;
+}
+
+void ReverseGeocodeCache::insert(const std::string &key, const std::string &response, int64_t expiresAt) {
+    auto it = mEntries.find(key);
+
+    if (it != mEntries.end())
+        erase(it);
+
+    while (!mLru.empty() && mEntries.size() >= mMaxEntries) {
+        erase(mEntries.find(mLru.back()));
+        mStats.evictions++;
+    }
+
+    mLru.push_front(key);
+
+    Entry entry = {response, expiresAt, mLru.begin()};
+    mEntries[key] = entry;
+}
+
+void ReverseGeocodeCache::erase(std::unordered_map<std::string, Entry>::iterator it) {
+    mLru.erase(it->second.lru);
+    mEntries.erase(it);
+}
+
+void ReverseGeocodeCache::recordLatency(int64_t latencyMs) {
+    if (mLatencies.size() < REVGEO_LATENCY_SAMPLES) {
+        mLatencies.push_back(latencyMs);
+        return;
+    }
+
+    mLatencies[mNextLatency] = latencyMs;
+    mNextLatency = (mNextLatency + 1) % REVGEO_LATENCY_SAMPLES;
+}
+
+int64_t ReverseGeocodeCache::percentile(std::vector<int64_t> &sorted, unsigned int percent) const {
+    if (sorted.empty())
+        return 0;
+
+    // nearest rank
+    return sorted[(sorted.size() * percent + 99) / 100 - 1];
+}
+
+void ReverseGeocodeCache::getStats(ReverseGeocodeCacheStats *stats) const {
+    std::vector<int64_t> sorted(mLatencies);
+    uint64_t lookups = mStats.hits + mStats.misses;
+
+    std::sort(sorted.begin(), sorted.end());
+
+    *stats = mStats;
+    stats->entries = mEntries.size();
+    stats->hitRatio = lookups ? (double) mStats.hits / lookups : 0;
+    stats->latencyP50Ms = percentile(sorted, 50);
+    stats->latencyP90Ms = percentile(sorted, 90);
+    stats->latencyP99Ms = percentile(sorted, 99);
+}
+
+bool ReverseGeocodeCache::appendStats(jvalue_ref parent) const {
+    jvalue_ref object = jobject_create();
+    ReverseGeocodeCacheStats stats;
+
+    if (jis_null(object))
+        return false;
+
+    getStats(&stats);
+
+    jobject_put(object, J_CSTR_TO_JVAL("hits"), jnumber_create_i64(stats.hits));
+    jobject_put(object, J_CSTR_TO_JVAL("misses"), jnumber_create_i64(stats.misses));
+    jobject_put(object, J_CSTR_TO_JVAL("hitRatio"), jnumber_create_f64(stats.hitRatio));
+    jobject_put(object, J_CSTR_TO_JVAL("stores"), jnumber_create_i64(stats.stores));
+    jobject_put(object, J_CSTR_TO_JVAL("evictions"), jnumber_create_i64(stats.evictions));
+    jobject_put(object, J_CSTR_TO_JVAL("entries"), jnumber_create_i64(stats.entries));
+    jobject_put(object, J_CSTR_TO_JVAL("latencyP50Ms"), jnumber_create_i64(stats.latencyP50Ms));
+    jobject_put(object, J_CSTR_TO_JVAL("latencyP90Ms"), jnumber_create_i64(stats.latencyP90Ms));
+    jobject_put(object, J_CSTR_TO_JVAL("latencyP99Ms"), jnumber_create_i64(stats.latencyP99Ms));
+    jobject_put(parent, J_CSTR_TO_JVAL("reverseGeocodeCache"), object);
+
+    return true;
+}
+
+/*
+ * File format, least recently used entry first so that loading restores the order:
+ * <keyLength> <expiresAt> <length>\n<key><response>\n
+ */
+bool ReverseGeocodeCache::load() {
+    FILE *fp = NULL;
+    char magic[8] = {0};
+    long long expiresAt;
+    size_t keyLength, length;
+    int64_t now = g_get_real_time() / 1000;
+
+    if (mPath.empty() || (fp = fopen(mPath.c_str(), "r")) == NULL)
+        return false;
+
+    if (fscanf(fp, "%7s", magic) != 1 || strcmp(magic, REVGEO_CACHE_MAGIC) != 0) {
+        LS_LOG_ERROR("invalid reverse geocode cache file %s", mPath.c_str());
+        fclose(fp);
+        return false;
+    }
+
+    while (fscanf(fp, "%zu %lld %zu", &keyLength, &expiresAt, &length) == 3 &&
+           keyLength <= REVGEO_CACHE_MAX_KEY && length <= REVGEO_CACHE_MAX_ENTRY_BYTES && fgetc(fp) == '\n') {
+        std::string key(keyLength, '\0');
+        std::string response(length, '\0');
+
+        if (fread(&key[0], 1, keyLength, fp) != keyLength || fread(&response[0], 1, length, fp) != length)
+            break;
+
+        if (expiresAt > now)
+            insert(key, response, expiresAt);
+    }
+
+    fclose(fp);
+    mDirty = false;
+
+    LS_LOG_INFO("loaded %zu reverse geocode answers from %s", mEntries.size(), mPath.c_str());
+
+    return true;
+}
+
+bool ReverseGeocodeCache::save() {
+    FILE *fp = NULL;
+    std::string tmpPath = mPath + ".tmp";
+
+    if (!mDirty || mPath.empty())
+        return true;
+
+    if ((fp = fopen(tmpPath.c_str(), "w")) == NULL) {
+        LS_LOG_ERROR("failed to open %s", tmpPath.c_str());
+        return false;
+    }
+
+    fprintf(fp, "%s\n", REVGEO_CACHE_MAGIC);
+
+    for (auto it = mLru.rbegin(); it != mLru.rend(); ++it) {
+        const Entry &entry = mEntries[*it];
+
+        fprintf(fp, "%zu %lld %zu\n", it->size(), (long long) entry.expiresAt, entry.response.size());
+        fwrite(it->data(), 1, it->size(), fp);
+        fwrite(entry.response.data(), 1, entry.response.size(), fp);
+        fputc('\n', fp);
+    }
+
+    if (fclose(fp) != 0 || rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+        LS_LOG_ERROR("failed to write %s", mPath.c_str());
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    mDirty = false;
+    return true;
+}
@@ -15,6 +15,8 @@
 // SPDX-License-Identifier: Apache-2.0
 
 
+#include <string.h>
+#include <glib.h>
 #include <WSPConfigurationFileParser.h>
 #include <loc_log.h>
 
@@ -62,6 +64,15 @@ WspConfStateCode WSPConfigurationFileParser::parseFile() {
         return WSP_CONF_APIKEY_MISSING;
     }
 
+    // decoded once here rather than for every request, the last byte is the encoder's line end
+    gsize size = 0;
+    guchar *decoded = g_base64_decode(apiKey.c_str(), &size);
+
+    if (decoded && size > 1)
+        decodedKey.assign((const char *) decoded, strnlen((const char *) decoded, size - 1));
+
+    g_free(decoded);
+
     if (root.hasKey(SERVICES)) {
         pbnjson::JValue supportedServices = root[SERVICES];
 
@@ -17,6 +17,8 @@
 
 #include <GPSPositionProvider.h>
 #include <MockLocation.h>
+#include <DnsResolver.h>
+#include <WorkerPool.h>
 
 
 nyx_error_t GPSNyxInterface::initialize(void *instance) {
@@ -113,6 +115,14 @@ nyx_error_t GPSNyxInterface::initialize(void *instance) {
 }
 
 void GPSNyxInterface::deInitialize() {
+    // downloads in progress inject into the engine, they finish before it goes
+    client.stop();
+
+    if (WorkerPool::getInstance()->cancel(mXtraTaskId, true))
+        ((GPSPositionProvider *) gpsProviderInstance)->mDownloadXtraDataStatus = IDLE;
+
+    mXtraTaskId = 0;
+
     nyx_gps_cleanup(mNyxGpsSystem);
     nyx_gps_stop_xtra_client(mNyxGpsSystem);
     nyx_device_close(mNyxGpsSystem);
@@ -469,16 +479,16 @@ void GPSNyxInterface::gpsXtraDownloadRequestCb(void *user_data) {
         return;
 
     if (gpsNyxInterface->mXtraDefault) {
-	    GThread *downloadThread = g_thread_new("download xtra", (GThreadFunc)xtraDataDownloadThread, user_data);
-	    if (!downloadThread) {
-		    printf_warning("failed to create xtra download thread\n");
-	    }
-	    else
-	    {
-                   g_thread_unref(downloadThread);
-            }
-     }
-    else {
+        // marked before the task runs, so a second request does not queue another
+        providerInstance->mDownloadXtraDataStatus = DOWNLOADING;
+        gpsNyxInterface->mXtraTaskId = WorkerPool::getInstance()->submit("download xtra", WORKER_PRIORITY_NORMAL,
+                                                                         xtraDataDownloadTask, user_data);
+
+        if (!gpsNyxInterface->mXtraTaskId) {
+            printf_warning("failed to queue xtra download\n");
+            providerInstance->mDownloadXtraDataStatus = IDLE;
+        }
+    } else {
         providerInstance->mDownloadXtraDataStatus = DOWNLOADING;
 
         if (NYX_ERROR_NONE != nyx_gps_download_xtra_data(gpsNyxInterface->mNyxGpsSystem))
@@ -687,11 +697,12 @@ void GPSNyxInterface::xtraTimeCb(int64_t utcTime, int64_t timeReference,
     pthread_mutex_unlock(&gpsService->mGPSThreadMutex);
 }
 
-void GPSNyxInterface::xtraDataDownloadThread(void *arg) {
+void GPSNyxInterface::xtraDataDownloadTask(void *arg) {
     int nextserverindex = 0;
     int noofservers = 3;
     int count = 0;
     char *xtraservers[noofservers];
+    std::vector<std::string> xtraHosts;
     const char *ACCEPT =
             "Accept:, application/vnd.wap.mms-message, application/vnd.wap.sic";
     const char *XWAP_PROFILE =
@@ -708,7 +719,11 @@ void GPSNyxInterface::xtraDataDownloadThread(void *arg) {
 
     xtraservers[count++] = providerInstance->mGPSConf.mXtraServer3;
 
-    providerInstance->mDownloadXtraDataStatus = DOWNLOADING;
+    for (int i = 0; i < count; i++)
+        xtraHosts.push_back(DnsResolver::hostOfUrl(xtraservers[i]));
+
+    // the mirrors resolve in parallel while the first one is tried
+    DnsResolver::getInstance()->prefetch(xtraHosts);
 
     headers[0] = ACCEPT;
     headers[1] = XWAP_PROFILE;
@@ -719,9 +734,13 @@ void GPSNyxInterface::xtraDataDownloadThread(void *arg) {
     }
 
     while (!providerInstance->mHttpReqTask->responseData) {
+        std::vector<struct in_addr> addresses;
 
-        if (loc_http_task_prepare_connection(&providerInstance->mHttpReqTask,
-                                             xtraservers[nextserverindex])) {
+        // a mirror whose name does not resolve is skipped instead of waiting on curl
+        if (!DnsResolver::getInstance()->resolve(xtraHosts[nextserverindex], addresses)) {
+            printf_info("xtra server %s does not resolve\n", xtraHosts[nextserverindex].c_str());
+        } else if (loc_http_task_prepare_connection(&providerInstance->mHttpReqTask,
+                                                    xtraservers[nextserverindex])) {
 
             if (loc_http_add_request(providerInstance->mHttpReqTask, true)) {
 
@@ -737,13 +756,13 @@ void GPSNyxInterface::xtraDataDownloadThread(void *arg) {
                             providerInstance->mHttpReqTask->curlDesc.httpResponseCode);
                 }
             }
+        }
 
-            // increment NextServerIndex and wrap around if necessary
-            nextserverindex++;
+        // increment NextServerIndex and wrap around if necessary
+        nextserverindex++;
 
-            if (nextserverindex == count)
-                break; //tried all the servers breaking
-        }
+        if (nextserverindex == count)
+            break; //tried all the servers breaking
     }
 
     if (NYX_ERROR_NONE
@@ -35,6 +35,10 @@ using namespace std;
 #define    LGETLSMODE        0
 #define    LGEPOSITIONMODE    NYX_GPS_POSITION_MODE_MS_BASED
 #define    CHIPSETID        "Main"
+#define    STORE_DURABILITY_MODE        1       // 0: fsync always, 1: periodic, 2: on suspend
+#define    STORE_MAX_WRITES_PER_HOUR    120
+#define    STORE_MAX_BYTES_PER_HOUR     (64 * 1024)
+#define    STORE_FLUSH_INTERVAL         60
 
 void GPSServiceConfig::loadDefaults() {
     mSUPLVer = SUPL_VERSION;
@@ -51,7 +55,10 @@ void GPSServiceConfig::loadDefaults() {
     mLgeTlsMode = LGETLSMODE;
     mLgeGPSPositionMode = LGEPOSITIONMODE;
     strncpy(mChipsetID, CHIPSETID, sizeof(mChipsetID));
-
+    mStoreDurabilityMode = STORE_DURABILITY_MODE;
+    mStoreMaxWritesPerHour = STORE_MAX_WRITES_PER_HOUR;
+    mStoreMaxBytesPerHour = STORE_MAX_BYTES_PER_HOUR;
+    mStoreFlushInterval = STORE_FLUSH_INTERVAL;
 
 }
 
@@ -69,7 +76,11 @@ void GPSServiceConfig::loadConfigFile(std::string configFileName) {
             {"VENDOR",                &mVENDOR,             nullptr, 's'},
             {"LGE_TLS_MODE",          &mLgeTlsMode,         nullptr, 'n'},
             {"LGE_GPS_POSITION_MODE", &mLgeGPSPositionMode, nullptr, 'n'},
-            {"CHIPSET_ID",            &mChipsetID,          nullptr, 's'}
+            {"CHIPSET_ID",            &mChipsetID,          nullptr, 's'},
+            {"STORE_DURABILITY_MODE",     &mStoreDurabilityMode,   nullptr, 'n'},
+            {"STORE_MAX_WRITES_PER_HOUR", &mStoreMaxWritesPerHour, nullptr, 'n'},
+            {"STORE_MAX_BYTES_PER_HOUR",  &mStoreMaxBytesPerHour,  nullptr, 'n'},
+            {"STORE_FLUSH_INTERVAL",      &mStoreFlushInterval,    nullptr, 'n'}
     };
 
     GPS_READ_CONF(configFileName.c_str(), gps_cfg_parameter_table);
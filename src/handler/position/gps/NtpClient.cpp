@@ -23,6 +23,8 @@
 #include <string.h>
 #include <loc_log.h>
 #include <unistd.h>
+#include <DnsResolver.h>
+#include <WorkerPool.h>
 
 #define SOCK_DEFAULT_PORT               123
 #define SOCK_MODE                       (3 << 3) | 3
@@ -37,7 +39,8 @@
 #define MILLI_SEC_FRAQ                  1000000
 
 
-NtpClient::NtpClient() : mDownloadNtpDataStatus(NtpDownloadState::NTPIDLE), mConfig(nullptr), mCallback(nullptr) { }
+NtpClient::NtpClient() : mDownloadNtpDataStatus(NtpDownloadState::NTPIDLE), mConfig(nullptr), mCallback(nullptr),
+                         mTaskId(0) { }
 
 bool NtpClient::start(GPSServiceConfig *config, INtpClinetCallback *callback) {
     LS_LOG_DEBUG("enter gpsRequestUtcTimeCb\n");
@@ -50,27 +53,35 @@ bool NtpClient::start(GPSServiceConfig *config, INtpClinetCallback *callback) {
     mCallback = callback;
     mConfig = config;
     mDownloadNtpDataStatus = NtpDownloadState::NTPDOWNLOADING;
-    GThread *ntpThread = g_thread_new("download ntp time", (GThreadFunc) NtpClient::ntpDownloadThread, this);
 
-    if (!ntpThread) {
-        LS_LOG_ERROR("failed to create ntp download thread\n");
+    // time comes first, the GPS engine waits on it for its first fix
+    mTaskId = WorkerPool::getInstance()->submit("download ntp time", WORKER_PRIORITY_HIGH,
+                                                NtpClient::ntpDownloadTask, this);
+
+    if (!mTaskId) {
+        LS_LOG_ERROR("failed to queue ntp download\n");
+        mDownloadNtpDataStatus = NtpDownloadState::NTPIDLE;
         mCallback->onRequestCompleted(NtpErrors::CONNECTION_PROBLEM, nullptr);
-        // No additional resource management is typically needed for a failed g_thread_new
-        // But handle any other necessary cleanup or state management here
         return false;
     }
 
-    g_thread_unref(ntpThread);
     return true;
 }
 
-void NtpClient::ntpDownloadThread(void *arg) {
+void NtpClient::stop() {
+    // a download already running is waited for, it reports to mCallback
+    if (WorkerPool::getInstance()->cancel(mTaskId, true))
+        mDownloadNtpDataStatus = NtpDownloadState::NTPIDLE;
+
+    mTaskId = 0;
+}
+
+void NtpClient::ntpDownloadTask(void *arg) {
     //Casting in c style ?? bad ??
     NtpClient *ntpClient = (NtpClient *) arg;
 
     GPSServiceConfig mGPSConf = *ntpClient->mConfig;
     struct sockaddr_in sock_addr;
-    struct hostent *he;
     struct timeval tval;
     struct ntp_packet pkt;
     int usd = -1;
@@ -81,7 +92,7 @@ void NtpClient::ntpDownloadThread(void *arg) {
     long int len = 0;
     char *ntpservers[noofservers];
 
-    LS_LOG_DEBUG("enter NtpClient::ntpDownloadThread\n");
+    LS_LOG_DEBUG("enter NtpClient::ntpDownloadTask\n");
 
 
     if (strlen(mGPSConf.mNTPServer1))
@@ -98,8 +109,10 @@ void NtpClient::ntpDownloadThread(void *arg) {
         return;
     }
 
-    LS_LOG_DEBUG("ntp download thread started\n");
+    LS_LOG_DEBUG("ntp download started\n");
 
+    // all servers resolve at once, a fallback server is ready when the first fails
+    DnsResolver::getInstance()->prefetch(std::vector<std::string>(ntpservers, ntpservers + count));
 
     while (nextserverindex < count) {
 
@@ -108,9 +121,11 @@ void NtpClient::ntpDownloadThread(void *arg) {
             return;
         }
 
-        if ((he = gethostbyname(ntpservers[nextserverindex]))) {
+        std::vector<struct in_addr> addresses;
+
+        if (DnsResolver::getInstance()->resolve(ntpservers[nextserverindex], addresses)) {
             memset(&sock_addr, 0, sizeof(sock_addr));
-            memcpy(&sock_addr.sin_addr, he->h_addr_list[0], sizeof(sock_addr.sin_addr));
+            memcpy(&sock_addr.sin_addr, &addresses[0], sizeof(sock_addr.sin_addr));
             sock_addr.sin_port = htons(SOCK_DEFAULT_PORT);
             sock_addr.sin_family = AF_INET;
 
@@ -162,7 +177,7 @@ void NtpClient::ntpDownloadThread(void *arg) {
             }
         }
         else {
-            LS_LOG_ERROR("ntp download Error gethostbyname\n");
+            LS_LOG_ERROR("ntp download Error resolving %s\n", ntpservers[nextserverindex]);
 
         }
         if (usd >= 0) {
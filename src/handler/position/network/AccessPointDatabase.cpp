@@ -0,0 +1,315 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include <loc_log.h>
+#include <AccessPointDatabase.h>
+
+#define APDB_MAGIC                  0x42445041      // "APDB"
+#define APDB_VERSION                1
+#define APDB_MAX_SAMPLE_WEIGHTS     50.0            // older samples fade out past this many new ones
+#define APDB_MIN_SAMPLE_ACCURACY    5.0
+#define APDB_MIN_FIX_ACCURACY       20.0
+#define APDB_MAX_SPREAD             65535
+#define PATH_LOSS_REF_SIGNAL        -40.0           // dBm at 1m
+#define PATH_LOSS_EXPONENT          3.0
+#define EARTH_RADIUS                6371000.0
+
+struct ApDbHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t count;
+} __attribute__((packed));
+
+struct ApDbRecord {
+    uint64_t bssid;
+    int32_t latitudeE6;
+    int32_t longitudeE6;
+    float weight;
+    uint32_t lastSeen;
+    uint16_t samples;
+    uint16_t spread;
+    int8_t minSignal;
+    int8_t maxSignal;
+} __attribute__((packed));
+
+static double distanceMeters(double lat1, double lng1, double lat2, double lng2) {
+    double x = (lng2 - lng1) * M_PI / 180.0 * cos((lat1 + lat2) * M_PI / 360.0);
+    double y = (lat2 - lat1) * M_PI / 180.0;
+
+    return sqrt(x * x + y * y) * EARTH_RADIUS;
+}
+
+static double signalToDistance(int signal) {
+    return pow(10.0, (PATH_LOSS_REF_SIGNAL - signal) / (10.0 * PATH_LOSS_EXPONENT));
+}
+
+static double signalWeight(int signal) {
+    return pow(10.0, signal / 20.0);
+}
+
+AccessPointDatabase::AccessPointDatabase(const char *path, size_t capacity) :
+        mPath(path ? path : ""),
+        mCapacity(capacity),
+        mDirty(false) {
+    memset(&mStats, 0x00, sizeof(mStats));
+}
+
+void AccessPointDatabase::evictOldest() {
+    if (mLru.empty())
+        return;
+
+    mRecords.erase(mLru.back());
+    mLru.pop_back();
+    mStats.evictions++;
+}
+
+void AccessPointDatabase::train(const WifiScan &scan, double latitude, double longitude, double accuracy) {
+    uint32_t now = g_get_real_time() / G_USEC_PER_SEC;
+
+    if (scan.empty() || mCapacity == 0)
+        return;
+
+    accuracy = std::max(accuracy, APDB_MIN_SAMPLE_ACCURACY);
+
+    for (const WifiAccessPoint &ap : scan) {
+        double weight = signalWeight(ap.signal) / accuracy;
+        auto it = mRecords.find(ap.bssid);
+
+        if (it == mRecords.end()) {
+            if (mRecords.size() >= mCapacity)
+                evictOldest();
+
+            ApRecord record;
+            record.latitude = latitude;
+            record.longitude = longitude;
+            record.weight = weight;
+            record.lastSeen = now;
+            record.samples = 1;
+            record.spread = std::min<double>(accuracy, APDB_MAX_SPREAD);
+            record.minSignal = std::max(ap.signal, -128);
+            record.maxSignal = std::min(ap.signal, 127);
+            mLru.push_front(ap.bssid);
+            record.lru = mLru.begin();
+            mRecords[ap.bssid] = record;
+        } else {
+            ApRecord &record = it->second;
+            double total = record.weight + weight;
+            double distance;
+
+            record.latitude = (record.latitude * record.weight + latitude * weight) / total;
+            record.longitude = (record.longitude * record.weight + longitude * weight) / total;
+            // weights scale with signal and accuracy, so the cap is relative to this sample
+            record.weight = std::min(total, weight * APDB_MAX_SAMPLE_WEIGHTS);
+
+            distance = distanceMeters(record.latitude, record.longitude, latitude, longitude) + accuracy;
+            record.spread = std::min<double>(std::max<double>(record.spread, distance), APDB_MAX_SPREAD);
+            record.minSignal = std::max(std::min<int>(record.minSignal, ap.signal), -128);
+            record.maxSignal = std::min(std::max<int>(record.maxSignal, ap.signal), 127);
+            record.lastSeen = now;
+            mLru.splice(mLru.begin(), mLru, record.lru);
+
+            if (record.samples < UINT16_MAX)
+                record.samples++;
+        }
+
+        mStats.trainedSamples++;
+    }
+
+    mStats.trainedScans++;
+    mDirty = true;
+}
+
+int AccessPointDatabase::locate(const WifiScan &scan, int minAccessPoints, double *latitude, double *longitude,
+                                double *accuracy) {
+    double weightSum = 0;
+    double latSum = 0;
+    double lngSum = 0;
+    double errorSum = 0;
+    int used = 0;
+
+    for (const WifiAccessPoint &ap : scan) {
+        auto it = mRecords.find(ap.bssid);
+
+        if (it == mRecords.end())
+            continue;
+
+        const ApRecord &record = it->second;
+        double range = signalToDistance(ap.signal);
+        double weight = 1.0 / (range * range);
+
+        latSum += record.latitude * weight;
+        lngSum += record.longitude * weight;
+        errorSum += (range + record.spread) * weight;
+        weightSum += weight;
+        used++;
+    }
+
+    if (used == 0 || weightSum <= 0) {
+        mStats.localFailures++;
+        return 0;
+    }
+
+    // the caller falls back to the network, no request is saved
+    if (used < minAccessPoints) {
+        mStats.localFailures++;
+        return used;
+    }
+
+    *latitude = latSum / weightSum;
+    *longitude = lngSum / weightSum;
+    *accuracy = std::max(errorSum / weightSum, APDB_MIN_FIX_ACCURACY);
+    mStats.localFixes++;
+
+    return used;
+}
+
+void AccessPointDatabase::getStats(AccessPointDatabaseStats *stats) {
+    if (!stats)
+        return;
+
+    *stats = mStats;
+    stats->accessPoints = mRecords.size();
+}
+
+bool AccessPointDatabase::load() {
+    FILE *fp = NULL;
+    ApDbHeader header;
+    ApDbRecord diskRecord;
+    std::vector<std::pair<uint32_t, uint64_t>> order;
+
+    if (mPath.empty() || (fp = fopen(mPath.c_str(), "rb")) == NULL)
+        return false;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        header.magic != APDB_MAGIC ||
+        header.version != APDB_VERSION ||
+        header.recordSize != sizeof(ApDbRecord)) {
+        LS_LOG_ERROR("invalid access point database %s", mPath.c_str());
+        fclose(fp);
+        return false;
+    }
+
+    mRecords.clear();
+    mLru.clear();
+    mRecords.reserve(std::min<size_t>(header.count, mCapacity));
+
+    for (uint32_t i = 0; i < header.count && mRecords.size() < mCapacity; i++) {
+        if (fread(&diskRecord, sizeof(diskRecord), 1, fp) != 1)
+            break;
+
+        if (mRecords.count(diskRecord.bssid))
+            continue;
+
+        ApRecord &record = mRecords[diskRecord.bssid];
+        record.latitude = diskRecord.latitudeE6 / 1e6;
+        record.longitude = diskRecord.longitudeE6 / 1e6;
+        record.weight = diskRecord.weight;
+        record.lastSeen = diskRecord.lastSeen;
+        record.samples = diskRecord.samples;
+        record.spread = diskRecord.spread;
+        record.minSignal = diskRecord.minSignal;
+        record.maxSignal = diskRecord.maxSignal;
+        order.push_back(std::make_pair(record.lastSeen, (uint64_t) diskRecord.bssid));
+    }
+
+    fclose(fp);
+
+    // rebuild the eviction order, oldest at the back
+    std::sort(order.begin(), order.end());
+
+    for (const auto &entry : order) {
+        mLru.push_front(entry.second);
+        mRecords[entry.second].lru = mLru.begin();
+    }
+
+    mDirty = false;
+
+    LS_LOG_INFO("loaded %zu access points from %s", mRecords.size(), mPath.c_str());
+
+    return true;
+}
+
+bool AccessPointDatabase::save(size_t *written) {
+    FILE *fp = NULL;
+    ApDbHeader header;
+    ApDbRecord diskRecord;
+    std::string tmpPath = mPath + ".tmp";
+    bool ret = true;
+    long size = 0;
+
+    if (written)
+        *written = 0;
+
+    if (!mDirty || mPath.empty())
+        return true;
+
+    if ((fp = fopen(tmpPath.c_str(), "wb")) == NULL) {
+        LS_LOG_ERROR("failed to open %s", tmpPath.c_str());
+        return false;
+    }
+
+    header.magic = APDB_MAGIC;
+    header.version = APDB_VERSION;
+    header.recordSize = sizeof(ApDbRecord);
+    header.count = mRecords.size();
+
+    if (fwrite(&header, sizeof(header), 1, fp) != 1)
+        ret = false;
+
+    for (auto it = mRecords.begin(); ret && it != mRecords.end(); ++it) {
+        diskRecord.bssid = it->first;
+        diskRecord.latitudeE6 = (int32_t) lround(it->second.latitude * 1e6);
+        diskRecord.longitudeE6 = (int32_t) lround(it->second.longitude * 1e6);
+        diskRecord.weight = it->second.weight;
+        diskRecord.lastSeen = it->second.lastSeen;
+        diskRecord.samples = it->second.samples;
+        diskRecord.spread = it->second.spread;
+        diskRecord.minSignal = it->second.minSignal;
+        diskRecord.maxSignal = it->second.maxSignal;
+
+        if (fwrite(&diskRecord, sizeof(diskRecord), 1, fp) != 1)
+            ret = false;
+    }
+
+    // the rename must not reach flash before the data does
+    size = ftell(fp);
+
+    if (ret && (fflush(fp) != 0 || fsync(fileno(fp)) != 0))
+        ret = false;
+
+    if (fclose(fp) != 0)
+        ret = false;
+
+    if (!ret || rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+        LS_LOG_ERROR("failed to write %s", mPath.c_str());
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    if (written && size > 0)
+        *written = size;
+
+    mDirty = false;
+    return true;
+}
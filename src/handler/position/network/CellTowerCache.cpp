@@ -0,0 +1,240 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <glib.h>
+#include <loc_log.h>
+#include <CellTowerCache.h>
+
+#define CELL_CACHE_MAGIC            "CTC1"
+#define CELL_GPS_MIN_ACCURACY       500.0       // a GPS fix only tells where in the cell coverage we were
+#define CELL_GPS_MAX_SAMPLES        100
+#define EARTH_RADIUS                6371000.0
+
+static double distanceMeters(double lat1, double lng1, double lat2, double lng2) {
+    double x = (lng2 - lng1) * M_PI / 180.0 * cos((lat1 + lat2) * M_PI / 360.0);
+    double y = (lat2 - lat1) * M_PI / 180.0;
+
+    return sqrt(x * x + y * y) * EARTH_RADIUS;
+}
+
+CellTowerCache::CellTowerCache(const char *path, size_t capacity, int64_t ttlMs) :
+        mPath(path ? path : ""),
+        mCapacity(capacity),
+        mTtlMs(ttlMs),
+        mDirty(false) {
+    memset(&mStats, 0x00, sizeof(mStats));
+}
+
+void CellTowerCache::makeRoom() {
+    while (!mEntries.empty() && mEntries.size() >= mCapacity) {
+        auto victim = mEntries.begin();
+
+        for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+            if (it->second.lastUsed < victim->second.lastUsed)
+                victim = it;
+        }
+
+        mEntries.erase(victim);
+        mStats.evictions++;
+    }
+}
+
+bool CellTowerCache::lookup(const CellTowerKey &key, double *latitude, double *longitude, double *accuracy) {
+    int64_t now = g_get_real_time() / 1000;
+    auto it = mEntries.find(key);
+
+    if (it == mEntries.end()) {
+        mStats.misses++;
+        return false;
+    }
+
+    if (now - it->second.timestamp > mTtlMs) {
+        mEntries.erase(it);
+        mDirty = true;
+        mStats.expired++;
+        mStats.misses++;
+        return false;
+    }
+
+    it->second.lastUsed = now;
+    *latitude = it->second.latitude;
+    *longitude = it->second.longitude;
+    *accuracy = it->second.accuracy;
+    mStats.hits++;
+
+    return true;
+}
+
+void CellTowerCache::insertNetworkPosition(const CellTowerKey &key, double latitude, double longitude,
+                                           double accuracy) {
+    int64_t now = g_get_real_time() / 1000;
+    auto it = mEntries.find(key);
+
+    if (mCapacity == 0)
+        return;
+
+    if (it == mEntries.end()) {
+        makeRoom();
+        it = mEntries.insert(std::make_pair(key, Entry())).first;
+    }
+
+    it->second.latitude = latitude;
+    it->second.longitude = longitude;
+    it->second.accuracy = accuracy;
+    it->second.timestamp = now;
+    it->second.lastUsed = now;
+    it->second.samples = 0;
+
+    mStats.networkFills++;
+    mDirty = true;
+}
+
+void CellTowerCache::addGpsSample(const CellTowerKey &key, double latitude, double longitude, double accuracy) {
+    int64_t now = g_get_real_time() / 1000;
+    auto it = mEntries.find(key);
+
+    if (mCapacity == 0)
+        return;
+
+    if (it == mEntries.end()) {
+        makeRoom();
+        Entry entry;
+        entry.latitude = latitude;
+        entry.longitude = longitude;
+        entry.accuracy = std::max(accuracy, CELL_GPS_MIN_ACCURACY);
+        entry.timestamp = now;
+        entry.lastUsed = now;
+        entry.samples = 1;
+        mEntries[key] = entry;
+    } else if (it->second.samples == 0 && now - it->second.timestamp <= mTtlMs) {
+        // a fresh web service position is better than the coverage centroid
+        return;
+    } else {
+        Entry &entry = it->second;
+        uint32_t samples = std::min<uint32_t>(entry.samples, CELL_GPS_MAX_SAMPLES);
+        double distance;
+
+        entry.latitude = (entry.latitude * samples + latitude) / (samples + 1);
+        entry.longitude = (entry.longitude * samples + longitude) / (samples + 1);
+        distance = distanceMeters(entry.latitude, entry.longitude, latitude, longitude);
+        entry.accuracy = std::max(std::max(entry.accuracy, distance + accuracy), CELL_GPS_MIN_ACCURACY);
+        entry.timestamp = now;
+        entry.samples = samples + 1;
+    }
+
+    mStats.gpsFills++;
+    mDirty = true;
+}
+
+void CellTowerCache::getStats(CellTowerCacheStats *stats) {
+    if (!stats)
+        return;
+
+    *stats = mStats;
+    stats->entries = mEntries.size();
+}
+
+/*
+ * File format, one cell per line:
+ * <mcc> <mnc> <lac> <cid> <latitude> <longitude> <accuracy> <timestamp> <lastUsed> <samples>
+ */
+bool CellTowerCache::load() {
+    FILE *fp = NULL;
+    char magic[8] = {0};
+    int64_t now = g_get_real_time() / 1000;
+    unsigned int mcc, mnc;
+    CellTowerKey key;
+    Entry entry;
+
+    if (mPath.empty() || (fp = fopen(mPath.c_str(), "r")) == NULL)
+        return false;
+
+    if (fscanf(fp, "%7s", magic) != 1 || strcmp(magic, CELL_CACHE_MAGIC) != 0) {
+        LS_LOG_ERROR("invalid cell cache file %s", mPath.c_str());
+        fclose(fp);
+        return false;
+    }
+
+    while (fscanf(fp, "%u %u %" SCNu32 " %" SCNu64 " %lf %lf %lf %" SCNd64 " %" SCNd64 " %" SCNu32,
+                  &mcc, &mnc, &key.lac, &key.cid, &entry.latitude, &entry.longitude, &entry.accuracy,
+                  &entry.timestamp, &entry.lastUsed, &entry.samples) == 10) {
+        if (now - entry.timestamp > mTtlMs)
+            continue;
+
+        key.mcc = mcc;
+        key.mnc = mnc;
+
+        makeRoom();
+        mEntries[key] = entry;
+    }
+
+    fclose(fp);
+    mDirty = false;
+
+    LS_LOG_INFO("loaded %zu cells from %s", mEntries.size(), mPath.c_str());
+
+    return true;
+}
+
+bool CellTowerCache::save(size_t *written) {
+    FILE *fp = NULL;
+    std::string tmpPath = mPath + ".tmp";
+    long size = 0;
+    bool synced = false;
+
+    if (written)
+        *written = 0;
+
+    if (!mDirty || mPath.empty())
+        return true;
+
+    if ((fp = fopen(tmpPath.c_str(), "w")) == NULL) {
+        LS_LOG_ERROR("failed to open %s", tmpPath.c_str());
+        return false;
+    }
+
+    fprintf(fp, "%s\n", CELL_CACHE_MAGIC);
+
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+        fprintf(fp, "%u %u %" PRIu32 " %" PRIu64 " %.7f %.7f %f %" PRId64 " %" PRId64 " %" PRIu32 "\n",
+                it->first.mcc, it->first.mnc, it->first.lac, it->first.cid,
+                it->second.latitude, it->second.longitude, it->second.accuracy,
+                it->second.timestamp, it->second.lastUsed, it->second.samples);
+    }
+
+    // the rename must not reach flash before the data does
+    size = ftell(fp);
+    synced = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+
+    if (fclose(fp) != 0 || !synced || rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+        LS_LOG_ERROR("failed to write %s", mPath.c_str());
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    if (written && size > 0)
+        *written = size;
+
+    mDirty = false;
+    return true;
+}
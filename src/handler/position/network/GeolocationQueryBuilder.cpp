@@ -0,0 +1,115 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <GeolocationQueryBuilder.h>
+
+#define QUERY_BUFFER_INITIAL_SIZE    4096
+
+static const char hexDigits[] = "0123456789abcdef";
+
+GeolocationQueryBuilder::GeolocationQueryBuilder() : mMembers(0), mItems(0) {
+    mBuffer = g_string_sized_new(QUERY_BUFFER_INITIAL_SIZE);
+}
+
+GeolocationQueryBuilder::~GeolocationQueryBuilder() {
+    g_string_free(mBuffer, TRUE);
+}
+
+void GeolocationQueryBuilder::begin() {
+    g_string_truncate(mBuffer, 0);
+    g_string_append_c(mBuffer, '{');
+    mMembers = 0;
+    mItems = 0;
+}
+
+void GeolocationQueryBuilder::appendString(const char *value) {
+    g_string_append_c(mBuffer, '"');
+
+    for (const unsigned char *p = (const unsigned char *) value; *p; p++) {
+        switch (*p) {
+            case '"':
+                g_string_append(mBuffer, "\\\"");
+                break;
+            case '\\':
+                g_string_append(mBuffer, "\\\\");
+                break;
+            case '\b':
+                g_string_append(mBuffer, "\\b");
+                break;
+            case '\f':
+                g_string_append(mBuffer, "\\f");
+                break;
+            case '\n':
+                g_string_append(mBuffer, "\\n");
+                break;
+            case '\r':
+                g_string_append(mBuffer, "\\r");
+                break;
+            case '\t':
+                g_string_append(mBuffer, "\\t");
+                break;
+            default:
+                if (*p < 0x20) {
+                    g_string_append(mBuffer, "\\u00");
+                    g_string_append_c(mBuffer, hexDigits[*p >> 4]);
+                    g_string_append_c(mBuffer, hexDigits[*p & 0x0f]);
+                } else {
+                    g_string_append_c(mBuffer, *p);
+                }
+        }
+    }
+
+    g_string_append_c(mBuffer, '"');
+}
+
+void GeolocationQueryBuilder::appendName(const char *name) {
+    if (mMembers++ > 0)
+        g_string_append_c(mBuffer, ',');
+
+    appendString(name);
+    g_string_append_c(mBuffer, ':');
+}
+
+void GeolocationQueryBuilder::appendRawMember(const char *name, const char *value) {
+    appendName(name);
+    g_string_append(mBuffer, value);
+}
+
+void GeolocationQueryBuilder::beginArray(const char *name) {
+    appendName(name);
+    g_string_append_c(mBuffer, '[');
+    mItems = 0;
+}
+
+void GeolocationQueryBuilder::appendAccessPoint(const char *macAddress, int signalStrength) {
+    if (mItems++ > 0)
+        g_string_append_c(mBuffer, ',');
+
+    g_string_append(mBuffer, "{\"macAddress\":");
+    appendString(macAddress);
+    g_string_append_printf(mBuffer, ",\"signalStrength\":%d}", signalStrength);
+}
+
+void GeolocationQueryBuilder::endArray() {
+    g_string_append_c(mBuffer, ']');
+}
+
+const char *GeolocationQueryBuilder::finish() {
+    g_string_append_c(mBuffer, '}');
+    return mBuffer->str;
+}
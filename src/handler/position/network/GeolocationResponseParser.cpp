@@ -0,0 +1,329 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GeolocationResponseParser.h>
+
+#define MAX_NESTING_DEPTH    32
+
+#define FIELD_LATITUDE       0x01
+#define FIELD_LONGITUDE      0x02
+#define FIELD_ACCURACY       0x04
+#define FIELD_ALL            (FIELD_LATITUDE | FIELD_LONGITUDE | FIELD_ACCURACY)
+
+typedef struct _ResponseScanner {
+    const char *p;
+    unsigned int fields;
+    bool sawError;
+    double latitude;
+    double longitude;
+    double accuracy;
+} ResponseScanner;
+
+static bool scanValue(ResponseScanner *s, int depth);
+
+static void skipWhitespace(ResponseScanner *s) {
+    while (*s->p == ' ' || *s->p == '\t' || *s->p == '\n' || *s->p == '\r')
+        s->p++;
+}
+
+static bool isHex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// on success start/len describe the raw contents, escaped tells whether they need decoding
+static bool scanString(ResponseScanner *s, const char **start, size_t *len, bool *escaped) {
+    if (*s->p != '"')
+        return false;
+
+    const char *begin = ++s->p;
+    bool hasEscape = false;
+
+    while (*s->p != '"') {
+        unsigned char c = (unsigned char) *s->p;
+
+        if (c == '\0' || c < 0x20)
+            return false;
+
+        if (c == '\\') {
+            hasEscape = true;
+            s->p++;
+
+            if (*s->p == 'u') {
+                for (int i = 1; i <= 4; i++) {
+                    if (!isHex(s->p[i]))
+                        return false;
+                }
+                s->p += 4;
+            } else if (!strchr("\"\\/bfnrt", *s->p) || *s->p == '\0') {
+                return false;
+            }
+        }
+
+        s->p++;
+    }
+
+    if (start)
+        *start = begin;
+
+    if (len)
+        *len = s->p - begin;
+
+    if (escaped)
+        *escaped = hasEscape;
+
+    s->p++;
+    return true;
+}
+
+static bool scanNumber(ResponseScanner *s, double *value) {
+    const char *begin = s->p;
+
+    if (*s->p == '-')
+        s->p++;
+
+    if (*s->p == '0') {
+        s->p++;
+    } else if (*s->p >= '1' && *s->p <= '9') {
+        while (*s->p >= '0' && *s->p <= '9')
+            s->p++;
+    } else {
+        return false;
+    }
+
+    if (*s->p == '.') {
+        s->p++;
+
+        if (!(*s->p >= '0' && *s->p <= '9'))
+            return false;
+
+        while (*s->p >= '0' && *s->p <= '9')
+            s->p++;
+    }
+
+    if (*s->p == 'e' || *s->p == 'E') {
+        s->p++;
+
+        if (*s->p == '+' || *s->p == '-')
+            s->p++;
+
+        if (!(*s->p >= '0' && *s->p <= '9'))
+            return false;
+
+        while (*s->p >= '0' && *s->p <= '9')
+            s->p++;
+    }
+
+    // the span is a valid JSON number, so strtod stops exactly at its end
+    if (value)
+        *value = strtod(begin, NULL);
+
+    return true;
+}
+
+static bool scanLiteral(ResponseScanner *s, const char *literal) {
+    size_t len = strlen(literal);
+
+    if (strncmp(s->p, literal, len) != 0)
+        return false;
+
+    s->p += len;
+    return true;
+}
+
+static bool keyEquals(const char *key, size_t len, bool escaped, const char *name) {
+    return !escaped && len == strlen(name) && memcmp(key, name, len) == 0;
+}
+
+// calls member() for each key with the scanner positioned on the value
+template<typename F>
+static bool scanObject(ResponseScanner *s, int depth, F member) {
+    const char *key;
+    size_t len;
+    bool escaped;
+
+    if (*s->p != '{' || depth > MAX_NESTING_DEPTH)
+        return false;
+
+    s->p++;
+    skipWhitespace(s);
+
+    if (*s->p == '}') {
+        s->p++;
+        return true;
+    }
+
+    while (true) {
+        skipWhitespace(s);
+
+        if (!scanString(s, &key, &len, &escaped))
+            return false;
+
+        skipWhitespace(s);
+
+        if (*s->p != ':')
+            return false;
+
+        s->p++;
+        skipWhitespace(s);
+
+        if (!member(key, len, escaped))
+            return false;
+
+        skipWhitespace(s);
+
+        if (*s->p == ',') {
+            s->p++;
+            continue;
+        }
+
+        if (*s->p == '}') {
+            s->p++;
+            return true;
+        }
+
+        return false;
+    }
+}
+
+static bool scanArray(ResponseScanner *s, int depth) {
+    if (*s->p != '[' || depth > MAX_NESTING_DEPTH)
+        return false;
+
+    s->p++;
+    skipWhitespace(s);
+
+    if (*s->p == ']') {
+        s->p++;
+        return true;
+    }
+
+    while (true) {
+        skipWhitespace(s);
+
+        if (!scanValue(s, depth + 1))
+            return false;
+
+        skipWhitespace(s);
+
+        if (*s->p == ',') {
+            s->p++;
+            continue;
+        }
+
+        if (*s->p == ']') {
+            s->p++;
+            return true;
+        }
+
+        return false;
+    }
+}
+
+static bool scanValue(ResponseScanner *s, int depth) {
+    switch (*s->p) {
+        case '{':
+            return scanObject(s, depth + 1, [s, depth](const char *, size_t, bool) {
+                return scanValue(s, depth + 1);
+            });
+        case '[':
+            return scanArray(s, depth + 1);
+        case '"':
+            return scanString(s, NULL, NULL, NULL);
+        case 't':
+            return scanLiteral(s, "true");
+        case 'f':
+            return scanLiteral(s, "false");
+        case 'n':
+            return scanLiteral(s, "null");
+        default:
+            return scanNumber(s, NULL);
+    }
+}
+
+// a member we want is only taken when it is a plain, finite number, anything else is skipped
+static bool scanField(ResponseScanner *s, int depth, unsigned int field, double *value) {
+    if (*s->p == '-' || (*s->p >= '0' && *s->p <= '9')) {
+        if (!scanNumber(s, value))
+            return false;
+
+        if (isfinite(*value))
+            s->fields |= field;
+
+        return true;
+    }
+
+    return scanValue(s, depth);
+}
+
+GeoResponseResult geolocationResponseExtract(const char *body, double *latitude, double *longitude,
+                                             double *accuracy) {
+    ResponseScanner s;
+    bool wellFormed;
+
+    if (!body)
+        return GEO_RESPONSE_MALFORMED;
+
+    memset(&s, 0x00, sizeof(s));
+    s.p = body;
+    skipWhitespace(&s);
+
+    wellFormed = scanObject(&s, 1, [&s](const char *key, size_t len, bool escaped) {
+        if (keyEquals(key, len, escaped, "accuracy"))
+            return scanField(&s, 1, FIELD_ACCURACY, &s.accuracy);
+
+        if (keyEquals(key, len, escaped, "error"))
+            s.sawError = true;
+
+        if (keyEquals(key, len, escaped, "location") && *s.p == '{') {
+            return scanObject(&s, 2, [&s](const char *key, size_t len, bool escaped) {
+                if (keyEquals(key, len, escaped, "lat"))
+                    return scanField(&s, 2, FIELD_LATITUDE, &s.latitude);
+
+                if (keyEquals(key, len, escaped, "lng"))
+                    return scanField(&s, 2, FIELD_LONGITUDE, &s.longitude);
+
+                return scanValue(&s, 2);
+            });
+        }
+
+        return scanValue(&s, 1);
+    });
+
+    if (wellFormed) {
+        skipWhitespace(&s);
+        wellFormed = (*s.p == '\0');
+    }
+
+    if (!wellFormed)
+        return GEO_RESPONSE_MALFORMED;
+
+    if (s.sawError)
+        return GEO_RESPONSE_ERROR_BODY;
+
+    if ((s.fields & FIELD_ALL) != FIELD_ALL)
+        return GEO_RESPONSE_INCOMPLETE;
+
+    *latitude = s.latitude;
+    *longitude = s.longitude;
+    *accuracy = s.accuracy;
+
+    return GEO_RESPONSE_OK;
+}
@@ -15,10 +15,12 @@
 // SPDX-License-Identifier: Apache-2.0
 
 
+#include <algorithm>
 #include <loc-utils/loc_security.h>
 #include "NetworkPositionProvider.h"
 #include "Gps_stored_data.h"
 #include "MockLocation.h"
+#include "GeolocationResponseParser.h"
 
 #define NETWORK_URL network_location_provider_url("https://www.googleapis.com/geolocation/v1/geolocate?key=%s")
 #define SIGNAL_CHANGE_THRESHOLD                20
@@ -27,12 +29,61 @@
 #define WIFI_SERVICE                           "com.webos.service.wifi"
 #define TELEPHONY_SERVICE                      "com.webos.service.telephony"
 #define GEOLOCKEY_CONFIG_PATH                  "/etc/geolocation.conf"
+#define BACKENDS_CONFIG_PATH                   "/etc/location/geolocationBackends.conf"
 #define SCAN_METHOD                            "luna://com.webos.service.wifi/scan"
 #define SCAN_PAYLOAD                           "{}"
+#define FINGERPRINT_CACHE_CAPACITY             128
+#define FINGERPRINT_CACHE_TTL_MS               (12 * 60 * 60 * 1000LL)
+#define FINGERPRINT_FUZZY_THRESHOLD            0.7
+#define AP_DATABASE_CAPACITY                   4096
+#define AP_TRAINING_MAX_ACCURACY               50.0
+#define AP_TRAINING_MAX_SCAN_AGE_US            (10 * G_USEC_PER_SEC)
+#define AP_LOCAL_MAX_SCAN_AGE_US               (120 * G_USEC_PER_SEC)
+#define AP_LOCAL_CONFIDENT_APS                 3
+#define CELL_CACHE_CAPACITY                    512
+#define CELL_CACHE_TTL_MS                      (7 * 24 * 60 * 60 * 1000LL)
+#define CACHE_SAVE_MIN_INTERVAL_US             (30 * 60 * G_USEC_PER_SEC)
+#define GPS_FEED_MAX_ACCURACY                  100.0
+#define GPS_FEED_MAX_AGE_MS                    10000
+#define NETWORK_QUERY_TIMEOUT_MS               15000
+#define NETWORK_QUERY_MAX_RETRIES              1
+
+typedef struct _ApTrainingData {
+    NetworkPositionProvider *provider;
+    double latitude;
+    double longitude;
+    double accuracy;
+    double speed;
+    int64_t time;
+} ApTrainingData;
 
 NetworkPositionProvider::NetworkPositionProvider(LSHandle *sh) : PositionProviderInterface("Network"),
                                                                  mNetworkData(sh),
-                                                                 mScanToken(LSMESSAGE_TOKEN_INVALID) {
+                                                                 mScanToken(LSMESSAGE_TOKEN_INVALID),
+                                                                 mFingerprintCache(LOCATION_WIFI_FINGERPRINT_PATH,
+                                                                                   FINGERPRINT_CACHE_CAPACITY,
+                                                                                   FINGERPRINT_CACHE_TTL_MS,
+                                                                                   FINGERPRINT_FUZZY_THRESHOLD),
+                                                                 mQueryStartTime(0),
+                                                                 mApDatabase(LOCATION_AP_DATABASE_PATH,
+                                                                             AP_DATABASE_CAPACITY),
+                                                                 mLastScanTime(0),
+                                                                 mTrainedScanTime(0),
+                                                                 mCellCache(LOCATION_CELL_CACHE_PATH,
+                                                                            CELL_CACHE_CAPACITY,
+                                                                            CELL_CACHE_TTL_MS),
+                                                                 mServingCellValid(false),
+                                                                 mCellQueryPending(false),
+                                                                 mCellDataTime(0),
+                                                                 mLastCacheSave(0),
+                                                                 mLastCacheSaveBytes(0),
+                                                                 mQueryId(0),
+                                                                 mAnsweredQueryId(0),
+                                                                 mHedgeTimerId(0),
+                                                                 mGpsFeedActive(false),
+                                                                 mGpsFeedTimerId(0),
+                                                                 mGpsFedFixes(0),
+                                                                 mFixPending(false) {
     mwifiStatus = false;
     mtelephonyPowerd = false;
     mEnabled = false;
@@ -45,6 +96,300 @@ NetworkPositionProvider::NetworkPositionProvider(LSHandle *sh) : PositionProvide
     mConnectivityStatus = false;
     misFirstCellResponse = true;
     mTimeoutId = 0;
+    mFingerprintCache.load();
+    mApDatabase.load();
+    mCellCache.load();
+    memset(&mServingCell, 0x00, sizeof(mServingCell));
+    memset(&mLastFix, 0x00, sizeof(mLastFix));
+}
+
+NetworkPositionProvider::~NetworkPositionProvider() {
+    cancelBackendQueries();
+    saveCaches(true);
+}
+
+static bool appendWifiCacheStats(jvalue_ref parent, const WifiFingerprintCacheStats &stats) {
+    jvalue_ref object = jobject_create();
+
+    if (jis_null(object))
+        return false;
+
+    jobject_put(object, J_CSTR_TO_JVAL("lookups"), jnumber_create_i64(stats.lookups));
+    jobject_put(object, J_CSTR_TO_JVAL("exactHits"), jnumber_create_i64(stats.exactHits));
+    jobject_put(object, J_CSTR_TO_JVAL("fuzzyHits"), jnumber_create_i64(stats.fuzzyHits));
+    jobject_put(object, J_CSTR_TO_JVAL("misses"), jnumber_create_i64(stats.misses));
+    jobject_put(object, J_CSTR_TO_JVAL("expired"), jnumber_create_i64(stats.expired));
+    jobject_put(object, J_CSTR_TO_JVAL("evictions"), jnumber_create_i64(stats.evictions));
+    jobject_put(object, J_CSTR_TO_JVAL("entries"), jnumber_create_i64(stats.entries));
+    jobject_put(object, J_CSTR_TO_JVAL("hitRate"),
+                jnumber_create_f64(stats.lookups ? (double) (stats.exactHits + stats.fuzzyHits) / stats.lookups : 0));
+    jobject_put(object, J_CSTR_TO_JVAL("avgRoundTripMs"), jnumber_create_f64(stats.avgRoundTripMs));
+    jobject_put(object, J_CSTR_TO_JVAL("latencySavedMs"), jnumber_create_f64(stats.latencySavedMs));
+    jobject_put(parent, J_CSTR_TO_JVAL("wifiFingerprintCache"), object);
+
+    return true;
+}
+
+static bool appendApDatabaseStats(jvalue_ref parent, const AccessPointDatabaseStats &stats) {
+    jvalue_ref object = jobject_create();
+
+    if (jis_null(object))
+        return false;
+
+    jobject_put(object, J_CSTR_TO_JVAL("accessPoints"), jnumber_create_i64(stats.accessPoints));
+    jobject_put(object, J_CSTR_TO_JVAL("trainedScans"), jnumber_create_i64(stats.trainedScans));
+    jobject_put(object, J_CSTR_TO_JVAL("trainedSamples"), jnumber_create_i64(stats.trainedSamples));
+    jobject_put(object, J_CSTR_TO_JVAL("localFixes"), jnumber_create_i64(stats.localFixes));
+    jobject_put(object, J_CSTR_TO_JVAL("localFailures"), jnumber_create_i64(stats.localFailures));
+    jobject_put(object, J_CSTR_TO_JVAL("evictions"), jnumber_create_i64(stats.evictions));
+    jobject_put(parent, J_CSTR_TO_JVAL("apDatabase"), object);
+
+    return true;
+}
+
+static bool appendCellCacheStats(jvalue_ref parent, const CellTowerCacheStats &stats) {
+    jvalue_ref object = jobject_create();
+
+    if (jis_null(object))
+        return false;
+
+    jobject_put(object, J_CSTR_TO_JVAL("hits"), jnumber_create_i64(stats.hits));
+    jobject_put(object, J_CSTR_TO_JVAL("misses"), jnumber_create_i64(stats.misses));
+    jobject_put(object, J_CSTR_TO_JVAL("expired"), jnumber_create_i64(stats.expired));
+    jobject_put(object, J_CSTR_TO_JVAL("evictions"), jnumber_create_i64(stats.evictions));
+    jobject_put(object, J_CSTR_TO_JVAL("networkFills"), jnumber_create_i64(stats.networkFills));
+    jobject_put(object, J_CSTR_TO_JVAL("gpsFills"), jnumber_create_i64(stats.gpsFills));
+    jobject_put(object, J_CSTR_TO_JVAL("entries"), jnumber_create_i64(stats.entries));
+    jobject_put(parent, J_CSTR_TO_JVAL("cellCache"), object);
+
+    return true;
+}
+
+static bool appendScanStats(jvalue_ref parent, const NetworkScanStats &stats) {
+    jvalue_ref object = jobject_create();
+
+    if (jis_null(object))
+        return false;
+
+    jobject_put(object, J_CSTR_TO_JVAL("scans"), jnumber_create_i64(stats.scans));
+    jobject_put(object, J_CSTR_TO_JVAL("httpRequests"), jnumber_create_i64(stats.httpRequests));
+    jobject_put(object, J_CSTR_TO_JVAL("unchangedScans"), jnumber_create_i64(stats.unchangedScans));
+    jobject_put(object, J_CSTR_TO_JVAL("intervalMs"), jnumber_create_i64(stats.intervalMs));
+    jobject_put(object, J_CSTR_TO_JVAL("deliveredFixes"), jnumber_create_i64(stats.deliveredFixes));
+    jobject_put(object, J_CSTR_TO_JVAL("lastStalenessMs"), jnumber_create_i64(stats.lastStalenessMs));
+    jobject_put(object, J_CSTR_TO_JVAL("avgStalenessMs"), jnumber_create_i64(stats.avgStalenessMs));
+    jobject_put(object, J_CSTR_TO_JVAL("maxStalenessMs"), jnumber_create_i64(stats.maxStalenessMs));
+    jobject_put(object, J_CSTR_TO_JVAL("gpsFedFixes"), jnumber_create_i64(stats.gpsFedFixes));
+    jobject_put(object, J_CSTR_TO_JVAL("gpsFeedActive"), jboolean_create(stats.gpsFeedActive));
+    jobject_put(parent, J_CSTR_TO_JVAL("networkScan"), object);
+
+    return true;
+}
+
+static bool appendBackendStats(jvalue_ref parent, const std::vector<PositioningBackendStats> &stats) {
+    jvalue_ref array = jarray_create(NULL);
+
+    if (jis_null(array))
+        return false;
+
+    // put first, parent releases a partly filled array
+    jobject_put(parent, J_CSTR_TO_JVAL("positioningBackends"), array);
+
+    for (const PositioningBackendStats &backend : stats) {
+        jvalue_ref object = jobject_create();
+
+        if (jis_null(object))
+            return false;
+
+        jobject_put(object, J_CSTR_TO_JVAL("name"), jstring_create(backend.name.c_str()));
+        jobject_put(object, J_CSTR_TO_JVAL("requests"), jnumber_create_i64(backend.requests));
+        jobject_put(object, J_CSTR_TO_JVAL("hedgedRequests"), jnumber_create_i64(backend.hedgedRequests));
+        jobject_put(object, J_CSTR_TO_JVAL("successes"), jnumber_create_i64(backend.successes));
+        jobject_put(object, J_CSTR_TO_JVAL("failures"), jnumber_create_i64(backend.failures));
+        jobject_put(object, J_CSTR_TO_JVAL("wins"), jnumber_create_i64(backend.wins));
+        jobject_put(object, J_CSTR_TO_JVAL("p95LatencyMs"), jnumber_create_i64(backend.p95LatencyMs));
+        jarray_append(array, object);
+    }
+
+    return true;
+}
+
+bool NetworkPositionProvider::appendStats(jvalue_ref parent) {
+    WifiFingerprintCacheStats wifiCacheStats;
+    AccessPointDatabaseStats apDatabaseStats;
+    CellTowerCacheStats cellCacheStats;
+    NetworkScanStats scanStats;
+    std::vector<PositioningBackendStats> backendStats;
+
+    mFingerprintCache.getStats(&wifiCacheStats);
+    mApDatabase.getStats(&apDatabaseStats);
+    mCellCache.getStats(&cellCacheStats);
+    mScanScheduler.getStats(&scanStats);
+    scanStats.gpsFedFixes = mGpsFedFixes;
+    scanStats.gpsFeedActive = mGpsFeedActive;
+    mBackends.getStats(backendStats);
+
+    return appendWifiCacheStats(parent, wifiCacheStats) && appendApDatabaseStats(parent, apDatabaseStats) &&
+           appendCellCacheStats(parent, cellCacheStats) && appendScanStats(parent, scanStats) &&
+           appendBackendStats(parent, backendStats);
+}
+
+bool NetworkPositionProvider::feedFromGpsFix(int64_t timestamp, double accuracy) {
+    int64_t age = g_get_real_time() / 1000 - timestamp;
+    double maxAccuracy = GPS_FEED_MAX_ACCURACY;
+
+    if (!mProcessRequestInProgress || mMockRequestInProgress)
+        return false;
+
+    // the GPS fix has to beat what the network last delivered
+    if (mPositionData.lastAccuracy > 0 && mPositionData.lastAccuracy < maxAccuracy)
+        maxAccuracy = mPositionData.lastAccuracy;
+
+    if (accuracy <= 0 || accuracy > maxAccuracy || age > GPS_FEED_MAX_AGE_MS || age < -GPS_FEED_MAX_AGE_MS) {
+        if (mGpsFeedActive) {
+            LS_LOG_INFO("GPS fix degraded (%.1f m, %lld ms old), resuming network positioning", accuracy,
+                        (long long) age);
+            stopGpsFeed(true);
+        }
+        return false;
+    }
+
+    if (!mGpsFeedActive) {
+        LS_LOG_INFO("serving network subscribers from GPS, network positioning paused");
+        mGpsFeedActive = true;
+    }
+
+    // a GPS stream that stops also ends the pause
+    if (mGpsFeedTimerId)
+        g_source_remove(mGpsFeedTimerId);
+
+    mGpsFeedTimerId = g_timeout_add(GPS_FEED_MAX_AGE_MS, &gpsFeedExpired, (gpointer) this);
+    mGpsFedFixes++;
+
+    return true;
+}
+
+gboolean NetworkPositionProvider::gpsFeedExpired(gpointer data) {
+    NetworkPositionProvider *pThis = static_cast<NetworkPositionProvider *>(data);
+
+    LS_LOG_INFO("no fresh GPS fix, resuming network positioning");
+    pThis->mGpsFeedTimerId = 0;
+    pThis->stopGpsFeed(true);
+
+    return G_SOURCE_REMOVE;
+}
+
+void NetworkPositionProvider::stopGpsFeed(bool resume) {
+    if (mGpsFeedTimerId) {
+        g_source_remove(mGpsFeedTimerId);
+        mGpsFeedTimerId = 0;
+    }
+
+    if (!mGpsFeedActive)
+        return;
+
+    mGpsFeedActive = false;
+
+    if (!resume || !mProcessRequestInProgress)
+        return;
+
+    // catch up now instead of waiting for a possibly stretched scan timer
+    if (mwifiStatus)
+        requestScan();
+    else if (mtelephonyPowerd)
+        triggerPostQuery();
+
+    scheduleScan();
+}
+
+void NetworkPositionProvider::setSubscriberInterval(int intervalMs) {
+    mScanScheduler.setSubscriberInterval(intervalMs > 0 ? intervalMs : 0);
+}
+
+void NetworkPositionProvider::trainFromGpsFix(double latitude, double longitude, double accuracy, double speed) {
+    if (accuracy <= 0)
+        return;
+
+    ApTrainingData *data = g_new0(ApTrainingData, 1);
+    data->provider = this;
+    data->latitude = latitude;
+    data->longitude = longitude;
+    data->accuracy = accuracy;
+    data->speed = speed;
+    data->time = g_get_monotonic_time();
+
+    g_idle_add(trainCallback, data);
+}
+
+gboolean NetworkPositionProvider::trainCallback(gpointer data) {
+    ApTrainingData *training = (ApTrainingData *) data;
+    NetworkPositionProvider *pThis = training->provider;
+
+    // a moving device needs fresh scans, pull the next one in
+    if (pThis->mScanScheduler.onMotion(training->speed, g_get_monotonic_time()) && pThis->mTimeoutId)
+        pThis->scheduleScan();
+
+    if (training->accuracy > AP_TRAINING_MAX_ACCURACY) {
+        g_free(training);
+        return G_SOURCE_REMOVE;
+    }
+
+    TrainingFix current = {training->latitude, training->longitude, training->accuracy, training->speed,
+                           training->time};
+
+    // each scan trains once, with the fix closest to it in time: the last one
+    // before the scan or the first one after it, later fixes are further away
+    if (!pThis->mLastScan.empty() && pThis->mTrainedScanTime != pThis->mLastScanTime &&
+        current.time >= pThis->mLastScanTime) {
+        int64_t after = current.time - pThis->mLastScanTime;
+        int64_t before = pThis->mLastFix.time ? pThis->mLastScanTime - pThis->mLastFix.time : -1;
+        const TrainingFix &best = (before >= 0 && before < after) ? pThis->mLastFix : current;
+        int64_t ageUs = (&best == &current) ? after : before;
+
+        // the device must not have moved further than the fix is accurate meanwhile
+        if (ageUs <= AP_TRAINING_MAX_SCAN_AGE_US &&
+            best.speed * ageUs / G_USEC_PER_SEC <= best.accuracy)
+            pThis->mApDatabase.train(pThis->mLastScan, best.latitude, best.longitude, best.accuracy);
+
+        pThis->mTrainedScanTime = pThis->mLastScanTime;
+    }
+
+    pThis->mLastFix = current;
+
+    if (pThis->mtelephonyPowerd && pThis->mServingCellValid)
+        pThis->mCellCache.addGpsSample(pThis->mServingCell, training->latitude, training->longitude,
+                                       training->accuracy);
+
+    g_free(training);
+    return G_SOURCE_REMOVE;
+}
+
+bool NetworkPositionProvider::resolveLocally(int minAccessPoints) {
+    double latitude, longitude, accuracy;
+
+    if (!mwifiStatus || mLastScan.empty() ||
+        g_get_monotonic_time() - mLastScanTime > AP_LOCAL_MAX_SCAN_AGE_US)
+        return false;
+
+    if (mApDatabase.locate(mLastScan, minAccessPoints, &latitude, &longitude, &accuracy) < minAccessPoints)
+        return false;
+
+    LS_LOG_DEBUG("position resolved from access point database");
+    updatePosition(latitude, longitude, accuracy);
+
+    return true;
+}
+
+bool NetworkPositionProvider::resolveFromCellCache() {
+    double latitude, longitude, accuracy;
+
+    if (!mServingCellValid || !mCellCache.lookup(mServingCell, &latitude, &longitude, &accuracy))
+        return false;
+
+    LS_LOG_DEBUG("position resolved from cell tower cache");
+    updatePosition(latitude, longitude, accuracy);
+
+    return true;
 }
 
 char *NetworkPositionProvider::readApiKey() {
@@ -71,6 +416,8 @@ void NetworkPositionProvider::enable() {
     }
 
     mPositionData.nwGeolocationKey = readApiKey();
+    mBackends.setPrimary("google");
+    mBackends.load(BACKENDS_CONFIG_PATH);
 
     mEnabled = true;
 }
@@ -80,6 +427,9 @@ void NetworkPositionProvider::disable() {
 
     if (mEnabled) {
         g_source_remove(mTimeoutId);
+        cancelHedge();
+        cancelBackendQueries();
+        stopGpsFeed(false);
         setCallback(nullptr);
         mEnabled = false;
         mTimeoutId = 0;
@@ -98,6 +448,7 @@ void NetworkPositionProvider::onUpdateCellData(const char *cellData) {
     }
 
     mPositionData.cellInfo = g_strdup(cellData);
+    mCellDataTime = g_get_monotonic_time();
 
     if (misFirstCellResponse && !mwifiStatus) {
         misFirstCellResponse = false;
@@ -106,36 +457,23 @@ void NetworkPositionProvider::onUpdateCellData(const char *cellData) {
 }
 
 void NetworkPositionProvider::onUpdateWifiData(GHashTable *wifiAccessPoints) {
-    GHashTableIter iter;
-    gpointer key = NULL;
-    gpointer newValue = NULL;
-    gchar *updateKey = NULL;
-    int updateValue = 0;
-
-    if (mPositionData.wifiAccessPointsList == NULL)
-        mPositionData.wifiAccessPointsList = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                                                   (GDestroyNotify) g_free, NULL);
-    else
-        g_hash_table_remove_all(mPositionData.wifiAccessPointsList);
+    // the table belongs to NetworkData, only the packed scan is kept
+    wifiScanFromTable(wifiAccessPoints, mLastScan);
+    mLastScanTime = g_get_monotonic_time();
 
-    if (wifiAccessPoints != NULL) {
-        g_hash_table_iter_init(&iter, wifiAccessPoints);
-
-        while (g_hash_table_iter_next(&iter, &key, &newValue)) {
-            updateKey = g_strdup((const gchar *) key);
-            updateValue = GPOINTER_TO_INT(newValue);
-            g_hash_table_insert(mPositionData.wifiAccessPointsList, updateKey, GINT_TO_POINTER(updateValue));
-            LS_LOG_DEBUG("###### onUpdateWifiData New key/value: %s, %d", (char *) updateKey,
-                        GPOINTER_TO_INT(updateValue));
-        }
-
-    }
+    LS_LOG_DEBUG("onUpdateWifiData %zu access points", mLastScan.size());
 
     triggerPostQuery();
 }
 
 bool NetworkPositionProvider::triggerPostQuery() {
-    char *postData = NULL;
+    // points into mQueryBuilder, valid until the next query is built
+    const char *postData = NULL;
+
+    if (mGpsFeedActive) {
+        LS_LOG_DEBUG("network subscribers are served from GPS, no query");
+        return false;
+    }
 
     if (!mwifiStatus && mtelephonyPowerd) {
         LS_LOG_DEBUG("createCellQuery");
@@ -152,20 +490,50 @@ bool NetworkPositionProvider::triggerPostQuery() {
         postData = createCellWifiCombinedQuery();
     }
 
+    // an unchanged scan stretches the scan interval, a changed one resets it
+    if (mScanScheduler.onScanResult(postData != NULL, g_get_monotonic_time()) && mTimeoutId)
+        scheduleScan();
+
+    // an unchanged serving cell builds no query, a client still waiting for its
+    // first fix is answered from the cache all the same
+    if (!postData && mFixPending && mtelephonyPowerd && !mwifiStatus && resolveFromCellCache())
+        return true;
+
     // for tracking, no update means no need to emit signal
     if (!postData) {
         LS_LOG_ERROR("triggerPostQuery: no data to post");
         return false;
     }
 
-    if (!networkPostQuery(postData, mPositionData.nwGeolocationKey, FALSE)) {
+    mCellQueryPending = false;
+
+    if (!mwifiStatus && mServingCellValid) {
+        if (resolveFromCellCache())
+            return true;
+
+        mCellQueryPending = true;
+    }
+
+    if (mwifiStatus) {
+        double latitude, longitude, accuracy;
+
+        if (mFingerprintCache.lookup(mLastScan, &latitude, &longitude, &accuracy)) {
+            LS_LOG_DEBUG("position resolved from wifi fingerprint cache");
+            updatePosition(latitude, longitude, accuracy);
+            return true;
+        }
+
+        // offline any known access point will do, online only a well covered scan saves the request
+        if (resolveLocally(mConnectivityStatus ? AP_LOCAL_CONFIDENT_APS : 1)) {
+            return true;
+        }
+    }
+
+    if (!networkPostQuery(postData, mPositionData.nwGeolocationKey, FALSE, mwifiStatus ? mLastScan : WifiScan())) {
         LS_LOG_ERROR("Failed to post query!");
-        g_free(postData);
         return false;
     }
 
-    g_free(postData);
-
     return true;
 }
 
@@ -188,19 +556,44 @@ gboolean NetworkPositionProvider::networkUpdateCallback(void *obj) {
         return true;
     }
 
-    if (!(pThis->mConnectivityStatus)) {
-        GeoLocation geoLocation((pThis->mPositionData).lastLatitude, (pThis->mPositionData).lastLongitude, -1.0,
-           (pThis->mPositionData).lastAccuracy, (pThis->mPositionData).lastTimeStamp, -1.0, -1.0, -1.0, -1.0);
-        LS_LOG_ERROR("networkUpdateCallback no internetConnection");
-        pThis->getCallback()->getLocationUpdateCb(geoLocation, ERROR_NETWORK_ERROR, HANDLER_NETWORK);
-        return true;
-    }
-    if (pThis->mwifiStatus)
-        pThis->lunaServiceCall(SCAN_METHOD, SCAN_PAYLOAD, scanCb, &(pThis->mScanToken), true);
-    else if (pThis->mtelephonyPowerd)
+    // one shot, the next run is scheduled with the current adaptive interval
+    pThis->mTimeoutId = 0;
+
+    if (pThis->mGpsFeedActive) {
+        LS_LOG_DEBUG("network subscribers are served from GPS, scan skipped");
+    } else if (!(pThis->mConnectivityStatus)) {
+        if (pThis->mwifiStatus)
+            pThis->requestScan();
+
+        if (!pThis->resolveLocally(1)) {
+            GeoLocation geoLocation((pThis->mPositionData).lastLatitude, (pThis->mPositionData).lastLongitude, -1.0,
+               (pThis->mPositionData).lastAccuracy, (pThis->mPositionData).lastTimeStamp, -1.0, -1.0, -1.0, -1.0);
+            LS_LOG_ERROR("networkUpdateCallback no internetConnection");
+            pThis->getCallback()->getLocationUpdateCb(geoLocation, ERROR_NETWORK_ERROR, HANDLER_NETWORK);
+        }
+    } else if (pThis->mwifiStatus) {
+        pThis->requestScan();
+    } else if (pThis->mtelephonyPowerd) {
         pThis->triggerPostQuery();
+    }
 
-    return true;
+    if (pThis->mProcessRequestInProgress && !pThis->mTimeoutId)
+        pThis->scheduleScan();
+
+    return G_SOURCE_REMOVE;
+}
+
+void NetworkPositionProvider::scheduleScan() {
+    if (mTimeoutId)
+        g_source_remove(mTimeoutId);
+
+    LS_LOG_DEBUG("next network scan in %u ms", mScanScheduler.getInterval());
+    mTimeoutId = g_timeout_add(mScanScheduler.getInterval(), &networkUpdateCallback, (gpointer) this);
+}
+
+void NetworkPositionProvider::requestScan() {
+    mScanScheduler.recordScan();
+    lunaServiceCall(SCAN_METHOD, SCAN_PAYLOAD, scanCb, &mScanToken, true);
 }
 
 ErrorCodes  NetworkPositionProvider::processRequest(PositionRequest request) {
@@ -254,11 +647,12 @@ ErrorCodes  NetworkPositionProvider::processRequest(PositionRequest request) {
                 }
             }
 
-            lunaServiceCall(SCAN_METHOD, SCAN_PAYLOAD, scanCb, &mScanToken, true);
+            mFixPending = true;
+            requestScan();
             mProcessRequestInProgress = true;
             registerServiceStatus(TELEPHONY_SERVICE, &mTelephonyCookie, serviceStatusCb);
             registerServiceStatus(WIFI_SERVICE, &mWifiCookie, serviceStatusCb);
-            mTimeoutId = g_timeout_add(60000, &networkUpdateCallback, (gpointer) this);
+            scheduleScan();
             break;
         }
 
@@ -289,6 +683,12 @@ ErrorCodes  NetworkPositionProvider::processRequest(PositionRequest request) {
             }
 
             mPositionData.resetData();
+            mScanScheduler.reset();
+            cancelHedge();
+            cancelBackendQueries();
+            stopGpsFeed(false);
+            mServingCellValid = false;
+            mCellQueryPending = false;
             misFirstCellResponse = true;
             break;
 
@@ -299,84 +699,220 @@ ErrorCodes  NetworkPositionProvider::processRequest(PositionRequest request) {
     return ERROR_NONE;
 }
 
-char *NetworkPositionProvider::createCellWifiCombinedQuery() {
-    char *postData = NULL;
-    jvalue_ref wifiCellIdObject = NULL;
+const char *NetworkPositionProvider::createCellWifiCombinedQuery() {
     bool dataAvailable = false;
 
     LS_LOG_DEBUG("NetworkPositionProvider::createCellWifiCombinedQuery ");
-    wifiCellIdObject = jobject_create();
-
-    if (jis_null(wifiCellIdObject)) {
-        return NULL;
-    }
+    mQueryBuilder.begin();
 
-    if (parseCellData(wifiCellIdObject))
+    if (parseCellData(mQueryBuilder))
         dataAvailable = true;
-    if (parseWifiData(wifiCellIdObject))
+    if (parseWifiData(mQueryBuilder))
         dataAvailable = true;
 
     if (!dataAvailable) {
         LS_LOG_INFO("no data parsed"); //both cell and wifi data is not present in JSONObj
-        j_release(&wifiCellIdObject);
-        return postData;
+        return NULL;
     }
 
-    postData = g_strdup(jvalue_tostring_simple(wifiCellIdObject));
+    return mQueryBuilder.finish();
+}
 
-    j_release(&wifiCellIdObject);
+const char *NetworkPositionProvider::createCellQuery() {
+    mQueryBuilder.begin();
 
-    return postData;
-}
+    if (!parseCellData(mQueryBuilder))
+        return NULL;
 
-char *NetworkPositionProvider::createCellQuery() {
-    char *postData = NULL;
-    jvalue_ref cellObject = NULL;
+    return mQueryBuilder.finish();
+}
 
-    cellObject = jobject_create();
+const char *NetworkPositionProvider::createWifiQuery() {
+    mQueryBuilder.begin();
 
-    if (jis_null(cellObject)) {
+    if (!parseWifiData(mQueryBuilder))
         return NULL;
+
+    return mQueryBuilder.finish();
+}
+
+bool NetworkPositionProvider::networkPostQuery(const char *postData, const char *APIKey, gboolean sync,
+                                               const WifiScan &scan) {
+    char url[URL_LENGTH] = {0};
+    sprintf(url, NETWORK_URL, APIKey);
+    LS_LOG_DEBUG("networkPostQuery %s", url);
+
+    mQueryStartTime = g_get_monotonic_time();
+    mQueryId++;
+    cancelHedge();
+
+    if (!sendBackendQuery(0, url, postData, sync, scan))
+        return false;
+
+    // a slow primary is raced against a secondary once it is past its usual latency
+    if (postData && !sync && mBackends.size() > 1) {
+        mHedgeBody = postData;
+        mHedgeScan = scan;
+        mHedgeTimerId = g_timeout_add(mBackends.getHedgeDelayMs(0), &hedgeCallback, (gpointer) this);
     }
 
-    if (parseCellData(cellObject)) {
-        postData = g_strdup(jvalue_tostring_simple(cellObject));
+    return true;
+}
+
+bool NetworkPositionProvider::sendBackendQuery(size_t backend, const char *url, const char *postData, gboolean sync,
+                                               const WifiScan &scan) {
+    HttpReqTask *task = NULL;
+    // until the first fix a client waits on the answer, later ones refresh a tracked position
+    HttpRequestOptions options = {NETWORK_QUERY_TIMEOUT_MS, NETWORK_QUERY_MAX_RETRIES, 0,
+                                  mFixPending ? HTTP_PRIORITY_FOREGROUND_POSITION : HTTP_PRIORITY_BACKGROUND_POSITION};
+
+    mScanScheduler.recordHttpRequest();
+    mBackends.recordRequest(backend, backend != 0);
+
+    int errorCode = NetworkRequestManager::getInstance()->initiateTransaction(NULL, 0, url, sync, NULL, this,
+                                                                              const_cast<char *>(postData), &task,
+                                                                              &options);
+
+    if (ERROR_NONE != errorCode) {
+        mBackends.recordResult(backend, false, 0);
+        return false;
     }
 
-    j_release(&cellObject);
+    BackendQuery query = {task, backend, mQueryId, scan};
+    mBackendQueries.push_back(query);
 
-    return postData;
+    return true;
 }
 
-char *NetworkPositionProvider::createWifiQuery() {
-    char *postData = NULL;
-    jvalue_ref wifiObject = NULL;
+gboolean NetworkPositionProvider::hedgeCallback(gpointer data) {
+    NetworkPositionProvider *pThis = static_cast<NetworkPositionProvider *>(data);
+    size_t backend = 1;
+
+    pThis->mHedgeTimerId = 0;
 
-    wifiObject = jobject_create();
-    if (jis_null(wifiObject))
-        return postData;
+    if (pThis->mAnsweredQueryId == pThis->mQueryId)
+        return G_SOURCE_REMOVE;
 
-    if (parseWifiData(wifiObject)) {
-        postData = g_strdup(jvalue_tostring_simple(wifiObject));
+    // the secondary that usually answers fastest
+    for (size_t i = 2; i < pThis->mBackends.size(); i++) {
+        if (pThis->mBackends.getHedgeDelayMs(i) < pThis->mBackends.getHedgeDelayMs(backend))
+            backend = i;
     }
 
-    j_release(&wifiObject);
-    return postData;
+    LS_LOG_INFO("primary backend is slow, hedging query to %s", pThis->mBackends.getName(backend).c_str());
+
+    if (!pThis->sendBackendQuery(backend, pThis->mBackends.getUrl(backend).c_str(), pThis->mHedgeBody.c_str(),
+                                 FALSE, pThis->mHedgeScan))
+        LS_LOG_ERROR("hedged query to %s failed", pThis->mBackends.getName(backend).c_str());
+
+    pThis->mHedgeBody.clear();
+    pThis->mHedgeScan.clear();
+    return G_SOURCE_REMOVE;
 }
 
-bool NetworkPositionProvider::networkPostQuery(char *postData, const char *APIKey, gboolean sync) {
-    char url[URL_LENGTH] = {0};
-    sprintf(url, NETWORK_URL, APIKey);
-    LS_LOG_DEBUG("networkPostQuery %s", url);
+void NetworkPositionProvider::cancelHedge() {
+    if (mHedgeTimerId) {
+        g_source_remove(mHedgeTimerId);
+        mHedgeTimerId = 0;
+    }
 
-    int errorCode = NetworkRequestManager::getInstance()->initiateTransaction(NULL, 0, url, sync, NULL, this,
-                                                                              postData);
+    mHedgeBody.clear();
+    mHedgeScan.clear();
+}
+
+// the learned caches go to flash on suspend and deinit only, at most every
+// CACHE_SAVE_MIN_INTERVAL_US and within the write budget of the position stores
+void NetworkPositionProvider::saveCaches(bool force) {
+    int64_t now = g_get_monotonic_time();
+    size_t fingerprintBytes = 0;
+    size_t apBytes = 0;
+    size_t cellBytes = 0;
 
-    if (ERROR_NONE == errorCode) {
+    if (!force) {
+        if (mLastCacheSave && now - mLastCacheSave < CACHE_SAVE_MIN_INTERVAL_US)
+            return;
+
+        if (!store_write_allowed(mLastCacheSaveBytes)) {
+            LS_LOG_INFO("write budget spent, network caches kept in memory");
+            return;
+        }
+    }
+
+    mFingerprintCache.save(&fingerprintBytes);
+    mApDatabase.save(&apBytes);
+    mCellCache.save(&cellBytes);
+
+    store_write_done(fingerprintBytes);
+    store_write_done(apBytes);
+    store_write_done(cellBytes);
+
+    mLastCacheSave = now;
+    mLastCacheSaveBytes = fingerprintBytes + apBytes + cellBytes;
+}
+
+void NetworkPositionProvider::cancelBackendQueries() {
+    int cancelled = NetworkRequestManager::getInstance()->cancelTransactions(this);
+
+    if (cancelled)
+        LS_LOG_INFO("cancelled %d position queries in flight", cancelled);
+
+    mBackendQueries.clear();
+}
+
+// returns false when the response is not the answer to report, the task is cleared then;
+// scan gets the fingerprint of the answered query while it is still the current one
+bool NetworkPositionProvider::settleBackendQuery(HttpReqTask *task, WifiScan &scan) {
+    bool success = (HTTP_STATUS_CODE_SUCCESS == task->curlDesc.httpResponseCode);
+    BackendQuery query;
+    auto it = mBackendQueries.begin();
+
+    while (it != mBackendQueries.end() && it->task != task)
+        ++it;
+
+    if (it == mBackendQueries.end())
         return true;
+
+    query = *it;
+    mBackendQueries.erase(it);
+
+    // the backend's own latency, time spent queued or backing off for a retry is not its doing
+    mBackends.recordResult(query.backend, success,
+                           NetworkRequestManager::getInstance()->getAttemptLatencyMs(task));
+
+    auto sameQuery = [&query](const BackendQuery &other) {
+        return other.queryId == query.queryId;
+    };
+    bool raceOpen = std::any_of(mBackendQueries.begin(), mBackendQueries.end(), sameQuery);
+
+    // a primary that fails before the hedge delay hands the query over right away
+    if (!success && !raceOpen && mHedgeTimerId && query.queryId == mQueryId) {
+        g_source_remove(mHedgeTimerId);
+        hedgeCallback(this);
+
+        if (std::any_of(mBackendQueries.begin(), mBackendQueries.end(), sameQuery)) {
+            NetworkRequestManager::getInstance()->clearTransaction(task);
+            return false;
+        }
     }
 
-    return false;
+    // the other backend already answered, or still may while this one failed
+    if (query.queryId == mAnsweredQueryId || (!success && raceOpen)) {
+        LS_LOG_DEBUG("response of %s for query %u dropped", mBackends.getName(query.backend).c_str(), query.queryId);
+        NetworkRequestManager::getInstance()->clearTransaction(task);
+        return false;
+    }
+
+    mAnsweredQueryId = query.queryId;
+
+    if (success && raceOpen)
+        mBackends.recordWin(query.backend);
+
+    if (query.queryId == mQueryId) {
+        cancelHedge();
+        scan.swap(query.scan);
+    }
+
+    return true;
 }
 
 void NetworkPositionProvider::handleResponse(HttpReqTask *task) {
@@ -385,12 +921,19 @@ void NetworkPositionProvider::handleResponse(HttpReqTask *task) {
     int64_t currentTime = 0;
     double latitude, longitude, accuracy;
     struct timeval tval;
+    WifiScan scan;
 
     if (!task) {
         LS_LOG_ERROR("handleResponse::invalid http data received");
         return;
     }
 
+    if (!settleBackendQuery(task, scan))
+        return;
+
+    if (mQueryStartTime)
+        mFingerprintCache.recordRoundTrip((g_get_monotonic_time() - mQueryStartTime) / 1000);
+
     if (HTTP_STATUS_CODE_SUCCESS == task->curlDesc.httpResponseCode) {
         LS_LOG_DEBUG("curlResultCode: %d, httpResponseCode: %ld, httpConnectCode: %ld, desc: %s",
                     task->curlDesc.curlResultCode,
@@ -413,43 +956,26 @@ void NetworkPositionProvider::handleResponse(HttpReqTask *task) {
             return;
         }
 
-        // for tracking, if responded coordinates are same as the last coordinates,
-        // no need to emit signal.
-        LS_LOG_DEBUG("latitude/longitude change: %f, %f", fabs(mPositionData.lastLatitude - latitude),
-                    fabs(mPositionData.lastLongitude - longitude));
+        // empty when a newer query was posted meanwhile, that answer is not cached
+        mFingerprintCache.insert(scan, latitude, longitude, accuracy);
 
-        if (latitude == mPositionData.lastLatitude &&
-            longitude == mPositionData.lastLongitude &&
-            accuracy == mPositionData.lastAccuracy) {
+        // only the answer to the last posted, cell only query describes the serving cell
+        if (mCellQueryPending && mServingCellValid && mAnsweredQueryId == mQueryId)
+            mCellCache.insertNetworkPosition(mServingCell, latitude, longitude, accuracy);
 
-            LS_LOG_DEBUG("no position change in tracking");
-            return;
-        }
+        mCellQueryPending = false;
 
-        LS_LOG_INFO("position is changed, emitting position changed signal...");
-
-        // position is changed
-        mPositionData.lastLatitude = latitude;
-        mPositionData.lastLongitude = longitude;
-        mPositionData.lastAccuracy = accuracy;
-        gettimeofday(&tval, (struct timezone *) NULL);
-        currentTime = tval.tv_sec * 1000LL + tval.tv_usec / 1000;
-
-        set_store_position(currentTime, latitude, longitude, INVALID_PARAM, INVALID_PARAM, INVALID_PARAM,
-                           accuracy, INVALID_PARAM, (LOCATION_DB_PREF_PATH_NETWORK));
-
-        if (getCallback())
-        {
-            GeoLocation geoLocation(latitude, longitude, -1.0, accuracy, currentTime, -1.0, -1.0, -1.0, -1.0);
-            getCallback()->getLocationUpdateCb(geoLocation, error,
-                      HANDLER_NETWORK);
-        }
+        updatePosition(latitude, longitude, accuracy);
     } else {
         //error case handling
         LS_LOG_ERROR("network error: task->curlDesc.curlResultErrorStr %s", task->curlDesc.curlResultErrorStr);
 
         NetworkRequestManager::getInstance()->clearTransaction(task);
 
+        // e.g. behind a captive portal, fall back to the learned access points
+        if (resolveLocally(1))
+            return;
+
         error = ERROR_NETWORK_ERROR;
 
         gettimeofday(&tval, (struct timezone *) NULL);
@@ -463,6 +989,51 @@ void NetworkPositionProvider::handleResponse(HttpReqTask *task) {
     }
 }
 
+void NetworkPositionProvider::updatePosition(double latitude, double longitude, double accuracy) {
+    int64_t currentTime = 0;
+    struct timeval tval;
+
+    mFixPending = false;
+
+    // for tracking, if responded coordinates are same as the last coordinates,
+    // no need to emit signal.
+    LS_LOG_DEBUG("latitude/longitude change: %f, %f", fabs(mPositionData.lastLatitude - latitude),
+                fabs(mPositionData.lastLongitude - longitude));
+
+    if (latitude == mPositionData.lastLatitude &&
+        longitude == mPositionData.lastLongitude &&
+        accuracy == mPositionData.lastAccuracy) {
+
+        LS_LOG_DEBUG("no position change in tracking");
+        return;
+    }
+
+    LS_LOG_INFO("position is changed, emitting position changed signal...");
+
+    // position is changed
+    mPositionData.lastLatitude = latitude;
+    mPositionData.lastLongitude = longitude;
+    mPositionData.lastAccuracy = accuracy;
+    gettimeofday(&tval, (struct timezone *) NULL);
+    currentTime = tval.tv_sec * 1000LL + tval.tv_usec / 1000;
+
+    set_store_position(currentTime, latitude, longitude, INVALID_PARAM, INVALID_PARAM, INVALID_PARAM,
+                       accuracy, INVALID_PARAM, (LOCATION_DB_PREF_PATH_NETWORK));
+
+    // staleness is the age of the wifi scan or cell data the fix was computed from
+    int64_t measuredTime = mwifiStatus ? mLastScanTime : mCellDataTime;
+
+    if (measuredTime)
+        mScanScheduler.recordDelivery((g_get_monotonic_time() - measuredTime) / 1000);
+
+    if (getCallback())
+    {
+        GeoLocation geoLocation(latitude, longitude, -1.0, accuracy, currentTime, -1.0, -1.0, -1.0, -1.0);
+        getCallback()->getLocationUpdateCb(geoLocation, ERROR_NONE,
+                  HANDLER_NETWORK);
+    }
+}
+
 int NetworkPositionProvider::parseHTTPResponse(char *body, double *latitude, double *longitude, double *accuracy) {
     jschema_ref inputSchema = NULL;
     jvalue_ref parsedObj = NULL;
@@ -474,6 +1045,12 @@ int NetworkPositionProvider::parseHTTPResponse(char *body, double *latitude, dou
     if (!body)
         return error;
 
+    // a regular reply is read in one pass, error and odd bodies go through the DOM
+    if (geolocationResponseExtract(body, latitude, longitude, accuracy) == GEO_RESPONSE_OK) {
+        LS_LOG_DEBUG("parsed accuracy=%f, latitude=%f, longitude=%f", *accuracy, *latitude, *longitude);
+        return ERROR_NONE;
+    }
+
     inputSchema = jschema_parse(j_cstr_to_buffer(SCHEMA_ANY), DOMOPT_NOOPT, NULL);
 
     if (!inputSchema)
@@ -630,6 +1207,7 @@ void NetworkPositionProvider::Handle_TelephonyNotification(bool status) {
             mPositionData.cellInfo = NULL;
         }
         mPositionData.curCellid = 0;
+        mServingCellValid = false;
     }
 }
 
@@ -638,132 +1216,63 @@ void NetworkPositionProvider::Handle_WifiInternetNotification(bool status) {
 }
 
 void NetworkPositionProvider::Handle_SuspendedNotification(bool status) {
-
+    if (status)
+        saveCaches(false);
 }
 
-template<typename T>
-bool NetworkPositionProvider::parseWifiData(T& jsonObj) {
-    gchar *updateKey = NULL;
+bool NetworkPositionProvider::parseWifiData(GeolocationQueryBuilder &query) {
     gboolean isFirst = FALSE;
     unsigned int vanishedCount = 0;
-    int signalChange = 0;
-    guint oldSize = 0;
-    guint newSize = 0;
     int signalChangeSum = 0;
-    int updateValue = 0;
     double avgSignalChange = 0;
-    GHashTableIter iter;
-    gpointer key = NULL;
-    gpointer oldValue = NULL;
-    gpointer newValue = NULL;
-    jvalue_ref wifiAccessPointsList = NULL;
-    jvalue_ref wifiAccessPointsListItem = NULL;
-
-    if (jis_null(jsonObj)) {
-        return false;
-    }
+    char bssid[WIFI_BSSID_STR_LEN];
 
     LS_LOG_DEBUG("NetworkPositionProvider::parseWifiData ");
 
-    if (!mPositionData.wifiAccessPointsList || (g_hash_table_size(mPositionData.wifiAccessPointsList) < 2)) {
+    if (mLastScan.size() < 2) {
         LS_LOG_DEBUG("Access point empty or less than 2");
         return false;
     }
 
     LS_LOG_DEBUG("Checking wifi AP list...");
 
-    if (!mPositionData.lastAps) {
-        LS_LOG_INFO("Checking mPositionData.lastAps null...");
+    if (mPositionData.lastAps.empty()) {
+        LS_LOG_INFO("No previously posted scan...");
         isFirst = TRUE;
-        mPositionData.lastAps = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                                      (GDestroyNotify) g_free, NULL);
     }
-    LS_LOG_DEBUG("Checking mPositionData.last aps not null...");
-    oldSize = g_hash_table_size(mPositionData.lastAps);
-    LS_LOG_INFO("Existing table size = %d", oldSize);
-
-    newSize = g_hash_table_size(mPositionData.wifiAccessPointsList);
 
-    LS_LOG_INFO("New table size = %d", newSize);
+    LS_LOG_INFO("Existing scan size = %zu, new scan size = %zu", mPositionData.lastAps.size(), mLastScan.size());
 
     if (!isFirst) {
-        g_hash_table_iter_init(&iter, mPositionData.wifiAccessPointsList);
+        // both scans are sorted by bssid, so the diff is a single merge pass
+        signalChangeSum = wifiScanSignalChange(mLastScan, mPositionData.lastAps, &vanishedCount);
 
-        while (g_hash_table_iter_next(&iter, &key, &newValue)) {
-            LS_LOG_INFO("New key/value: %s, %d", (char *) key, GPOINTER_TO_INT(newValue));
+        if (mLastScan.size() + vanishedCount > 0)
+            avgSignalChange = (double) signalChangeSum / (double) (mLastScan.size() + vanishedCount);
 
-            if ((oldValue = g_hash_table_lookup(mPositionData.lastAps, (gconstpointer) key))) {
-                LS_LOG_INFO("Found key in existing table");
-                signalChange = abs(GPOINTER_TO_INT(newValue) - GPOINTER_TO_INT(oldValue));
-            } else {
-                LS_LOG_INFO("Not found key");
-                signalChange = abs(GPOINTER_TO_INT(newValue));
-            }
-
-            LS_LOG_INFO("signal change of %s = %d", (char *) key, signalChange);
-            signalChangeSum += signalChange;
-        }
-
-        g_hash_table_iter_init(&iter, mPositionData.lastAps);
-
-        while (g_hash_table_iter_next(&iter, &key, &oldValue)) {
-            if (!(newValue = g_hash_table_lookup(mPositionData.wifiAccessPointsList, (gconstpointer) key))) {
-                LS_LOG_INFO("Existing key is vanished in new table");
-
-                signalChange = abs(GPOINTER_TO_INT(oldValue));
-                LS_LOG_INFO("signal change of %s = %d", (char *) key, signalChange);
-
-                signalChangeSum += signalChange;
-                vanishedCount++;
-            }
-        }
-
-        avgSignalChange = (double) signalChangeSum / (double) (newSize + vanishedCount);
-        LS_LOG_INFO("Average signal change = %f", avgSignalChange);
+        LS_LOG_INFO("Average signal change = %f, vanished = %u", avgSignalChange, vanishedCount);
     }
 
     if (isFirst || (!isFirst && avgSignalChange > SIGNAL_CHANGE_THRESHOLD)) {
-        g_hash_table_remove_all(mPositionData.lastAps);
+        mPositionData.lastAps = mLastScan;
 
-        wifiAccessPointsList = jarray_create(NULL);
+        query.beginArray("wifiAccessPoints");
 
-        if (jis_null(wifiAccessPointsList)) {
-            LS_LOG_ERROR("fatal, unable to create wifiAccessPointsList");
-            return false;
+        for (const WifiAccessPoint &ap : mLastScan) {
+            wifiBssidUnpack(ap.bssid, bssid, sizeof(bssid));
+            query.appendAccessPoint(bssid, ap.signal);
         }
 
-        g_hash_table_iter_init(&iter, mPositionData.wifiAccessPointsList);
-
-        while (g_hash_table_iter_next(&iter, &key, &newValue)) {
-            updateKey = g_strdup((const gchar *) key);
-            updateValue = GPOINTER_TO_INT(newValue);
-
-            LS_LOG_INFO("inserting key/value: %s, %d", updateKey, updateValue);
-            g_hash_table_insert(mPositionData.lastAps, updateKey, GINT_TO_POINTER(updateValue));
-
-            wifiAccessPointsListItem = jobject_create();
-            if (!jis_null(wifiAccessPointsListItem)) {
-                jobject_put(wifiAccessPointsListItem, J_CSTR_TO_JVAL("macAddress"), jstring_create((char *) key));
-                jobject_put(wifiAccessPointsListItem, J_CSTR_TO_JVAL("signalStrength"),
-                            jnumber_create_i32(GPOINTER_TO_INT(newValue)));
-                jarray_append(wifiAccessPointsList, wifiAccessPointsListItem);
-            }
-        }
-
-        if (jobject_put(jsonObj, J_CSTR_TO_JVAL("wifiAccessPoints"), wifiAccessPointsList)) {
-            LS_LOG_DEBUG("table updation complete");
-            return true;
-        } else {
-            j_release(&wifiAccessPointsList);
-        }
+        query.endArray();
+        LS_LOG_DEBUG("table updation complete");
+        return true;
     }
 
     LS_LOG_DEBUG("No update in wifi AP list");
     return false;
 }
 
-template<typename T>
-bool NetworkPositionProvider::parseCellData(T& refJsonObj) {
+bool NetworkPositionProvider::parseCellData(GeolocationQueryBuilder &query) {
     jvalue_ref parsedObj = NULL;
     jvalue_ref jsonObj = NULL;
     jvalue_ref cellTower = NULL;
@@ -797,9 +1306,31 @@ bool NetworkPositionProvider::parseCellData(T& refJsonObj) {
                     if (state && jobject_get_exists(cellTower, J_CSTR_TO_BUF("cellId"), &subObj)) {
                         jnumber_get_i32(subObj, &cellID);
 
+                        int64_t longCellId = 0;
+                        int32_t value = 0;
+
+                        jnumber_get_i64(subObj, &longCellId);
+                        memset(&mServingCell, 0x00, sizeof(mServingCell));
+                        mServingCell.cid = longCellId;
+
+                        if (jobject_get_exists(cellTower, J_CSTR_TO_BUF("mobileCountryCode"), &subObj) &&
+                            jnumber_get_i32(subObj, &value) == CONV_OK)
+                            mServingCell.mcc = value;
+
+                        if (jobject_get_exists(cellTower, J_CSTR_TO_BUF("mobileNetworkCode"), &subObj) &&
+                            jnumber_get_i32(subObj, &value) == CONV_OK)
+                            mServingCell.mnc = value;
+
+                        if ((jobject_get_exists(cellTower, J_CSTR_TO_BUF("locationAreaCode"), &subObj) ||
+                             jobject_get_exists(cellTower, J_CSTR_TO_BUF("trackingAreaCode"), &subObj)) &&
+                            jnumber_get_i32(subObj, &value) == CONV_OK)
+                            mServingCell.lac = value;
+
+                        mServingCellValid = (mServingCell.mcc != 0);
+
                         if (cellID != mPositionData.curCellid) {
                             mPositionData.curCellid = cellID;
-                            jobject_put(refJsonObj, J_CSTR_TO_JVAL("cellTowers"), jvalue_duplicate(jsonObj));
+                            query.appendRawMember("cellTowers", jvalue_tostring_simple(jsonObj));
                             cellChanged = TRUE;
                         } else {
                             LS_LOG_DEBUG("no registered changed cell ID detected");
@@ -0,0 +1,102 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <string.h>
+#include <algorithm>
+#include <NetworkScanScheduler.h>
+
+#define SCAN_INTERVAL_MIN_MS            15000
+#define SCAN_INTERVAL_DEFAULT_MS        60000
+#define SCAN_INTERVAL_MAX_MS            300000
+#define SCAN_MOTION_SPEED               1.5         // m/s, faster than walking drift
+#define SCAN_MOTION_HOLD_US             (120 * 1000000LL)
+
+NetworkScanScheduler::NetworkScanScheduler() : mStalenessSumMs(0) {
+    memset(&mStats, 0x00, sizeof(mStats));
+    reset();
+}
+
+void NetworkScanScheduler::reset() {
+    mSubscriberIntervalMs = 0;
+    mLastMotionUs = 0;
+    mIntervalMs = SCAN_INTERVAL_DEFAULT_MS;
+    mStats.intervalMs = mIntervalMs;
+}
+
+uint32_t NetworkScanScheduler::getFloor() const {
+    return std::min(std::max(mSubscriberIntervalMs, (uint32_t) SCAN_INTERVAL_MIN_MS),
+                    (uint32_t) SCAN_INTERVAL_MAX_MS);
+}
+
+void NetworkScanScheduler::setSubscriberInterval(uint32_t intervalMs) {
+    uint32_t previousFloor = getFloor();
+
+    mSubscriberIntervalMs = intervalMs;
+
+    // a tighter subscriber cuts a long backoff short, a looser floor only lifts the interval
+    if (getFloor() < previousFloor)
+        mIntervalMs = std::min(mIntervalMs, (uint32_t) SCAN_INTERVAL_DEFAULT_MS);
+
+    mIntervalMs = std::max(mIntervalMs, getFloor());
+    mStats.intervalMs = mIntervalMs;
+}
+
+bool NetworkScanScheduler::onScanResult(bool changed, int64_t nowUs) {
+    uint32_t previous = mIntervalMs;
+    bool moving = mLastMotionUs && (nowUs - mLastMotionUs <= SCAN_MOTION_HOLD_US);
+
+    if (changed || moving) {
+        mIntervalMs = getFloor();
+    } else {
+        mStats.unchangedScans++;
+        mIntervalMs = std::min(mIntervalMs * 2, (uint32_t) SCAN_INTERVAL_MAX_MS);
+        mIntervalMs = std::max(mIntervalMs, getFloor());
+    }
+
+    mStats.intervalMs = mIntervalMs;
+    return mIntervalMs < previous;
+}
+
+bool NetworkScanScheduler::onMotion(double speed, int64_t nowUs) {
+    uint32_t previous = mIntervalMs;
+
+    if (speed < SCAN_MOTION_SPEED)
+        return false;
+
+    mLastMotionUs = nowUs;
+    mIntervalMs = getFloor();
+    mStats.intervalMs = mIntervalMs;
+
+    return mIntervalMs < previous;
+}
+
+void NetworkScanScheduler::recordDelivery(int64_t stalenessMs) {
+    if (stalenessMs < 0)
+        stalenessMs = 0;
+
+    mStats.deliveredFixes++;
+    mStats.lastStalenessMs = stalenessMs;
+    mStats.maxStalenessMs = std::max(mStats.maxStalenessMs, stalenessMs);
+    mStalenessSumMs += stalenessMs;
+    mStats.avgStalenessMs = mStalenessSumMs / (int64_t) mStats.deliveredFixes;
+}
+
+void NetworkScanScheduler::getStats(NetworkScanStats *stats) const {
+    if (stats)
+        *stats = mStats;
+}
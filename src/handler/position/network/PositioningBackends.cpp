@@ -0,0 +1,156 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <algorithm>
+#include <pbnjson.hpp>
+#include <loc_log.h>
+#include <PositioningBackends.h>
+
+#define HEDGE_DEFAULT_DELAY_MS      1500    // until enough latencies are known
+#define HEDGE_MIN_SAMPLES           8
+#define HEDGE_MIN_DELAY_MS          100
+
+PositioningBackends::PositioningBackends() {
+    mBackends.push_back(makeBackend("primary", "", ""));
+}
+
+PositioningBackends::Backend PositioningBackends::makeBackend(const std::string &name, const std::string &url,
+                                                              const std::string &apiKey) {
+    Backend backend;
+
+    backend.name = name;
+    backend.url = url;
+    backend.apiKey = apiKey;
+    backend.latencyCount = 0;
+    backend.latencyNext = 0;
+    backend.requests = 0;
+    backend.hedgedRequests = 0;
+    backend.successes = 0;
+    backend.failures = 0;
+    backend.wins = 0;
+
+    return backend;
+}
+
+void PositioningBackends::setPrimary(const std::string &name) {
+    mBackends[0].name = name;
+}
+
+bool PositioningBackends::load(const char *path) {
+    pbnjson::JValue root = pbnjson::JDomParser::fromFile(path);
+
+    mBackends.resize(1);
+
+    if (root.isNull() || !root.isValid() || !root.hasKey("backends") || !root["backends"].isArray()) {
+        LS_LOG_DEBUG("no secondary positioning backends in %s", path);
+        return false;
+    }
+
+    pbnjson::JValue list = root["backends"];
+
+    for (int i = 0; i < list.arraySize(); i++) {
+        if (!list[i].hasKey("name") || !list[i].hasKey("url")) {
+            LS_LOG_ERROR("positioning backend %d has no name or url, skipped", i);
+            continue;
+        }
+
+        std::string name = list[i]["name"].asString();
+        std::string url = list[i]["url"].asString();
+        std::string apiKey = list[i].hasKey("apiKey") ? list[i]["apiKey"].asString() : "";
+
+        if (name.empty() || url.empty())
+            continue;
+
+        mBackends.push_back(makeBackend(name, url, apiKey));
+        LS_LOG_INFO("positioning backend %s added", name.c_str());
+    }
+
+    return mBackends.size() > 1;
+}
+
+std::string PositioningBackends::getUrl(size_t index) const {
+    return mBackends[index].url + mBackends[index].apiKey;
+}
+
+int64_t PositioningBackends::percentile95(const Backend &backend) {
+    int64_t sorted[POSITIONING_BACKEND_LATENCY_SAMPLES];
+    size_t rank;
+
+    std::copy(backend.latencies, backend.latencies + backend.latencyCount, sorted);
+    rank = (backend.latencyCount * 95 + 99) / 100 - 1;
+    std::nth_element(sorted, sorted + rank, sorted + backend.latencyCount);
+
+    return sorted[rank];
+}
+
+int64_t PositioningBackends::getHedgeDelayMs(size_t index) const {
+    const Backend &backend = mBackends[index];
+
+    if (backend.latencyCount < HEDGE_MIN_SAMPLES)
+        return HEDGE_DEFAULT_DELAY_MS;
+
+    return std::max(percentile95(backend), (int64_t) HEDGE_MIN_DELAY_MS);
+}
+
+void PositioningBackends::recordRequest(size_t index, bool hedged) {
+    mBackends[index].requests++;
+
+    if (hedged)
+        mBackends[index].hedgedRequests++;
+}
+
+void PositioningBackends::recordResult(size_t index, bool success, int64_t latencyMs) {
+    Backend &backend = mBackends[index];
+
+    if (!success) {
+        backend.failures++;
+        return;
+    }
+
+    backend.successes++;
+
+    if (latencyMs < 0)
+        return;
+
+    backend.latencies[backend.latencyNext] = latencyMs;
+    backend.latencyNext = (backend.latencyNext + 1) % POSITIONING_BACKEND_LATENCY_SAMPLES;
+
+    if (backend.latencyCount < POSITIONING_BACKEND_LATENCY_SAMPLES)
+        backend.latencyCount++;
+}
+
+void PositioningBackends::recordWin(size_t index) {
+    mBackends[index].wins++;
+}
+
+void PositioningBackends::getStats(std::vector<PositioningBackendStats> &stats) const {
+    stats.clear();
+
+    for (const Backend &backend : mBackends) {
+        PositioningBackendStats entry;
+
+        entry.name = backend.name;
+        entry.requests = backend.requests;
+        entry.hedgedRequests = backend.hedgedRequests;
+        entry.successes = backend.successes;
+        entry.failures = backend.failures;
+        entry.wins = backend.wins;
+        entry.p95LatencyMs = backend.latencyCount ? percentile95(backend) : 0;
+        stats.push_back(entry);
+    }
+}
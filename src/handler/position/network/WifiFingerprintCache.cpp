@@ -0,0 +1,323 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <iterator>
+#include <loc_log.h>
+#include <WifiFingerprintCache.h>
+
+#define FINGERPRINT_CACHE_MAGIC     "WFC1"
+#define FINGERPRINT_MIN_APS         2
+#define FINGERPRINT_WEIGHT_FLOOR    100     // signal + floor gives the AP weight
+#define ROUND_TRIP_EWMA_ALPHA       0.2
+
+WifiFingerprintCache::WifiFingerprintCache(const char *path, size_t capacity, int64_t ttlMs,
+                                           double fuzzyThreshold) :
+        mPath(path ? path : ""),
+        mCapacity(capacity),
+        mTtlMs(ttlMs),
+        mFuzzyThreshold(fuzzyThreshold),
+        mDirty(false) {
+    memset(&mStats, 0x00, sizeof(mStats));
+}
+
+uint64_t WifiFingerprintCache::fingerprintKey(const WifiScan &scan) {
+    // FNV-1a over the sorted bssids
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const WifiAccessPoint &ap : scan) {
+        for (int shift = 0; shift < 48; shift += 8) {
+            hash ^= (ap.bssid >> shift) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+static double apWeight(int signal) {
+    int weight = signal + FINGERPRINT_WEIGHT_FLOOR;
+
+    return (weight < 1) ? 1 : weight;
+}
+
+double WifiFingerprintCache::weightedJaccard(const WifiScan &a, const WifiScan &b) {
+    double minSum = 0;
+    double maxSum = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < a.size() || j < b.size()) {
+        if (j >= b.size() || (i < a.size() && a[i].bssid < b[j].bssid)) {
+            maxSum += apWeight(a[i++].signal);
+        } else if (i >= a.size() || b[j].bssid < a[i].bssid) {
+            maxSum += apWeight(b[j++].signal);
+        } else {
+            double wa = apWeight(a[i++].signal);
+            double wb = apWeight(b[j++].signal);
+            minSum += std::min(wa, wb);
+            maxSum += std::max(wa, wb);
+        }
+    }
+
+    return (maxSum > 0) ? minSum / maxSum : 0;
+}
+
+void WifiFingerprintCache::removeEntry(EntryIter it) {
+    auto indexIt = mIndex.find(it->key);
+
+    if (indexIt != mIndex.end() && indexIt->second == it)
+        mIndex.erase(indexIt);
+
+    mEntries.erase(it);
+    mDirty = true;
+}
+
+void WifiFingerprintCache::touch(EntryIter it) {
+    mEntries.splice(mEntries.begin(), mEntries, it);
+}
+
+bool WifiFingerprintCache::lookup(const WifiScan &scan, double *latitude, double *longitude, double *accuracy) {
+    int64_t now = g_get_real_time() / 1000;
+    EntryIter best = mEntries.end();
+    double bestScore = 0;
+
+    if (scan.size() < FINGERPRINT_MIN_APS)
+        return false;
+
+    mStats.lookups++;
+
+    auto indexIt = mIndex.find(fingerprintKey(scan));
+
+    if (indexIt != mIndex.end()) {
+        EntryIter it = indexIt->second;
+
+        if (now - it->timestamp > mTtlMs) {
+            mStats.expired++;
+            removeEntry(it);
+        } else {
+            best = it;
+            mStats.exactHits++;
+        }
+    }
+
+    if (best == mEntries.end()) {
+        for (EntryIter it = mEntries.begin(); it != mEntries.end();) {
+            if (now - it->timestamp > mTtlMs) {
+                EntryIter expired = it++;
+                mStats.expired++;
+                removeEntry(expired);
+                continue;
+            }
+
+            double score = weightedJaccard(scan, it->scan);
+
+            if (score >= mFuzzyThreshold && score > bestScore) {
+                bestScore = score;
+                best = it;
+            }
+
+            ++it;
+        }
+
+        if (best != mEntries.end())
+            mStats.fuzzyHits++;
+    }
+
+    if (best == mEntries.end()) {
+        mStats.misses++;
+        return false;
+    }
+
+    *latitude = best->latitude;
+    *longitude = best->longitude;
+    *accuracy = best->accuracy;
+    touch(best);
+    mStats.latencySavedMs += mStats.avgRoundTripMs;
+
+    LS_LOG_DEBUG("fingerprint cache hit, similarity %f", bestScore ? bestScore : 1.0);
+
+    return true;
+}
+
+void WifiFingerprintCache::insert(const WifiScan &scan, double latitude, double longitude, double accuracy) {
+    Entry entry;
+
+    if (scan.size() < FINGERPRINT_MIN_APS || mCapacity == 0)
+        return;
+
+    entry.key = fingerprintKey(scan);
+    entry.timestamp = g_get_real_time() / 1000;
+    entry.latitude = latitude;
+    entry.longitude = longitude;
+    entry.accuracy = accuracy;
+    entry.scan = scan;
+
+    auto indexIt = mIndex.find(entry.key);
+
+    if (indexIt != mIndex.end())
+        removeEntry(indexIt->second);
+
+    while (mEntries.size() >= mCapacity) {
+        removeEntry(std::prev(mEntries.end()));
+        mStats.evictions++;
+    }
+
+    mEntries.push_front(entry);
+    mIndex[entry.key] = mEntries.begin();
+    mDirty = true;
+}
+
+void WifiFingerprintCache::recordRoundTrip(int64_t elapsedMs) {
+    if (elapsedMs < 0)
+        return;
+
+    if (mStats.avgRoundTripMs == 0)
+        mStats.avgRoundTripMs = elapsedMs;
+    else
+        mStats.avgRoundTripMs += ROUND_TRIP_EWMA_ALPHA * (elapsedMs - mStats.avgRoundTripMs);
+}
+
+void WifiFingerprintCache::getStats(WifiFingerprintCacheStats *stats) {
+    if (!stats)
+        return;
+
+    *stats = mStats;
+    stats->entries = mEntries.size();
+}
+
+/*
+ * File format, one entry per line, least recently used first:
+ * <timestamp> <latitude> <longitude> <accuracy> <count> <bssid>/<signal> ...
+ */
+bool WifiFingerprintCache::load() {
+    FILE *fp = NULL;
+    char magic[8] = {0};
+    int64_t now = g_get_real_time() / 1000;
+
+    if (mPath.empty() || (fp = fopen(mPath.c_str(), "r")) == NULL)
+        return false;
+
+    if (fscanf(fp, "%7s", magic) != 1 || strcmp(magic, FINGERPRINT_CACHE_MAGIC) != 0) {
+        LS_LOG_ERROR("invalid fingerprint cache file %s", mPath.c_str());
+        fclose(fp);
+        return false;
+    }
+
+    while (true) {
+        Entry entry;
+        unsigned int count = 0;
+        bool valid = true;
+
+        if (fscanf(fp, "%" SCNd64 " %lf %lf %lf %u", &entry.timestamp, &entry.latitude, &entry.longitude,
+                   &entry.accuracy, &count) != 5)
+            break;
+
+        for (unsigned int i = 0; i < count; i++) {
+            WifiAccessPoint ap;
+
+            if (fscanf(fp, " %" SCNx64 "/%d", &ap.bssid, &ap.signal) != 2) {
+                valid = false;
+                break;
+            }
+
+            entry.scan.push_back(ap);
+        }
+
+        if (!valid)
+            break;
+
+        if (now - entry.timestamp > mTtlMs || entry.scan.size() < FINGERPRINT_MIN_APS)
+            continue;
+
+        std::sort(entry.scan.begin(), entry.scan.end(), [](const WifiAccessPoint &a, const WifiAccessPoint &b) {
+            return a.bssid < b.bssid;
+        });
+
+        entry.key = fingerprintKey(entry.scan);
+
+        auto indexIt = mIndex.find(entry.key);
+
+        if (indexIt != mIndex.end())
+            mEntries.erase(indexIt->second);
+
+        while (mEntries.size() >= mCapacity && !mEntries.empty()) {
+            mIndex.erase(mEntries.back().key);
+            mEntries.pop_back();
+        }
+
+        mEntries.push_front(entry);
+        mIndex[entry.key] = mEntries.begin();
+    }
+
+    fclose(fp);
+    mDirty = false;
+
+    LS_LOG_INFO("loaded %zu fingerprints from %s", mEntries.size(), mPath.c_str());
+
+    return true;
+}
+
+bool WifiFingerprintCache::save(size_t *written) {
+    FILE *fp = NULL;
+    std::string tmpPath = mPath + ".tmp";
+    long size = 0;
+    bool synced = false;
+
+    if (written)
+        *written = 0;
+
+    if (!mDirty || mPath.empty())
+        return true;
+
+    if ((fp = fopen(tmpPath.c_str(), "w")) == NULL) {
+        LS_LOG_ERROR("failed to open %s", tmpPath.c_str());
+        return false;
+    }
+
+    fprintf(fp, "%s\n", FINGERPRINT_CACHE_MAGIC);
+
+    for (auto it = mEntries.rbegin(); it != mEntries.rend(); ++it) {
+        fprintf(fp, "%" PRId64 " %.7f %.7f %f %zu", it->timestamp, it->latitude, it->longitude, it->accuracy,
+                it->scan.size());
+
+        for (const WifiAccessPoint &ap : it->scan)
+            fprintf(fp, " %012" PRIx64 "/%d", ap.bssid, ap.signal);
+
+        fprintf(fp, "\n");
+    }
+
+    // the rename must not reach flash before the data does
+    size = ftell(fp);
+    synced = fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+
+    if (fclose(fp) != 0 || !synced || rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+        LS_LOG_ERROR("failed to write %s", mPath.c_str());
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    if (written && size > 0)
+        *written = size;
+
+    mDirty = false;
+    return true;
+}
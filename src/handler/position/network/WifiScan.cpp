@@ -0,0 +1,155 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <WifiScan.h>
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+bool wifiBssidPack(const char *bssid, uint64_t *packed) {
+    uint64_t value = 0;
+
+    if (!bssid || !packed)
+        return false;
+
+    for (int i = 0; i < 6; i++) {
+        int high = hexValue(bssid[0]);
+        int low = (high < 0) ? -1 : hexValue(bssid[1]);
+
+        if (low < 0)
+            return false;
+
+        value = (value << 8) | (uint64_t) ((high << 4) | low);
+        bssid += 2;
+
+        if (i < 5) {
+            if (*bssid != ':' && *bssid != '-')
+                return false;
+            bssid++;
+        }
+    }
+
+    if (*bssid != '\0')
+        return false;
+
+    *packed = value;
+    return true;
+}
+
+void wifiBssidUnpack(uint64_t packed, char *bssid, size_t len) {
+    snprintf(bssid, len, "%02x:%02x:%02x:%02x:%02x:%02x",
+             (unsigned int) ((packed >> 40) & 0xff),
+             (unsigned int) ((packed >> 32) & 0xff),
+             (unsigned int) ((packed >> 24) & 0xff),
+             (unsigned int) ((packed >> 16) & 0xff),
+             (unsigned int) ((packed >> 8) & 0xff),
+             (unsigned int) (packed & 0xff));
+}
+
+void wifiScanFromTable(GHashTable *accessPoints, WifiScan &scan) {
+    GHashTableIter iter;
+    gpointer key = NULL;
+    gpointer value = NULL;
+    WifiAccessPoint ap;
+
+    scan.clear();
+
+    if (!accessPoints)
+        return;
+
+    scan.reserve(g_hash_table_size(accessPoints));
+    g_hash_table_iter_init(&iter, accessPoints);
+
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        if (!wifiBssidPack((const char *) key, &ap.bssid))
+            continue;
+
+        ap.signal = GPOINTER_TO_INT(value);
+        scan.push_back(ap);
+    }
+
+    std::sort(scan.begin(), scan.end(), [](const WifiAccessPoint &a, const WifiAccessPoint &b) {
+        return a.bssid < b.bssid;
+    });
+}
+
+// matched pairs are staged in fixed blocks so the delta loop has no branches and vectorizes
+#define SIGNAL_DELTA_BLOCK    64
+
+static int sumAbsDelta(const int *current, const int *previous, size_t count) {
+    int sum = 0;
+
+    for (size_t i = 0; i < count; i++)
+        sum += abs(current[i] - previous[i]);
+
+    return sum;
+}
+
+int wifiScanSignalChange(const WifiScan &current, const WifiScan &previous, unsigned int *vanished) {
+    int currentSignals[SIGNAL_DELTA_BLOCK];
+    int previousSignals[SIGNAL_DELTA_BLOCK];
+    size_t pending = 0;
+    size_t i = 0;
+    size_t j = 0;
+    unsigned int dropped = 0;
+    int sum = 0;
+
+    while (i < current.size() && j < previous.size()) {
+        if (current[i].bssid == previous[j].bssid) {
+            currentSignals[pending] = current[i++].signal;
+            previousSignals[pending] = previous[j++].signal;
+
+            if (++pending == SIGNAL_DELTA_BLOCK) {
+                sum += sumAbsDelta(currentSignals, previousSignals, pending);
+                pending = 0;
+            }
+        } else if (current[i].bssid < previous[j].bssid) {
+            sum += abs(current[i++].signal);
+        } else {
+            sum += abs(previous[j++].signal);
+            dropped++;
+        }
+    }
+
+    sum += sumAbsDelta(currentSignals, previousSignals, pending);
+
+    for (; i < current.size(); i++)
+        sum += abs(current[i].signal);
+
+    for (; j < previous.size(); j++) {
+        sum += abs(previous[j].signal);
+        dropped++;
+    }
+
+    if (vanished)
+        *vanished = dropped;
+
+    return sum;
+}
@@ -0,0 +1,237 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <string.h>
+#include <GeocodeBatch.h>
+#include <JsonUtility.h>
+#include <LunaLocationServiceUtil.h>
+#include <NetworkRequestManager.h>
+#include <ServiceAgent.h>
+#include <loc_log.h>
+
+GeocodeBatch::GeocodeBatch(LSHandle *sh, LSMessage *message, MapServicesInterface *geocoder, bool reverse,
+                           FinishedCb finishedCb)
+    : mHandle(sh),
+      mMessage(message),
+      mGeocoder(geocoder),
+      mReverse(reverse),
+      mStreaming(LSMessageIsSubscription(message)),
+      mFinishedCb(finishedCb),
+      mItems(0),
+      mNext(0),
+      mInFlight(0),
+      mMaxInFlight(MAX(NetworkRequestManager::getInstance()->getPriorityLimit(HTTP_PRIORITY_GEOCODING), 1u)) {
+    LSMessageRef(mMessage);
+}
+
+GeocodeBatch::~GeocodeBatch() {
+    for (jvalue_ref result : mResults) {
+        if (!jis_null(result))
+            j_release(&result);
+    }
+
+    LSMessageUnref(mMessage);
+}
+
+void GeocodeBatch::addItem(const std::string &query, const std::string &key) {
+    auto it = mRequestIndex.find(key);
+
+    if (it == mRequestIndex.end()) {
+        Request request;
+
+        request.query = query;
+        mRequests.push_back(request);
+        it = mRequestIndex.insert(std::make_pair(key, mRequests.size() - 1)).first;
+    }
+
+    mRequests[it->second].items.push_back(mItems++);
+    mResults.push_back(NULL);
+}
+
+void GeocodeBatch::start() {
+    LS_LOG_INFO("batch %p: %zu items in %zu requests", this, mItems, mRequests.size());
+    sendNext();
+}
+
+void GeocodeBatch::cancel() {
+    if (mInFlight)
+        mGeocoder->cancelRequest(mMessage);
+
+    mInFlight = 0;
+    mNext = mRequests.size();
+}
+
+void GeocodeBatch::sendNext() {
+    while (mInFlight < mMaxInFlight && mNext < mRequests.size()) {
+        size_t index = mNext++;
+        ErrorCodes error;
+
+        // the geocoder keeps each callback with its own request
+        if (mReverse) {
+            GeoLocation location(mRequests[index].query);
+
+            error = mGeocoder->reverseGeoCode(location, [this, index](GeoAddress &address, int errCode, LSMessage *) {
+                handleAnswer(index, address.toString(), errCode);
+            }, false, mMessage);
+        } else {
+            GeoAddress address(mRequests[index].query);
+
+            error = mGeocoder->geoCode(address, [this, index](GeoLocation &location, int errCode, LSMessage *) {
+                handleAnswer(index, location.toString(), errCode);
+            }, false, mMessage);
+        }
+
+        if (error == ERROR_NONE)
+            mInFlight++;
+        else
+            completeRequest(index, NULL, LOCATION_UNKNOWN_ERROR);
+    }
+
+    if (mInFlight == 0 && mNext == mRequests.size())
+        finish();
+}
+
+void GeocodeBatch::handleAnswer(size_t request, const std::string &response, int error) {
+    int errorCode = LOCATION_SUCCESS;
+
+    mInFlight--;
+
+    switch (error) {
+        case ERROR_NONE:
+            break;
+
+        case ERROR_TIMEOUT:
+            errorCode = LOCATION_TIME_OUT;
+            break;
+
+        // an HTTP error or a refused connection while online is no timeout
+        case ERROR_NETWORK_ERROR:
+            errorCode = NetworkRequestManager::getInstance()->isOnline() ? LOCATION_UNKNOWN_ERROR
+                                                                         : LOCATION_DATA_CONNECTION_OFF;
+            break;
+
+        default:
+            errorCode = LOCATION_UNKNOWN_ERROR;
+            break;
+    }
+
+    completeRequest(request, response.c_str(), errorCode);
+    sendNext();
+}
+
+void GeocodeBatch::completeRequest(size_t request, const char *response, int errorCode) {
+    for (size_t item : mRequests[request].items) {
+        jvalue_ref result = createItemResult(item, response, errorCode);
+
+        if (jis_null(result))
+            continue;
+
+        if (!mStreaming) {
+            mResults[item] = result;
+            continue;
+        }
+
+        // the call goes on, errorCode is the item's own
+        jobject_put(result, J_CSTR_TO_JVAL("returnValue"), jboolean_create(true));
+        reply(result);
+        j_release(&result);
+    }
+}
+
+jvalue_ref GeocodeBatch::createItemResult(size_t item, const char *response, int errorCode) {
+    jvalue_ref result = jobject_create();
+    jvalue_ref parsed = NULL;
+
+    if (jis_null(result))
+        return NULL;
+
+    jobject_put(result, J_CSTR_TO_JVAL("index"), jnumber_create_i64(item));
+
+    if (errorCode == LOCATION_SUCCESS && response) {
+        JSchemaInfo schemaInfo;
+
+        jschema_info_init(&schemaInfo, jschema_all(), NULL, NULL);
+        parsed = jdom_parse(j_cstr_to_buffer(response), DOMOPT_NOOPT, &schemaInfo);
+
+        if (jis_null(parsed))
+            errorCode = LOCATION_UNKNOWN_ERROR;
+    }
+
+    jobject_put(result, J_CSTR_TO_JVAL("errorCode"), jnumber_create_i32(errorCode));
+
+    if (errorCode != LOCATION_SUCCESS) {
+        jobject_put(result, J_CSTR_TO_JVAL("errorText"), jstring_create(LSMessageGetErrorText(errorCode)));
+        return result;
+    }
+
+    jobject_put(result, J_CSTR_TO_JVAL("response"), parsed);
+
+    return result;
+}
+
+void GeocodeBatch::reply(jvalue_ref serviceObject) {
+    LSError lsError;
+
+    LSErrorInit(&lsError);
+
+    if (!LSMessageReply(mHandle, mMessage, jvalue_tostring_simple(serviceObject), &lsError)) {
+        LSErrorPrint(&lsError, stderr);
+        LSErrorFree(&lsError);
+    }
+}
+
+void GeocodeBatch::finish() {
+    jvalue_ref serviceObject = jobject_create();
+    jvalue_ref resultsArray = NULL;
+
+    if (jis_null(serviceObject)) {
+        LSMessageReplyError(mHandle, mMessage, LOCATION_OUT_OF_MEM);
+        goto EXIT;
+    }
+
+    location_util_form_json_reply(serviceObject, true, LOCATION_SUCCESS);
+
+    if (mStreaming) {
+        jobject_put(serviceObject, J_CSTR_TO_JVAL("completed"), jboolean_create(true));
+        jobject_put(serviceObject, J_CSTR_TO_JVAL("count"), jnumber_create_i64(mItems));
+    } else {
+        resultsArray = jarray_create(NULL);
+
+        if (jis_null(resultsArray)) {
+            LSMessageReplyError(mHandle, mMessage, LOCATION_OUT_OF_MEM);
+            goto EXIT;
+        }
+
+        for (jvalue_ref &result : mResults) {
+            if (!jis_null(result))
+                jarray_append(resultsArray, result);
+
+            result = NULL;
+        }
+
+        jobject_put(serviceObject, J_CSTR_TO_JVAL("results"), resultsArray);
+    }
+
+    reply(serviceObject);
+
+    EXIT:
+    if (!jis_null(serviceObject))
+        j_release(&serviceObject);
+
+    // last, the owner deletes the batch
+    mFinishedCb(this);
+}
@@ -20,6 +20,10 @@
 #include "MockLocation.h"
 #include <JsonUtility.h>
 #include <LunaLocationServiceUtil.h>
+#include <DnsResolver.h>
+#include <WorkerPool.h>
+#include <ReverseGeocodeCache.h>
+#include <GeocodeCache.h>
 #include <lunaprefs.h>
 #include <random>
 
@@ -40,6 +44,9 @@ LSMethod LocationService::rootMethod[] = {
         {"getNmeaData",               LocationService::_getNmeaData},
         {"getReverseLocation",        LocationService::_getReverseLocation},
         {"getGeoCodeLocation",        LocationService::_getGeoCodeLocation},
+        {"getGeoCodeCandidates",      LocationService::_getGeoCodeCandidates},
+        {"getGeoCodeBatch",           LocationService::_getGeoCodeBatch},
+        {"getReverseGeocodeBatch",    LocationService::_getReverseGeocodeBatch},
         {"getAllLocationHandlers",    LocationService::_getAllLocationHandlers},
         {"getGpsStatus",              LocationService::_getGpsStatus},
         {"setState",                  LocationService::_setState},
@@ -57,6 +64,7 @@ LSMethod LocationService::rootMethod[] = {
  methods belonging to root private category
  */
 LSMethod LocationService::prvMethod[] = {
+        {"getServiceMetrics", LocationService::_getServiceMetrics},
 //        {"sendExtraCommand", LocationService::_sendExtraCommand},
 //        {"stopGPS",          LocationService::_stopGPS},
  //       {"exitLocation",     LocationService::_exitLocation},
@@ -165,12 +173,22 @@ bool LocationService::init(GMainLoop *mainLoop) {
     mNetworkProvider->setCallback(this);
 
     mGPSProvider = GPSPositionProvider::getInstance();
+
+    StoreWritePolicy storePolicy;
+    storePolicy.mode = (StoreDurabilityMode) mGPSProvider->mGPSConf.mStoreDurabilityMode;
+    storePolicy.maxWritesPerHour = mGPSProvider->mGPSConf.mStoreMaxWritesPerHour;
+    storePolicy.maxBytesPerHour = mGPSProvider->mGPSConf.mStoreMaxBytesPerHour;
+    storePolicy.flushIntervalSec = mGPSProvider->mGPSConf.mStoreFlushInterval;
+    set_store_write_policy(&storePolicy);
+
     bool bGPSEnabled = mGPSProvider->init(mServiceHandle);
     if (bGPSEnabled) {
         mGPSProvider->enable();
         mGPSProvider->setCallback(this);
     }
 
+    mLastPositions.warmUp();
+
     //Load initial settings from DB
     mGpsStatus = loadHandlerStatus(GPS);
     mNwStatus = loadHandlerStatus(NETWORK);
@@ -324,10 +342,23 @@ bool LocationService::deinit() {
         m_lifeCycleMonitor = NULL;
     }
 
+    for (auto &entry : mGeocodeBatches) {
+        entry.second->cancel();
+        delete entry.second;
+    }
+
+    mGeocodeBatches.clear();
+
     mNetReqMgr->deInit();
 
     delete mNetworkProvider;
 
+    WorkerPool::getInstance()->stop();
+
+    ReverseGeocodeCache::getInstance()->save();
+
+    flush_stored_positions();
+
     return true;
 }
 
@@ -408,7 +439,6 @@ bool LocationService::getNmeaData(LSHandle *sh, LSMessage *message, void *data)
 
 void LocationService::getReverseGeocodeData(jvalue_ref *parsedObj, GString **posData, Position *pos) {
     jvalue_ref jsonSubObject = NULL;
-    jvalue_ref arrObject = NULL;
     std::string strlat;
     std::string strlng;
 
@@ -427,34 +457,40 @@ void LocationService::getReverseGeocodeData(jvalue_ref *parsedObj, GString **pos
     g_string_append(*posData, ",");
     g_string_append(*posData, strlng.c_str());
 
+    appendReverseGeocodeParams(parsedObj, *posData);
+}
+
+void LocationService::appendReverseGeocodeParams(jvalue_ref *parsedObj, GString *posData) {
+    jvalue_ref jsonSubObject = NULL;
+    jvalue_ref arrObject = NULL;
     raw_buffer nameBuf;
 
     if (jobject_get_exists(*parsedObj, J_CSTR_TO_BUF("language"), &jsonSubObject)) {
         nameBuf = jstring_get(jsonSubObject);
-        g_string_append(*posData, "&language=");
-        g_string_append(*posData, nameBuf.m_str);
+        g_string_append(posData, "&language=");
+        g_string_append(posData, nameBuf.m_str);
         jstring_free_buffer(nameBuf);
     }
 
     if (jobject_get_exists(*parsedObj, J_CSTR_TO_BUF("result_type"), &jsonSubObject)) {
         long int size = jarray_size(jsonSubObject);
-        g_string_append(*posData, "&result_type=");
+        g_string_append(posData, "&result_type=");
         LS_LOG_DEBUG("result_type size [%d]", size);
         for (int i = 0; i < size; i++) {
             arrObject = jarray_get(jsonSubObject, i);
             nameBuf = jstring_get(arrObject);
 
             if (i > 0)
-                g_string_append(*posData, "|");
+                g_string_append(posData, "|");
 
-            g_string_append(*posData, nameBuf.m_str);
+            g_string_append(posData, nameBuf.m_str);
             jstring_free_buffer(nameBuf);
         }
     }
 
     if (jobject_get_exists(*parsedObj, J_CSTR_TO_BUF("location_type"), &jsonSubObject)) {
         long int size = jarray_size(jsonSubObject);
-        g_string_append(*posData, "&location_type=");
+        g_string_append(posData, "&location_type=");
         LS_LOG_DEBUG("location_type size [%d]", size);
 
         for (long int i = 0; i < size; i++) {
@@ -462,9 +498,9 @@ void LocationService::getReverseGeocodeData(jvalue_ref *parsedObj, GString **pos
             nameBuf = jstring_get(arrObject);
 
             if (i > 0)
-                g_string_append(*posData, "|");
+                g_string_append(posData, "|");
 
-            g_string_append(*posData, nameBuf.m_str);
+            g_string_append(posData, nameBuf.m_str);
 
             jstring_free_buffer(nameBuf);
         }
@@ -489,11 +525,6 @@ bool LocationService::getReverseLocation(LSHandle *sh, LSMessage *message, void
         goto EXIT;
     }
 
-    if (!isInternetConnectionAvailable /*&& !isWifiInternetAvailable*/) {
-        errorCode = LOCATION_DATA_CONNECTION_OFF;
-        goto EXIT;
-    }
-
     getReverseGeocodeData(&parsedObj, &posData, &pos);
     geoLocInfo = GeoLocation(posData->str);
 
@@ -645,11 +676,6 @@ bool LocationService::getGeoCodeLocation(LSHandle *sh, LSMessage *message,
         goto EXIT;
     }
 
-    if (!isInternetConnectionAvailable /*&& !isWifiInternetAvailable*/) {
-        errorCode = LOCATION_DATA_CONNECTION_OFF;
-        goto EXIT;
-    }
-
     if ((!jobject_get_exists(parsedObj, J_CSTR_TO_BUF("address"),
                              &jsonSubObject))
         && (!jobject_get_exists(parsedObj, J_CSTR_TO_BUF("components"),
@@ -702,6 +728,272 @@ bool LocationService::getGeoCodeLocation(LSHandle *sh, LSMessage *message,
     return true;
 }
 
+/**
+ * Answers an as-you-type client from the geocode cache only: every cached
+ * forward geocoding whose normalized address starts with the given text and
+ * that was asked with the same language and region.
+ */
+bool LocationService::getGeoCodeCandidates(LSHandle *sh, LSMessage *message, void *data) {
+    printMessageDetails("LUNA-API", message, sh);
+    jvalue_ref parsedObj = NULL;
+    jvalue_ref jsonSubObject = NULL;
+    jvalue_ref serviceObject = NULL;
+    jvalue_ref candidatesArray = NULL;
+    raw_buffer nameBuf;
+    GString *addressData = NULL;
+    int errorCode = LOCATION_SUCCESS;
+    int64_t maxResults = GEOCODE_CANDIDATES_MAX;
+    std::vector<GeocodeCandidate> candidates;
+    JSchemaInfo schemaInfo;
+    LSError lsError;
+
+    if (!LSMessageValidateSchemaReplyOnError(sh, message, JSCHEMA_GET_GEOCODE_CANDIDATES, &parsedObj)) {
+        LS_LOG_ERROR("Schema Error in getGeoCodeCandidates");
+        return true;
+    }
+
+    if (jobject_get_exists(parsedObj, J_CSTR_TO_BUF("maxResults"), &jsonSubObject))
+        jnumber_get_i64(jsonSubObject, &maxResults);
+
+    // address is required by the schema
+    jobject_get_exists(parsedObj, J_CSTR_TO_BUF("address"), &jsonSubObject);
+    nameBuf = jstring_get(jsonSubObject);
+    addressData = g_string_new("address=");
+    g_string_append(addressData, nameBuf.m_str);
+    jstring_free_buffer(nameBuf);
+
+    // the parameters getGeoCodeLocation would send, the cache keys on them
+    getGeocodeData(&parsedObj, addressData);
+
+    GeocodeCache::getInstance()->findCandidates(addressData->str, g_get_real_time() / 1000, maxResults, candidates);
+
+    serviceObject = jobject_create();
+    candidatesArray = jarray_create(NULL);
+
+    if (jis_null(serviceObject) || jis_null(candidatesArray)) {
+        errorCode = LOCATION_OUT_OF_MEM;
+        goto EXIT;
+    }
+
+    jschema_info_init(&schemaInfo, jschema_all(), NULL, NULL);
+
+    for (const GeocodeCandidate &candidate : candidates) {
+        jvalue_ref response = jdom_parse(j_cstr_to_buffer(candidate.response.c_str()), DOMOPT_NOOPT, &schemaInfo);
+        jvalue_ref candidateObject = NULL;
+
+        if (jis_null(response))
+            continue;
+
+        candidateObject = jobject_create();
+
+        if (jis_null(candidateObject)) {
+            j_release(&response);
+            continue;
+        }
+
+        jobject_put(candidateObject, J_CSTR_TO_JVAL("address"), jstring_create(candidate.address.c_str()));
+        jobject_put(candidateObject, J_CSTR_TO_JVAL("response"), response);
+        jarray_append(candidatesArray, candidateObject);
+    }
+
+    location_util_form_json_reply(serviceObject, true, LOCATION_SUCCESS);
+    jobject_put(serviceObject, J_CSTR_TO_JVAL("candidates"), candidatesArray);
+    candidatesArray = NULL;
+
+    LSErrorInit(&lsError);
+
+    if (!LSMessageReply(sh, message, jvalue_tostring_simple(serviceObject), &lsError))
+        LSErrorPrintAndFree(&lsError);
+
+    EXIT:
+    if (errorCode != LOCATION_SUCCESS)
+        LSMessageReplyError(sh, message, errorCode);
+
+    if (!jis_null(candidatesArray))
+        j_release(&candidatesArray);
+
+    if (!jis_null(serviceObject))
+        j_release(&serviceObject);
+
+    if (!jis_null(parsedObj))
+        j_release(&parsedObj);
+
+    if (addressData != NULL)
+        g_string_free(addressData, TRUE);
+
+    return true;
+}
+
+
+/**
+ * Geocodes up to GEOCODE_BATCH_MAX_ITEMS addresses in one call, see GeocodeBatch
+ */
+bool LocationService::getGeoCodeBatch(LSHandle *sh, LSMessage *message, void *data) {
+    printMessageDetails("LUNA-API", message, sh);
+    jvalue_ref parsedObj = NULL;
+    jvalue_ref addressesArray = NULL;
+    GString *paramsData = NULL;
+    GeocodeBatch *batch = NULL;
+    raw_buffer nameBuf;
+    int errorCode = LOCATION_SUCCESS;
+
+    if (!LSMessageValidateSchemaReplyOnError(sh, message, JSCHEMA_GET_GEOCODE_BATCH, &parsedObj)) {
+        LS_LOG_ERROR("Schema Error in getGeoCodeBatch");
+        return true;
+    }
+
+    errorCode = mLBSProvider->readWSPConfiguration();
+    if (errorCode != LOCATION_SUCCESS) {
+        goto EXIT;
+    }
+
+    // language and region apply to every address
+    paramsData = g_string_new(NULL);
+    getGeocodeData(&parsedObj, paramsData);
+
+    batch = new GeocodeBatch(sh, message, mLBSProvider->getGeocodeImpl(), false,
+                             bind(&LocationService::geocodeBatchFinished, this, placeholders::_1));
+
+    // addresses is required by the schema
+    jobject_get_exists(parsedObj, J_CSTR_TO_BUF("addresses"), &addressesArray);
+
+    for (ssize_t i = 0; i < jarray_size(addressesArray); i++) {
+        nameBuf = jstring_get(jarray_get(addressesArray, i));
+        std::string address(nameBuf.m_str);
+        jstring_free_buffer(nameBuf);
+
+        std::replace(address.begin(), address.end(), ' ', '+');
+
+        std::string query = "address=" + address + paramsData->str;
+        batch->addItem(query, GeocodeCache::makeKey(query));
+    }
+
+    startGeocodeBatch(sh, message, batch);
+
+    EXIT:
+    if (errorCode != LOCATION_SUCCESS)
+        LSMessageReplyError(sh, message, errorCode);
+
+    if (!jis_null(parsedObj))
+        j_release(&parsedObj);
+
+    if (paramsData != NULL)
+        g_string_free(paramsData, TRUE);
+
+    return true;
+}
+
+/**
+ * Reverse geocodes up to GEOCODE_BATCH_MAX_ITEMS locations in one call, see GeocodeBatch
+ */
+bool LocationService::getReverseGeocodeBatch(LSHandle *sh, LSMessage *message, void *data) {
+    printMessageDetails("LUNA-API", message, sh);
+    jvalue_ref parsedObj = NULL;
+    jvalue_ref locationsArray = NULL;
+    jvalue_ref jsonSubObject = NULL;
+    GString *paramsData = NULL;
+    GeocodeBatch *batch = NULL;
+    std::string params;
+    int errorCode = LOCATION_SUCCESS;
+
+    if (!LSMessageValidateSchemaReplyOnError(sh, message, JSCHEMA_GET_REVERSE_GEOCODE_BATCH, &parsedObj)) {
+        LS_LOG_ERROR("Schema Error in getReverseGeocodeBatch");
+        return true;
+    }
+
+    errorCode = mLBSProvider->readWSPConfiguration();
+    if (errorCode != LOCATION_SUCCESS) {
+        goto EXIT;
+    }
+
+    // language, result_type and location_type apply to every location
+    paramsData = g_string_new(NULL);
+    appendReverseGeocodeParams(&parsedObj, paramsData);
+    params = paramsData->len ? paramsData->str + 1 : "";
+
+    batch = new GeocodeBatch(sh, message, mLBSProvider->getGeocodeImpl(), true,
+                             bind(&LocationService::geocodeBatchFinished, this, placeholders::_1));
+
+    // locations is required by the schema, and latitude and longitude in each
+    jobject_get_exists(parsedObj, J_CSTR_TO_BUF("locations"), &locationsArray);
+
+    for (ssize_t i = 0; i < jarray_size(locationsArray); i++) {
+        jvalue_ref locationObject = jarray_get(locationsArray, i);
+        double latitude = 0;
+        double longitude = 0;
+
+        if (jobject_get_exists(locationObject, J_CSTR_TO_BUF("latitude"), &jsonSubObject))
+            jnumber_get_f64(jsonSubObject, &latitude);
+
+        if (jobject_get_exists(locationObject, J_CSTR_TO_BUF("longitude"), &jsonSubObject))
+            jnumber_get_f64(jsonSubObject, &longitude);
+
+        std::string query = "latlng=" + std::to_string(latitude) + "," + std::to_string(longitude) + paramsData->str;
+
+        // locations in one cache cell share an answer, as they would in the cache
+        batch->addItem(query, ReverseGeocodeCache::makeKey(latitude, longitude, params, ""));
+    }
+
+    startGeocodeBatch(sh, message, batch);
+
+    EXIT:
+    if (errorCode != LOCATION_SUCCESS)
+        LSMessageReplyError(sh, message, errorCode);
+
+    if (!jis_null(parsedObj))
+        j_release(&parsedObj);
+
+    if (paramsData != NULL)
+        g_string_free(paramsData, TRUE);
+
+    return true;
+}
+
+void LocationService::startGeocodeBatch(LSHandle *sh, LSMessage *message, GeocodeBatch *batch) {
+    LSError lsError;
+    const char *token = LSMessageGetUniqueToken(message);
+
+    // luna reports a cancelled call only for a message in its subscription list
+    if (LSMessageIsSubscription(message)) {
+        LSErrorInit(&lsError);
+
+        if (!LSSubscriptionAdd(sh, LSMessageGetMethod(message), message, &lsError))
+            LSErrorPrintAndFree(&lsError);
+    }
+
+    mGeocodeBatches[token ? token : ""] = batch;
+
+    // may finish at once, when every request failed to start
+    batch->start();
+}
+
+void LocationService::geocodeBatchFinished(GeocodeBatch *batch) {
+    for (auto it = mGeocodeBatches.begin(); it != mGeocodeBatches.end(); ++it) {
+        if (it->second == batch) {
+            mGeocodeBatches.erase(it);
+            break;
+        }
+    }
+
+    delete batch;
+}
+
+bool LocationService::cancelGeocodeBatch(LSMessage *message) {
+    const char *token = LSMessageGetUniqueToken(message);
+    auto it = mGeocodeBatches.find(token ? token : "");
+
+    if (it == mGeocodeBatches.end())
+        return false;
+
+    LS_LOG_INFO("geocode batch %s cancelled", it->first.c_str());
+
+    it->second->cancel();
+    delete it->second;
+    mGeocodeBatches.erase(it);
+
+    return true;
+}
+
 
 bool LocationService::getAllLocationHandlers(LSHandle *sh, LSMessage *message, void *data) {
     printMessageDetails("LUNA-API", message, sh);
@@ -851,6 +1143,61 @@ bool LocationService::getGpsStatus(LSHandle *sh, LSMessage *message, void *data)
     return true;
 }
 
+/**
+ * <Funciton >   getServiceMetrics
+ * <Description>  API to get the I/O and request counters of the service
+ * @param     LunaService handle
+ * @param     LunaService message
+ * @param     user data
+ * @return    bool, if successful return true else false
+ */
+bool LocationService::getServiceMetrics(LSHandle *sh, LSMessage *message, void *data) {
+    printMessageDetails("LUNA-API", message, sh);
+    LSError mLSError;
+    jvalue_ref serviceObject = NULL;
+    jvalue_ref parsedObj = NULL;
+
+    LSErrorInit(&mLSError);
+
+    if (!LSMessageValidateSchemaReplyOnError(sh, message, JSCHEMA_GET_SERVICE_METRICS, &parsedObj)) {
+        LS_LOG_ERROR("Schema Error in getServiceMetrics");
+        return true;
+    }
+
+    serviceObject = jobject_create();
+
+    if (jis_null(serviceObject)) {
+        LSMessageReplyError(sh, message, LOCATION_OUT_OF_MEM);
+        goto EXIT;
+    }
+
+    location_util_form_json_reply(serviceObject, true, LOCATION_SUCCESS);
+
+    if (!append_store_write_stats(serviceObject) ||
+        !mNetworkProvider->appendStats(serviceObject) ||
+        !NetworkRequestManager::getInstance()->appendStats(serviceObject) ||
+        !DnsResolver::getInstance()->appendStats(serviceObject) ||
+        !WorkerPool::getInstance()->appendStats(serviceObject) ||
+        !ReverseGeocodeCache::getInstance()->appendStats(serviceObject) ||
+        !GeocodeCache::getInstance()->appendStats(serviceObject)) {
+        LSMessageReplyError(sh, message, LOCATION_OUT_OF_MEM);
+        goto EXIT;
+    }
+
+    if (!LSMessageReply(sh, message, jvalue_tostring_simple(serviceObject), &mLSError))
+        LSErrorPrintAndFree(&mLSError);
+
+    EXIT:
+
+    if (!jis_null(parsedObj))
+        j_release(&parsedObj);
+
+    if (!jis_null(serviceObject))
+        j_release(&serviceObject);
+
+    return true;
+}
+
 bool LocationService::getState(LSHandle *sh, LSMessage *message, void *data) {
     printMessageDetails("LUNA-API", message, sh);
     int state;
@@ -2061,6 +2408,7 @@ bool LocationService::getLocationUpdates(LSHandle *sh, LSMessage *message, void
         }
         /********Request NWHandler*****************************/
         if (startedHandlers & HANDLER_NETWORK_BIT) {
+            updateNetworkSubscriberInterval(NULL);
             errorCode = mNetworkProvider->processRequest(PositionRequest("network", POSITION_CMD));
             goto EXIT;
         }
@@ -2092,16 +2440,19 @@ bool LocationService::getCachedPosition(LSHandle *sh, LSMessage *message, void *
     int errorCode = LOCATION_SUCCESS;
     Position pos;
     Accuracy acc;
-    Position gpspos;
-    Accuracy gpsacc ;
-    Position nwpos;
-    Accuracy nwacc;
     jvalue_ref parsedObj = NULL;
     jvalue_ref handlerObj = NULL;
     jvalue_ref serviceObj = NULL;
     jvalue_ref maximumAgeObj = NULL;
+    jvalue_ref maximumAccuracyObj = NULL;
+    jvalue_ref allCandidatesObj = NULL;
+    jvalue_ref candidatesArray = NULL;
     char *handlerName = NULL;
     int maximumAge = 0;
+    double maximumAccuracy = 0;
+    bool allCandidates = false;
+    HandlerTypes handlerType = HANDLER_HYBRID;
+    std::vector<LastPositionCandidate> candidates;
     bool bRetVal;
 
     LSErrorInit(&lsError);
@@ -2120,10 +2471,6 @@ bool LocationService::getCachedPosition(LSHandle *sh, LSMessage *message, void *
     }
 
     memset(&pos, 0x00, sizeof(Position));
-    memset(&gpspos, 0x00, sizeof(Position));
-    memset(&nwpos, 0x00, sizeof(Position));
-    memset(&gpsacc, 0x00, sizeof(Accuracy));
-    memset(&nwacc, 0x00, sizeof(Accuracy));
     memset(&acc, 0x00, sizeof(Accuracy));
     /*Parse Handler name*/
     if (jobject_get_exists(parsedObj, J_CSTR_TO_BUF("Handler"), &handlerObj)) {
@@ -2134,47 +2481,57 @@ bool LocationService::getCachedPosition(LSHandle *sh, LSMessage *message, void *
     } else {
         handlerName = g_strdup(HYBRID);
     }
-    //check in cache first if maximumAge is -1
 
     if (jobject_get_exists(parsedObj, J_CSTR_TO_BUF("maximumAge"), &maximumAgeObj)) {
         jnumber_get_i32(maximumAgeObj, &maximumAge);
     }
 
-    LS_LOG_INFO("maximumAge= %d", maximumAge);
-
-    if (strcmp(handlerName, GPS) == 0) {
-        mGPSProvider->getLastPosition(&pos,
-                                      &acc);
+    if (jobject_get_exists(parsedObj, J_CSTR_TO_BUF("maximumAccuracy"), &maximumAccuracyObj)) {
+        jnumber_get_f64(maximumAccuracyObj, &maximumAccuracy);
+    }
 
-    } else if (strcmp(handlerName, NETWORK) == 0) {
-        mNetworkProvider->getLastPosition(&pos,
-                                          &acc);
+    if (jobject_get_exists(parsedObj, J_CSTR_TO_BUF("allCandidates"), &allCandidatesObj)) {
+        jboolean_get(allCandidatesObj, &allCandidates);
+    }
 
-    } else if (strcmp(handlerName, HYBRID) == 0 || strcmp(handlerName, PASSIVE) == 0) {
-        mGPSProvider->getLastPosition(&gpspos,
-                                      &gpsacc);
+    LS_LOG_INFO("maximumAge= %d maximumAccuracy= %f", maximumAge, maximumAccuracy);
 
-        mNetworkProvider->getLastPosition(&nwpos,
-                                          &nwacc);
+    if (strcmp(handlerName, GPS) == 0)
+        handlerType = HANDLER_GPS;
+    else if (strcmp(handlerName, NETWORK) == 0)
+        handlerType = HANDLER_NETWORK;
 
-        pos = comparePositionTimeStamps(gpspos,
-                                        nwpos,
-                                        gpsacc,
-                                        nwacc,
-                                        &acc);
+    // answered from the in-memory index, the stores on flash are only read at startup
+    if (mLastPositions.getCandidates(handlerType, maximumAge, maximumAccuracy, candidates) == 0) {
+        errorCode = LOCATION_POS_NOT_AVAILABLE;
+        goto EXIT;
     }
 
-    if (pos.latitude == 0 || pos.longitude == 0) {
-        errorCode = LOCATION_POS_NOT_AVAILABLE;
-    } else {
-        if (maximumAge > 0) {
-            struct timeval tv;
-            gettimeofday(&tv, (struct timezone *) NULL);
-            long long currentTime = tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+    pos = candidates[0].position;
+    acc = candidates[0].accuracy;
 
-            if (maximumAge < (currentTime - pos.timestamp)) {
-                errorCode = LOCATION_POS_NOT_AVAILABLE;
-            }
+    for (size_t i = 1; i < candidates.size(); i++)
+        pos = comparePositionTimeStamps(pos, candidates[i].position, acc, candidates[i].accuracy, &acc);
+
+    if (allCandidates) {
+        candidatesArray = jarray_create(NULL);
+
+        if (jis_null(candidatesArray)) {
+            errorCode = LOCATION_OUT_OF_MEM;
+            goto EXIT;
+        }
+
+        for (size_t i = 0; i < candidates.size(); i++) {
+            jvalue_ref candidateObj = jobject_create();
+
+            if (jis_null(candidateObj))
+                continue;
+
+            jobject_put(candidateObj, J_CSTR_TO_JVAL("source"),
+                        jstring_create(LastPositionIndex::getSourceName(candidates[i].source)));
+            location_util_add_pos_json(candidateObj, &candidates[i].position);
+            location_util_add_acc_json(candidateObj, &candidates[i].accuracy);
+            jarray_append(candidatesArray, candidateObj);
         }
     }
 
@@ -2188,12 +2545,20 @@ bool LocationService::getCachedPosition(LSHandle *sh, LSMessage *message, void *
         location_util_add_pos_json(serviceObj, &pos);
         location_util_add_acc_json(serviceObj, &acc);
 
+        if (!jis_null(candidatesArray)) {
+            jobject_put(serviceObj, J_CSTR_TO_JVAL("candidates"), candidatesArray);
+            candidatesArray = NULL;
+        }
+
         bRetVal = LSMessageReply(sh, message, jvalue_tostring_simple(serviceObj), &lsError);
 
         if (bRetVal == false)
             LSErrorPrintAndFree(&lsError);
     }
 
+    if (!jis_null(candidatesArray))
+        j_release(&candidatesArray);
+
     if (!jis_null(serviceObj)) {
         LS_LOG_INFO("getCachedPosition reply payload %s", jvalue_tostring_simple(serviceObj));
         j_release(&serviceObj);
@@ -2208,10 +2573,10 @@ bool LocationService::getCachedPosition(LSHandle *sh, LSMessage *message, void *
     return true;
 }
 
-Position LocationService::comparePositionTimeStamps(Position pos1,
-                                                    Position pos2,
-                                                    Accuracy acc1,
-                                                    Accuracy acc2,
+Position LocationService::comparePositionTimeStamps(const Position &pos1,
+                                                    const Position &pos2,
+                                                    const Accuracy &acc1,
+                                                    const Accuracy &acc2,
                                                     Accuracy *retAcc) {
     Position pos;
     memset(&pos, 0x00, sizeof(Position));
@@ -2405,6 +2770,17 @@ void LocationService::getLocationUpdateCb(GeoLocation& location, ErrorCodes errC
     acc.horizAccuracy = location.getHorizontalAccuracy();
     acc.vertAccuracy = location.getVerticalAccuracy();
 
+    if (errCode == ERROR_NONE) {
+        struct _mock_location_provider *mlp = get_mock_location_provider(HANDLER_GPS == type ? GPS : NETWORK);
+        bool isMock = mlp && (mlp->flag & MOCKLOC_FLAG_STARTED);
+
+        mLastPositions.update(isMock ? LAST_POSITION_MOCK : (HANDLER_GPS == type ? LAST_POSITION_GPS : LAST_POSITION_NETWORK),
+                              type, pos, acc);
+
+        if (HANDLER_GPS == type && !isMock && mNetworkProvider)
+            mNetworkProvider->trainFromGpsFix(pos.latitude, pos.longitude, acc.horizAccuracy, pos.speed);
+    }
+
     if ((HANDLER_NETWORK == type)&&(ERROR_NETWORK_ERROR == errCode))
         getLocationUpdate_reply(NULL, NULL, errCode, type);
     else
@@ -2963,6 +3339,19 @@ void LocationService::sendPositionData(GObject *source, GAsyncResult *res, gpoin
                                                          &posData->acc,
                                                          SUBSC_GET_LOC_UPDATES_PASSIVE_KEY,
                                                          posData->retString2);
+
+    /*a good enough GPS fix also stands in for the network position*/
+    if (posData->error == ERROR_NONE && locService->mNetworkProvider) {
+        struct _mock_location_provider *mlp = get_mock_location_provider(GPS);
+        bool isMock = mlp && (mlp->flag & MOCKLOC_FLAG_STARTED);
+
+        if (!isMock && locService->mNetworkProvider->feedFromGpsFix(posData->pos.timestamp,
+                                                                    posData->acc.horizAccuracy))
+            locService->LSSubNonSubRespondGetLocUpdateCasePubPri(&posData->pos,
+                                                                 &posData->acc,
+                                                                 SUBSC_GET_LOC_UPDATES_NW_KEY,
+                                                                 posData->retString1);
+    }
 }
 
 void LocationService::positionDataUnref(gpointer data) {
@@ -3167,6 +3556,7 @@ void LocationService::getLocationUpdate_reply(Position *pos, Accuracy *accuracy,
         posData->key2 = g_strdup(key2);
         posData->retString1 = g_strdup(retString);
         posData->retString2 = g_strdup(jvalue_tostring_simple(serviceObject));
+        posData->error = error;
         g_simple_async_result_set_op_res_gpointer(asyncRes, posData, positionDataUnref);
         g_simple_async_result_complete_in_idle(asyncRes);
         g_object_unref(asyncRes);
@@ -3215,6 +3605,11 @@ void LocationService::geocodingReply(const char *response, int error, LSMessage
             goto EXIT;
         }
             break;
+        case ERROR_TIMEOUT: {
+            retString = LSMessageGetErrorReply(LOCATION_TIME_OUT);
+            goto EXIT;
+        }
+            break;
         case ERROR_NETWORK_ERROR: {
             if (getConnectionManagerState())
                 retString = LSMessageGetErrorReply(LOCATION_TIME_OUT);
@@ -3334,6 +3729,8 @@ bool LocationService::cancelSubscription(LSHandle *sh, LSMessage *message, void
         getLocRequestStopSubscription(sh, message);
         LSMessageRemoveReqList(message);
 
+    } else if (strcmp(key, SUBSC_GET_GEOCODE_BATCH_KEY) == 0 || strcmp(key, SUBSC_GET_REVGEOCODE_BATCH_KEY) == 0) {
+        cancelGeocodeBatch(message);
     } else if (!isSubscListFilled(message, key, true)) {
             stopSubcription(sh, key);
     }
@@ -3360,6 +3757,8 @@ void LocationService::getLocRequestStopSubscription(LSHandle *sh, LSMessage *mes
         !isSubscListFilled(message, SUBSC_GET_LOC_UPDATES_HYBRID_KEY, true)) {
         LS_LOG_INFO("getLocRequestStopSubscription Stopping NW handler");
         stopSubcription(sh, SUBSC_GET_LOC_UPDATES_NW_KEY);
+    } else {
+        updateNetworkSubscriberInterval(message);
     }
 
     if (!isSubscListFilled(message, SUBSC_GET_LOC_UPDATES_GPS_KEY, true) &&
@@ -3370,6 +3769,60 @@ void LocationService::getLocRequestStopSubscription(LSHandle *sh, LSMessage *mes
 
 }
 
+/**
+ * <Funciton >   updateNetworkSubscriberInterval
+ * <Description>  Set the network scan floor to the tightest minimumInterval among the
+ *                live network and hybrid subscribers
+ * @param     message about to leave the subscription lists, or NULL
+ * @return    void
+ */
+void LocationService::updateNetworkSubscriberInterval(LSMessage *leaving) {
+    const char *keys[] = {SUBSC_GET_LOC_UPDATES_NW_KEY, SUBSC_GET_LOC_UPDATES_HYBRID_KEY};
+    JSchemaInfo schemaInfo;
+    int minInterval = -1;
+    LSError error;
+
+    LSErrorInit(&error);
+    jschema_info_init(&schemaInfo, jschema_all(), NULL, NULL);
+
+    for (const char *key : keys) {
+        LSSubscriptionIter *iter = NULL;
+
+        if (!LSSubscriptionAcquire(mServiceHandle, key, &iter, &error)) {
+            LSErrorPrintAndFree(&error);
+            continue;
+        }
+
+        while (LSSubscriptionHasNext(iter)) {
+            LSMessage *msg = LSSubscriptionNext(iter);
+            jvalue_ref parsedObj = NULL;
+            jvalue_ref intervalObj = NULL;
+            int interval = 0;
+
+            if (msg == leaving)
+                continue;
+
+            parsedObj = jdom_parse(j_cstr_to_buffer(LSMessageGetPayload(msg)), DOMOPT_NOOPT, &schemaInfo);
+
+            if (!jis_null(parsedObj)) {
+                if (jobject_get_exists(parsedObj, J_CSTR_TO_BUF("minimumInterval"), &intervalObj))
+                    jnumber_get_i32(intervalObj, &interval);
+
+                j_release(&parsedObj);
+            }
+
+            if (minInterval < 0 || interval < minInterval)
+                minInterval = interval;
+        }
+
+        LSSubscriptionRelease(iter);
+    }
+
+    // with no subscriber left the provider is stopped, which resets the scheduler
+    if (minInterval >= 0)
+        mNetworkProvider->setSubscriberInterval(minInterval);
+}
+
 bool LocationService::getHandlerStatus(const char *handler) {
     LS_LOG_INFO("getHandlerStatus handler %s", handler);
 
@@ -3672,6 +4125,10 @@ void LocationService::LSSubNonSubReplyLocUpdateCase(Position *pos,
             LS_LOG_DEBUG("key %s empty", key);
             stopNonSubcription(key);
         }
+
+        // the one-shot requests just answered may have held the tightest interval
+        if (strcmp(key, SUBSC_GET_LOC_UPDATES_GPS_KEY) != 0)
+            updateNetworkSubscriberInterval(NULL);
     }
 }
 
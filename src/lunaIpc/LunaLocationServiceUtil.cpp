@@ -108,6 +108,13 @@ char *LSMessageGetErrorReply(int errorCode) {
     return locationErrorReply[errorCode];
 }
 
+const char *LSMessageGetErrorText(int errorCode) {
+    if (errorCode < 0 || errorCode >= LOCATION_ERROR_MAX)
+        return "";
+
+    return mapLocErrorText[errorCode].text;
+}
+
 void LSMessageReplyError(LSHandle *sh, LSMessage *message, int errorCode) {
     LSError lserror;
 
@@ -0,0 +1,143 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <CircuitBreaker.h>
+#include <loc_log.h>
+#include <algorithm>
+
+CircuitBreaker::CircuitBreaker(unsigned int failureThreshold, int64_t openMs, int64_t maxOpenMs)
+    : mFailureThreshold(failureThreshold),
+      mOpenUs(openMs * 1000),
+      mMaxOpenUs(maxOpenMs * 1000) {
+}
+
+bool CircuitBreaker::allowRequest(const std::string &endpoint, int64_t nowUs, bool *probe) {
+    auto it = mEndpoints.find(endpoint);
+
+    *probe = false;
+
+    if (it == mEndpoints.end())
+        return true;
+
+    Endpoint &entry = it->second;
+
+    if (entry.state == OPEN && nowUs >= entry.openUntil)
+        entry.state = HALF_OPEN;
+
+    switch (entry.state) {
+        case CLOSED:
+            return true;
+
+        case HALF_OPEN:
+            if (!entry.probeInFlight) {
+                entry.probeInFlight = true;
+                *probe = true;
+                return true;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    entry.rejected++;
+    return false;
+}
+
+bool CircuitBreaker::isOpen(const std::string &endpoint, int64_t nowUs) const {
+    auto it = mEndpoints.find(endpoint);
+
+    return it != mEndpoints.end() && it->second.state == OPEN && nowUs < it->second.openUntil;
+}
+
+void CircuitBreaker::recordResult(const std::string &endpoint, bool success, int64_t nowUs) {
+    auto it = mEndpoints.find(endpoint);
+
+    if (it == mEndpoints.end()) {
+        // only endpoints that failed at least once are tracked
+        if (success)
+            return;
+
+        Endpoint entry = {CLOSED, 0, false, 0, mOpenUs, 0, 0};
+        it = mEndpoints.insert(std::make_pair(endpoint, entry)).first;
+    }
+
+    Endpoint &entry = it->second;
+
+    switch (entry.state) {
+        case CLOSED:
+            if (success) {
+                entry.consecutiveFailures = 0;
+            } else if (++entry.consecutiveFailures >= mFailureThreshold) {
+                trip(entry, mOpenUs, nowUs);
+                LS_LOG_WARNING("circuit of %s opened after %u failures", endpoint.c_str(), entry.consecutiveFailures);
+            }
+            break;
+
+        case HALF_OPEN:
+            entry.probeInFlight = false;
+
+            if (success) {
+                entry.state = CLOSED;
+                entry.consecutiveFailures = 0;
+                entry.openPeriodUs = mOpenUs;
+                LS_LOG_INFO("circuit of %s closed", endpoint.c_str());
+            } else {
+                entry.consecutiveFailures++;
+                trip(entry, std::min(entry.openPeriodUs * 2, mMaxOpenUs), nowUs);
+                LS_LOG_WARNING("circuit of %s reopened for %lld ms", endpoint.c_str(),
+                               (long long) (entry.openPeriodUs / 1000));
+            }
+            break;
+
+        default:
+            // answers to requests sent before the circuit opened
+            break;
+    }
+}
+
+void CircuitBreaker::cancelProbe(const std::string &endpoint) {
+    auto it = mEndpoints.find(endpoint);
+
+    if (it != mEndpoints.end())
+        it->second.probeInFlight = false;
+}
+
+void CircuitBreaker::trip(Endpoint &endpoint, int64_t openPeriodUs, int64_t nowUs) {
+    endpoint.state = OPEN;
+    endpoint.openPeriodUs = openPeriodUs;
+    endpoint.openUntil = nowUs + openPeriodUs;
+    endpoint.trips++;
+}
+
+void CircuitBreaker::getStats(std::vector<CircuitBreakerStats> &stats, int64_t nowUs) const {
+    stats.clear();
+
+    for (const auto &it : mEndpoints) {
+        const Endpoint &entry = it.second;
+        CircuitBreakerStats endpointStats;
+        bool open = (entry.state == OPEN && nowUs < entry.openUntil);
+
+        endpointStats.endpoint = it.first;
+        endpointStats.state = (entry.state == CLOSED) ? "closed" : (open ? "open" : "half-open");
+        endpointStats.consecutiveFailures = entry.consecutiveFailures;
+        endpointStats.trips = entry.trips;
+        endpointStats.rejected = entry.rejected;
+        endpointStats.retryInMs = open ? (entry.openUntil - nowUs) / 1000 : 0;
+        stats.push_back(endpointStats);
+    }
+}
@@ -0,0 +1,367 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <string.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#include <resolv.h>
+#include <chrono>
+#include <loc_log.h>
+#include <DnsResolver.h>
+
+#define DNS_ANSWER_MAX_BYTES    1024
+
+DnsResolver::DnsResolver()
+    : mPool(NULL)
+    , mHasNameServer(false) {
+    memset(&mStats, 0, sizeof(mStats));
+    memset(&mNameServer, 0, sizeof(mNameServer));
+    mPool = g_thread_pool_new(lookupCb, this, DNS_MAX_PARALLEL_LOOKUPS, FALSE, NULL);
+
+    if (!mPool)
+        LS_LOG_ERROR("failed to create the dns lookup pool, lookups run inline");
+}
+
+DnsResolver::~DnsResolver() {
+    // queued lookups are dropped, running ones finish before the cache goes
+    if (mPool)
+        g_thread_pool_free(mPool, TRUE, TRUE);
+}
+
+std::string DnsResolver::hostOfUrl(const std::string &url) {
+    size_t start = url.find("://");
+    size_t end = std::string::npos;
+    size_t pos = std::string::npos;
+    std::string host;
+
+    start = (start == std::string::npos) ? 0 : start + 3;
+    end = url.find_first_of("/?#", start);
+    host = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+
+    if ((pos = host.rfind('@')) != std::string::npos)
+        host.erase(0, pos + 1);
+
+    // an IPv6 literal, nothing to resolve
+    if (!host.empty() && host[0] == '[')
+        return "";
+
+    if ((pos = host.find(':')) != std::string::npos)
+        host.erase(pos);
+
+    return host;
+}
+
+bool DnsResolver::isFresh(const Entry &entry, int64_t now) const {
+    return !entry.pending && now < entry.expiresAt;
+}
+
+// removes expired answers, then the one closest to expiry, never a pending lookup
+void DnsResolver::evict(int64_t now) {
+    auto victim = mCache.end();
+
+    if (mCache.size() < DNS_CACHE_MAX_ENTRIES)
+        return;
+
+    for (auto it = mCache.begin(); it != mCache.end();) {
+        if (!it->second.pending && now >= it->second.expiresAt)
+            it = mCache.erase(it);
+        else
+            ++it;
+    }
+
+    if (mCache.size() < DNS_CACHE_MAX_ENTRIES)
+        return;
+
+    for (auto it = mCache.begin(); it != mCache.end(); ++it) {
+        if (!it->second.pending && (victim == mCache.end() || it->second.expiresAt < victim->second.expiresAt))
+            victim = it;
+    }
+
+    if (victim != mCache.end())
+        mCache.erase(victim);
+}
+
+// called with mLock held
+void DnsResolver::startLookup(const std::string &host, Entry &entry) {
+    entry.pending = true;
+    mStats.lookups++;
+    g_thread_pool_push(mPool, g_strdup(host.c_str()), NULL);
+}
+
+void DnsResolver::lookupCb(gpointer data, gpointer user_data) {
+    DnsResolver *pThis = static_cast<DnsResolver *>(user_data);
+    char *host = (char *) data;
+
+    pThis->lookup(host);
+    g_free(host);
+}
+
+void DnsResolver::lookup(const std::string &host) {
+    std::vector<struct in_addr> addresses;
+    uint32_t ttl = 0;
+    bool missing = false;
+    struct sockaddr_in server;
+    bool hasServer = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        server = mNameServer;
+        hasServer = mHasNameServer;
+    }
+
+    bool found = query(host.c_str(), hasServer ? &server : NULL, addresses, &ttl, &missing);
+    int64_t now = g_get_monotonic_time();
+    std::lock_guard<std::mutex> lock(mLock);
+    Entry &entry = mCache[host];
+
+    if (found) {
+        ttl = MAX(MIN(ttl, DNS_MAX_TTL_S), DNS_MIN_TTL_S);
+    } else if (missing) {
+        ttl = DNS_NEGATIVE_TTL_S;
+    } else {
+        ttl = DNS_FAILURE_TTL_S;
+        mStats.failures++;
+    }
+
+    LS_LOG_DEBUG("%s resolved to %zu addresses, cached for %u s", host.c_str(), addresses.size(), ttl);
+
+    entry.addresses.swap(addresses);
+    entry.expiresAt = now + ttl * 1000000LL;
+    entry.pending = false;
+    entry.missing = !found && missing;
+    mResolved.notify_all();
+}
+
+// DNS answers first, they carry a TTL, then whatever else nsswitch knows of the name
+bool DnsResolver::query(const char *host, const struct sockaddr_in *server, std::vector<struct in_addr> &addresses,
+                        uint32_t *ttl, bool *missing) {
+    struct __res_state state;
+    unsigned char answer[DNS_ANSWER_MAX_BYTES];
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+    int len = -1;
+    int herror = 0;
+    int error = 0;
+
+    memset(&state, 0, sizeof(state));
+
+    if (res_ninit(&state) == 0) {
+        if (server) {
+            state.nsaddr_list[0] = *server;
+            state.nscount = 1;
+        }
+
+        len = res_nquery(&state, host, ns_c_in, ns_t_a, answer, sizeof(answer));
+        herror = state.res_h_errno;
+        res_nclose(&state);
+    }
+
+    if (len > 0) {
+        ns_msg msg;
+        ns_rr rr;
+
+        *ttl = DNS_MAX_TTL_S;
+
+        if (ns_initparse(answer, len, &msg) == 0) {
+            for (int i = 0; i < ns_msg_count(msg, ns_s_an); i++) {
+                if (ns_parserr(&msg, ns_s_an, i, &rr) < 0)
+                    break;
+
+                // a CNAME on the way bounds the answer as much as the address record
+                *ttl = MIN(*ttl, ns_rr_ttl(rr));
+
+                if (ns_rr_type(rr) == ns_t_a && ns_rr_rdlen(rr) == sizeof(struct in_addr)) {
+                    struct in_addr address;
+
+                    memcpy(&address, ns_rr_rdata(rr), sizeof(address));
+                    addresses.push_back(address);
+                }
+            }
+        }
+
+        if (!addresses.empty())
+            return true;
+    }
+
+    // an explicit server is the only authority, /etc/hosts would blur its answers
+    if (server) {
+        *missing = (herror == HOST_NOT_FOUND || herror == NO_DATA);
+        LS_LOG_INFO("failed to resolve %s: h_errno %d", host, herror);
+        return false;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    error = getaddrinfo(host, NULL, &hints, &result);
+
+    if (error == 0) {
+        for (struct addrinfo *ai = result; ai; ai = ai->ai_next)
+            addresses.push_back(((struct sockaddr_in *) ai->ai_addr)->sin_addr);
+
+        freeaddrinfo(result);
+        *ttl = DNS_HOSTS_TTL_S;
+
+        return !addresses.empty();
+    }
+
+    *missing = (error == EAI_NONAME || herror == HOST_NOT_FOUND || herror == NO_DATA);
+    LS_LOG_INFO("failed to resolve %s: %s", host, gai_strerror(error));
+
+    return false;
+}
+
+bool DnsResolver::resolve(const std::string &host, std::vector<struct in_addr> &addresses) {
+    struct in_addr literal;
+    bool resolved = false;
+
+    if (host.empty())
+        return false;
+
+    if (inet_pton(AF_INET, host.c_str(), &literal) == 1) {
+        addresses.push_back(literal);
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(mLock);
+    int64_t now = g_get_monotonic_time();
+
+    if (mCache.find(host) == mCache.end())
+        evict(now);
+
+    Entry &entry = mCache[host];
+
+    if (isFresh(entry, now)) {
+        if (entry.addresses.empty())
+            mStats.negativeHits++;
+        else
+            mStats.hits++;
+
+        addresses = entry.addresses;
+        return !addresses.empty();
+    }
+
+    if (entry.pending) {
+        mStats.shared++;
+    } else if (mPool) {
+        mStats.misses++;
+        startLookup(host, entry);
+    } else {
+        mStats.misses++;
+        entry.pending = true;
+        mStats.lookups++;
+        lock.unlock();
+        lookup(host);
+        lock.lock();
+    }
+
+    // the entry may be evicted meanwhile, it is looked up again each time
+    resolved = mResolved.wait_for(lock, std::chrono::milliseconds(DNS_LOOKUP_TIMEOUT_MS), [this, &host]() {
+        auto it = mCache.find(host);
+        return it == mCache.end() || !it->second.pending;
+    });
+
+    auto it = mCache.find(host);
+
+    if (!resolved || it == mCache.end()) {
+        LS_LOG_INFO("lookup of %s did not complete in time", host.c_str());
+        return false;
+    }
+
+    addresses = it->second.addresses;
+    return !addresses.empty();
+}
+
+void DnsResolver::prefetch(const std::vector<std::string> &hosts) {
+    std::lock_guard<std::mutex> lock(mLock);
+    int64_t now = g_get_monotonic_time();
+    struct in_addr literal;
+
+    if (!mPool)
+        return;
+
+    for (const std::string &host : hosts) {
+        if (host.empty() || inet_pton(AF_INET, host.c_str(), &literal) == 1)
+            continue;
+
+        if (mCache.find(host) == mCache.end())
+            evict(now);
+
+        Entry &entry = mCache[host];
+
+        if (!isFresh(entry, now) && !entry.pending)
+            startLookup(host, entry);
+    }
+}
+
+bool DnsResolver::isUnresolvable(const std::string &host) {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mCache.find(host);
+
+    if (it == mCache.end() || !isFresh(it->second, g_get_monotonic_time()) || !it->second.missing)
+        return false;
+
+    mStats.negativeHits++;
+    return true;
+}
+
+bool DnsResolver::appendStats(jvalue_ref parent) {
+    jvalue_ref object = jobject_create();
+    DnsResolverStats stats;
+
+    if (jis_null(object))
+        return false;
+
+    getStats(&stats);
+
+    jobject_put(object, J_CSTR_TO_JVAL("lookups"), jnumber_create_i64(stats.lookups));
+    jobject_put(object, J_CSTR_TO_JVAL("hits"), jnumber_create_i64(stats.hits));
+    jobject_put(object, J_CSTR_TO_JVAL("negativeHits"), jnumber_create_i64(stats.negativeHits));
+    jobject_put(object, J_CSTR_TO_JVAL("misses"), jnumber_create_i64(stats.misses));
+    jobject_put(object, J_CSTR_TO_JVAL("shared"), jnumber_create_i64(stats.shared));
+    jobject_put(object, J_CSTR_TO_JVAL("failures"), jnumber_create_i64(stats.failures));
+    jobject_put(object, J_CSTR_TO_JVAL("entries"), jnumber_create_i64(stats.entries));
+    jobject_put(parent, J_CSTR_TO_JVAL("dns"), object);
+
+    return true;
+}
+
+void DnsResolver::setNameServer(const struct sockaddr_in *server) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mHasNameServer = (server != NULL);
+
+    if (server)
+        mNameServer = *server;
+
+    // answers of the previous server are not answers of this one; pending
+    // lookups stay, their waiters need the entry
+    for (auto it = mCache.begin(); it != mCache.end();) {
+        if (!it->second.pending)
+            it = mCache.erase(it);
+        else
+            ++it;
+    }
+}
+
+void DnsResolver::getStats(DnsResolverStats *stats) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    *stats = mStats;
+    stats->entries = mCache.size();
+}
@@ -15,7 +15,9 @@
 // SPDX-License-Identifier: Apache-2.0
 
 
+#include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "db_util.h"
 
@@ -23,6 +25,320 @@
 
 #define MAX_LEN 50
 
+#define STORE_BUDGET_WINDOW_SEC         3600
+#define DEFAULT_STORE_DURABILITY_MODE   STORE_DURABILITY_PERIODIC
+#define DEFAULT_STORE_MAX_WRITES_HOUR   120
+#define DEFAULT_STORE_MAX_BYTES_HOUR    (64 * 1024)
+#define DEFAULT_STORE_FLUSH_INTERVAL    60
+
+/*
+ * Latest fix of a store which is not yet written to flash
+ */
+typedef struct _StorePending {
+  Position position;
+  Accuracy accuracy;
+  gboolean dirty;
+  gint64 lastFlush;
+  int lastWriteSize;
+} StorePending;
+
+static GMutex store_lock;
+static GHashTable *store_pending = NULL;
+static guint store_flush_timer = 0;
+static gint64 store_window_start = 0;
+static StoreWritePolicy store_policy = {
+  DEFAULT_STORE_DURABILITY_MODE,
+  DEFAULT_STORE_MAX_WRITES_HOUR,
+  DEFAULT_STORE_MAX_BYTES_HOUR,
+  DEFAULT_STORE_FLUSH_INTERVAL
+};
+static StoreWriteStats store_stats;
+
+static gboolean store_flush_timer_cb(gpointer data);
+
+static int store_format_value(char *input, const char *format, ...) G_GNUC_PRINTF(2, 3);
+
+static int store_format_value(char *input, const char *format, ...) {
+  va_list args;
+  int len;
+
+  va_start(args, format);
+  len = g_vsnprintf(input, MAX_LEN, format, args);
+  va_end(args);
+
+  return len;
+}
+
+static int store_write_file(const char *path, const Position *position, const Accuracy *accuracy,
+                            int syncToDisk, int *bytesWritten) {
+  DBHandle handle;
+  char input[MAX_LEN];
+
+  if (createPreference(path, &handle, "Location\n", FALSE) != SUCCESS)
+    return INIT_ERROR;
+
+  store_format_value(input, "%lld", (long long) position->timestamp);
+  put(&handle, "timestamp", input);
+  store_format_value(input, "%.7f", position->latitude);
+  put(&handle, "latitude", input);
+  store_format_value(input, "%.7f", position->longitude);
+  put(&handle, "longitude", input);
+  store_format_value(input, "%.7f", position->altitude);
+  put(&handle, "altitude", input);
+  store_format_value(input, "%lf", position->speed);
+  put(&handle, "speed", input);
+  store_format_value(input, "%.7f", position->direction);
+  put(&handle, "direction", input);
+  store_format_value(input, "%lf", accuracy->horizAccuracy);
+  put(&handle, "hor_accuracy", input);
+  store_format_value(input, "%lf", accuracy->vertAccuracy);
+  put(&handle, "ver_accuracy", input);
+
+  return commitSync(&handle, syncToDisk, bytesWritten);
+}
+
+static guint64 store_payload_size(const Position *position, const Accuracy *accuracy) {
+  char input[MAX_LEN];
+  guint64 size = 0;
+
+  size += store_format_value(input, "%lld", (long long) position->timestamp);
+  size += store_format_value(input, "%.7f", position->latitude);
+  size += store_format_value(input, "%.7f", position->longitude);
+  size += store_format_value(input, "%.7f", position->altitude);
+  size += store_format_value(input, "%lf", position->speed);
+  size += store_format_value(input, "%.7f", position->direction);
+  size += store_format_value(input, "%lf", accuracy->horizAccuracy);
+  size += store_format_value(input, "%lf", accuracy->vertAccuracy);
+
+  return size;
+}
+
+static gboolean store_budget_allows(guint64 bytes, gint64 now) {
+  if (now - store_window_start >= (gint64) STORE_BUDGET_WINDOW_SEC * G_USEC_PER_SEC) {
+    store_window_start = now;
+    store_stats.windowWrites = 0;
+    store_stats.windowBytes = 0;
+  }
+
+  if (store_policy.maxWritesPerHour && store_stats.windowWrites + 1 > store_policy.maxWritesPerHour)
+    return FALSE;
+
+  if (store_policy.maxBytesPerHour &&
+      store_stats.windowBytes + bytes > store_policy.maxBytesPerHour)
+    return FALSE;
+
+  return TRUE;
+}
+
+/* Called with store_lock held */
+static gboolean store_flush_entry(const char *path, StorePending *entry, gboolean force) {
+  gint64 now = g_get_monotonic_time();
+  int written = 0;
+
+  if (!entry->dirty)
+    return TRUE;
+
+  if (!store_budget_allows(entry->lastWriteSize, now)) {
+    if (!force) {
+      store_stats.deferredWrites++;
+      return FALSE;
+    }
+
+    store_stats.overBudgetWrites++;
+  }
+
+  if (store_write_file(path, &entry->position, &entry->accuracy, TRUE, &written) != SUCCESS) {
+    store_stats.failedWrites++;
+    return FALSE;
+  }
+
+  entry->dirty = FALSE;
+  entry->lastFlush = now;
+  entry->lastWriteSize = written;
+
+  store_stats.diskWrites++;
+  store_stats.fsyncCount++;
+  store_stats.physicalBytes += written;
+  store_stats.windowWrites++;
+  store_stats.windowBytes += written;
+
+  return TRUE;
+}
+
+/* Called with store_lock held, returns TRUE if a store is still dirty */
+static gboolean store_flush_all(gboolean force) {
+  GHashTableIter iter;
+  gpointer key, value;
+  gboolean pending = FALSE;
+
+  if (!store_pending)
+    return FALSE;
+
+  g_hash_table_iter_init(&iter, store_pending);
+
+  while (g_hash_table_iter_next(&iter, &key, &value)) {
+    if (!store_flush_entry((const char *) key, (StorePending *) value, force))
+      pending = TRUE;
+  }
+
+  return pending;
+}
+
+/* Called with store_lock held */
+static void store_schedule_flush(void) {
+  if (store_flush_timer || store_policy.mode == STORE_DURABILITY_ON_SUSPEND)
+    return;
+
+  store_flush_timer = g_timeout_add_seconds(store_policy.flushIntervalSec ? store_policy.flushIntervalSec : 1,
+                                            store_flush_timer_cb, NULL);
+}
+
+static gboolean store_flush_timer_cb(gpointer data) {
+  gboolean pending;
+
+  g_mutex_lock(&store_lock);
+  pending = store_flush_all(FALSE);
+
+  if (!pending || store_policy.mode == STORE_DURABILITY_ON_SUSPEND)
+    store_flush_timer = 0;
+
+  g_mutex_unlock(&store_lock);
+
+  return store_flush_timer ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+/**
+ * <Funciton >   set_store_write_policy
+ * <Description>   set the durability mode and the hourly write budget of the position stores
+ * @param     <policy> <In> <write policy, a zero cap means unlimited>
+ * @return     Void
+ */
+void set_store_write_policy(const StoreWritePolicy *policy) {
+  if (policy == NULL)
+    return;
+
+  g_mutex_lock(&store_lock);
+  store_policy = *policy;
+
+  if (store_flush_timer) {
+    g_source_remove(store_flush_timer);
+    store_flush_timer = 0;
+  }
+
+  if (store_flush_all(FALSE))
+    store_schedule_flush();
+
+  g_mutex_unlock(&store_lock);
+}
+
+/**
+ * <Funciton >   store_write_allowed
+ * <Description>   check a write of another store, like the network caches, against the
+ *                 hourly budget shared with the position stores
+ * @param     <bytes> <In> <expected size of the write>
+ * @return     gboolean, TRUE if the write fits the budget
+ */
+gboolean store_write_allowed(guint64 bytes) {
+  gboolean allowed;
+
+  g_mutex_lock(&store_lock);
+  allowed = store_budget_allows(bytes, g_get_monotonic_time());
+
+  if (!allowed)
+    store_stats.deferredWrites++;
+
+  g_mutex_unlock(&store_lock);
+
+  return allowed;
+}
+
+/**
+ * <Funciton >   store_write_done
+ * <Description>   charge a synced write of another store to the budget and the counters
+ * @param     <bytes> <In> <bytes written>
+ * @return     Void
+ */
+void store_write_done(guint64 bytes) {
+  if (bytes == 0)
+    return;
+
+  g_mutex_lock(&store_lock);
+  store_stats.requestedWrites++;
+  store_stats.logicalBytes += bytes;
+  store_stats.diskWrites++;
+  store_stats.fsyncCount++;
+  store_stats.physicalBytes += bytes;
+  store_stats.windowWrites++;
+  store_stats.windowBytes += bytes;
+  g_mutex_unlock(&store_lock);
+}
+
+/**
+ * <Funciton >   get_store_write_stats
+ * <Description>   copy the write counters of the position stores
+ * @param     <stats> <Out> <write counters>
+ * @return     Void
+ */
+void get_store_write_stats(StoreWriteStats *stats) {
+  if (stats == NULL)
+    return;
+
+  g_mutex_lock(&store_lock);
+  *stats = store_stats;
+  g_mutex_unlock(&store_lock);
+}
+
+/**
+ * <Funciton >   append_store_write_stats
+ * <Description>   add the write counters as the "storage" section of getServiceMetrics
+ * @param     <parent> <In> <reply object>
+ * @return     gboolean, FALSE when out of memory
+ */
+gboolean append_store_write_stats(jvalue_ref parent) {
+  jvalue_ref object = jobject_create();
+  StoreWriteStats stats;
+
+  if (jis_null(object))
+    return FALSE;
+
+  get_store_write_stats(&stats);
+
+  jobject_put(object, J_CSTR_TO_JVAL("requestedWrites"), jnumber_create_i64(stats.requestedWrites));
+  jobject_put(object, J_CSTR_TO_JVAL("coalescedWrites"), jnumber_create_i64(stats.coalescedWrites));
+  jobject_put(object, J_CSTR_TO_JVAL("deferredWrites"), jnumber_create_i64(stats.deferredWrites));
+  jobject_put(object, J_CSTR_TO_JVAL("overBudgetWrites"), jnumber_create_i64(stats.overBudgetWrites));
+  jobject_put(object, J_CSTR_TO_JVAL("failedWrites"), jnumber_create_i64(stats.failedWrites));
+  jobject_put(object, J_CSTR_TO_JVAL("diskWrites"), jnumber_create_i64(stats.diskWrites));
+  jobject_put(object, J_CSTR_TO_JVAL("fsyncCount"), jnumber_create_i64(stats.fsyncCount));
+  jobject_put(object, J_CSTR_TO_JVAL("logicalBytes"), jnumber_create_i64(stats.logicalBytes));
+  jobject_put(object, J_CSTR_TO_JVAL("physicalBytes"), jnumber_create_i64(stats.physicalBytes));
+  jobject_put(object, J_CSTR_TO_JVAL("writeAmplification"),
+              jnumber_create_f64(stats.logicalBytes ? (double) stats.physicalBytes / stats.logicalBytes : 0));
+  jobject_put(object, J_CSTR_TO_JVAL("writesThisHour"), jnumber_create_i64(stats.windowWrites));
+  jobject_put(object, J_CSTR_TO_JVAL("bytesThisHour"), jnumber_create_i64(stats.windowBytes));
+  jobject_put(parent, J_CSTR_TO_JVAL("storage"), object);
+
+  return TRUE;
+}
+
+/**
+ * <Funciton >   flush_stored_positions
+ * <Description>   write every pending fix to flash regardless of the write budget,
+ *                 called before suspend and at shutdown
+ * @return     Void
+ */
+void flush_stored_positions(void) {
+  g_mutex_lock(&store_lock);
+  store_flush_all(TRUE);
+
+  if (store_flush_timer) {
+    g_source_remove(store_flush_timer);
+    store_flush_timer = 0;
+  }
+
+  g_mutex_unlock(&store_lock);
+}
+
 /**
  * <Funciton >   gps_service_get_stored_position
  * <Description>   will be called for getting the stored position
@@ -36,33 +352,82 @@ void set_store_position(int64_t timestamp, gdouble latitude,
                         gdouble longitude, gdouble altitude, gdouble speed,
                         gdouble direction, gdouble hor_accuracy,
                         gdouble ver_accuracy, const char *path) {
-  DBHandle *handle = NULL;
-  char input[MAX_LEN];
-  handle = (DBHandle *) malloc(sizeof(DBHandle));
+  StorePending *entry = NULL;
+  gint64 now;
 
-  if (handle != NULL) {
-
-    createPreference(path, handle, "Location\n", FALSE);
-
-        sprintf(input, "%lld", timestamp);
-    put(handle, "timestamp", input);
-    sprintf(input, "%.7f", latitude);
-    put(handle, "latitude", input);
-    sprintf(input, "%.7f", longitude);
-    put(handle, "longitude", input);
-    sprintf(input, "%.7f", altitude);
-    put(handle, "altitude", input);
-    sprintf(input, "%lf", speed);
-    put(handle, "speed", input);
-    sprintf(input, "%.7f", direction);
-    put(handle, "direction", input);
-    sprintf(input, "%lf", hor_accuracy);
-    put(handle, "hor_accuracy", input);
-    sprintf(input, "%lf", ver_accuracy);
-    put(handle, "ver_accuracy", input);
-    commit(handle);
-    free(handle);
+  if (path == NULL)
+    return;
+
+  g_mutex_lock(&store_lock);
+
+  if (store_pending == NULL)
+    store_pending = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+  entry = (StorePending *) g_hash_table_lookup(store_pending, path);
+
+  if (entry == NULL) {
+    entry = g_new0(StorePending, 1);
+    g_hash_table_insert(store_pending, g_strdup(path), entry);
   }
+
+  if (entry->dirty)
+    store_stats.coalescedWrites++;
+
+  memset(&entry->position, 0, sizeof(Position));
+  entry->position.timestamp = timestamp;
+  entry->position.latitude = latitude;
+  entry->position.longitude = longitude;
+  entry->position.altitude = altitude;
+  entry->position.speed = speed;
+  entry->position.direction = direction;
+  entry->accuracy.horizAccuracy = hor_accuracy;
+  entry->accuracy.vertAccuracy = ver_accuracy;
+  entry->dirty = TRUE;
+
+  store_stats.requestedWrites++;
+  store_stats.logicalBytes += store_payload_size(&entry->position, &entry->accuracy);
+
+  now = g_get_monotonic_time();
+
+  switch (store_policy.mode) {
+    case STORE_DURABILITY_FSYNC_ALWAYS:
+      if (!store_flush_entry(path, entry, FALSE))
+        store_schedule_flush();
+      break;
+    case STORE_DURABILITY_PERIODIC:
+      if (entry->lastFlush == 0 ||
+          now - entry->lastFlush >= (gint64) store_policy.flushIntervalSec * G_USEC_PER_SEC) {
+        if (store_flush_entry(path, entry, FALSE))
+          break;
+      }
+      store_schedule_flush();
+      break;
+    case STORE_DURABILITY_ON_SUSPEND:
+    default:
+      break;
+  }
+
+  g_mutex_unlock(&store_lock);
+}
+
+static gboolean get_pending_position(Position *position, Accuracy *accuracy, const char *path) {
+  StorePending *entry = NULL;
+  gboolean found = FALSE;
+
+  g_mutex_lock(&store_lock);
+
+  if (store_pending)
+    entry = (StorePending *) g_hash_table_lookup(store_pending, path);
+
+  if (entry && entry->dirty) {
+    *position = entry->position;
+    *accuracy = entry->accuracy;
+    found = TRUE;
+  }
+
+  g_mutex_unlock(&store_lock);
+
+  return found;
 }
 
 int get_stored_position(Position *position, Accuracy *accuracy,const char *path) {
@@ -83,6 +448,10 @@ int get_stored_position(Position *position, Accuracy *accuracy,const char *path)
     error = ERROR_NOT_AVAILABLE;
     goto EXIT;
   } else {
+    // a fix held back by the write budget is newer than the file
+    if (get_pending_position(position, accuracy, path))
+      goto EXIT;
+
     if (isFileExists(path) == 0) {
       error = ERROR_NOT_AVAILABLE;
       goto EXIT;
@@ -0,0 +1,162 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <HttpConnectionPool.h>
+#include <loc_log.h>
+
+#define HTTP_POOL_SWEEP_INTERVAL_SEC    10
+
+HttpConnectionPool::HttpConnectionPool(size_t maxIdlePerHost, int64_t idleTimeoutMs)
+    : mMaxIdlePerHost(maxIdlePerHost),
+      mIdleTimeoutUs(idleTimeoutMs * 1000),
+      mSweepTimerId(0),
+      mRequests(0),
+      mReused(0),
+      mNewTasks(0),
+      mUnhealthy(0),
+      mExpired(0),
+      mOverflow(0) {
+}
+
+HttpConnectionPool::~HttpConnectionPool() {
+    clear();
+}
+
+std::string HttpConnectionPool::hostKey(const std::string &url) {
+    size_t start = url.find("://");
+
+    start = (start == std::string::npos) ? 0 : start + 3;
+
+    return url.substr(0, url.find_first_of("/?#", start));
+}
+
+HttpReqTask *HttpConnectionPool::acquire(const std::string &host) {
+    HttpReqTask *task = NULL;
+    auto it = mIdle.find(host);
+
+    mRequests++;
+
+    if (it == mIdle.end())
+        return NULL;
+
+    task = it->second.back().task;
+    it->second.pop_back();
+
+    if (it->second.empty())
+        mIdle.erase(it);
+
+    mReused++;
+
+    return task;
+}
+
+void HttpConnectionPool::recordNewTask() {
+    mNewTasks++;
+}
+
+void HttpConnectionPool::release(const std::string &host, HttpReqTask *task, bool healthy) {
+    std::vector<IdleTask> &idle = mIdle[host];
+
+    if (!healthy || idle.size() >= mMaxIdlePerHost) {
+        if (healthy)
+            mOverflow++;
+        else
+            mUnhealthy++;
+
+        if (idle.empty())
+            mIdle.erase(host);
+
+        loc_http_task_destroy(&task);
+        return;
+    }
+
+    if (task->responseData) {
+        g_free(task->responseData);
+        task->responseData = NULL;
+        task->responseSize = 0;
+    }
+
+    IdleTask entry = {task, g_get_monotonic_time()};
+    idle.push_back(entry);
+
+    if (!mSweepTimerId)
+        mSweepTimerId = g_timeout_add_seconds(HTTP_POOL_SWEEP_INTERVAL_SEC, &sweepCallback, this);
+}
+
+void HttpConnectionPool::expire(int64_t nowUs) {
+    for (auto it = mIdle.begin(); it != mIdle.end();) {
+        std::vector<IdleTask> &idle = it->second;
+        size_t kept = 0;
+
+        // oldest first, as tasks are released in time order
+        for (size_t i = 0; i < idle.size(); i++) {
+            if (nowUs - idle[i].idleSince >= mIdleTimeoutUs) {
+                loc_http_task_destroy(&idle[i].task);
+                mExpired++;
+            } else {
+                idle[kept++] = idle[i];
+            }
+        }
+
+        idle.resize(kept);
+
+        if (idle.empty())
+            it = mIdle.erase(it);
+        else
+            ++it;
+    }
+}
+
+gboolean HttpConnectionPool::sweepCallback(gpointer data) {
+    HttpConnectionPool *pThis = static_cast<HttpConnectionPool *>(data);
+
+    pThis->expire(g_get_monotonic_time());
+
+    if (!pThis->mIdle.empty())
+        return G_SOURCE_CONTINUE;
+
+    pThis->mSweepTimerId = 0;
+    return G_SOURCE_REMOVE;
+}
+
+void HttpConnectionPool::clear() {
+    if (mSweepTimerId) {
+        g_source_remove(mSweepTimerId);
+        mSweepTimerId = 0;
+    }
+
+    for (auto &host : mIdle) {
+        for (IdleTask &idle : host.second)
+            loc_http_task_destroy(&idle.task);
+    }
+
+    mIdle.clear();
+}
+
+void HttpConnectionPool::getStats(HttpConnectionPoolStats *stats) const {
+    stats->requests = mRequests;
+    stats->reused = mReused;
+    stats->newTasks = mNewTasks;
+    stats->unhealthy = mUnhealthy;
+    stats->expired = mExpired;
+    stats->overflow = mOverflow;
+    stats->idleConnections = 0;
+    stats->hosts = mIdle.size();
+
+    for (const auto &host : mIdle)
+        stats->idleConnections += host.second.size();
+}
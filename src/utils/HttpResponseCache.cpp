@@ -0,0 +1,182 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+#include <loc_log.h>
+#include <HttpResponseCache.h>
+
+#define HTTP_CACHE_MAGIC    "LHC1"
+
+HttpResponseCache::HttpResponseCache(const char *path, size_t maxBytes)
+    : mPath(path ? path : ""),
+      mMaxBytes(maxBytes),
+      mBytes(0),
+      mDirty(false) {
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+std::string HttpResponseCache::makeKey(const std::string &url) {
+    gchar *digest = g_compute_checksum_for_string(G_CHECKSUM_SHA1, url.c_str(), url.size());
+    std::string key(digest);
+
+    g_free(digest);
+    return key;
+}
+
+bool HttpResponseCache::lookup(const std::string &url, int64_t nowMs, bool allowStale, std::string &body) {
+    auto it = mEntries.find(makeKey(url));
+
+    if (it == mEntries.end()) {
+        mStats.misses++;
+        return false;
+    }
+
+    Entry &entry = it->second;
+
+    if (nowMs >= entry.expiresAt) {
+        if (!allowStale || nowMs - entry.expiresAt > HTTP_CACHE_MAX_STALE_MS) {
+            mStats.misses++;
+            return false;
+        }
+
+        mStats.staleHits++;
+    } else {
+        mStats.hits++;
+    }
+
+    mLru.splice(mLru.begin(), mLru, entry.lru);
+    body = entry.body;
+
+    return true;
+}
+
+void HttpResponseCache::store(const std::string &url, const char *body, int64_t ttlMs, int64_t nowMs) {
+    size_t length = body ? strlen(body) : 0;
+
+    if (!length || length > HTTP_CACHE_MAX_ENTRY_BYTES || ttlMs <= 0)
+        return;
+
+    insert(makeKey(url), std::string(body, length), nowMs, nowMs + ttlMs);
+    mStats.stores++;
+    mDirty = true;
+}
+
+void HttpResponseCache::insert(const std::string &key, const std::string &body, int64_t storedAt,
+                               int64_t expiresAt) {
+    auto it = mEntries.find(key);
+
+    if (it != mEntries.end())
+        erase(it);
+
+    while (!mLru.empty() && mBytes + body.size() > mMaxBytes) {
+        erase(mEntries.find(mLru.back()));
+        mStats.evictions++;
+    }
+
+    mLru.push_front(key);
+
+    Entry entry = {body, storedAt, expiresAt, mLru.begin()};
+    mEntries[key] = entry;
+    mBytes += body.size();
+}
+
+void HttpResponseCache::erase(std::unordered_map<std::string, Entry>::iterator it) {
+    mBytes -= it->second.body.size();
+    mLru.erase(it->second.lru);
+    mEntries.erase(it);
+}
+
+void HttpResponseCache::getStats(HttpResponseCacheStats *stats) const {
+    *stats = mStats;
+    stats->bytes = mBytes;
+    stats->entries = mEntries.size();
+}
+
+/*
+ * File format, least recently used entry first so that loading restores the order:
+ * <key> <storedAt> <expiresAt> <length>\n<body>\n
+ */
+bool HttpResponseCache::load() {
+    FILE *fp = NULL;
+    char magic[8] = {0};
+    char key[48] = {0};
+    long long storedAt, expiresAt;
+    size_t length;
+    int64_t now = g_get_real_time() / 1000;
+
+    if (mPath.empty() || (fp = fopen(mPath.c_str(), "r")) == NULL)
+        return false;
+
+    if (fscanf(fp, "%7s", magic) != 1 || strcmp(magic, HTTP_CACHE_MAGIC) != 0) {
+        LS_LOG_ERROR("invalid http cache file %s", mPath.c_str());
+        fclose(fp);
+        return false;
+    }
+
+    while (fscanf(fp, "%47s %lld %lld %zu", key, &storedAt, &expiresAt, &length) == 4 &&
+           length <= HTTP_CACHE_MAX_ENTRY_BYTES && fgetc(fp) == '\n') {
+        std::string body(length, '\0');
+
+        if (fread(&body[0], 1, length, fp) != length)
+            break;
+
+        if (now - expiresAt <= HTTP_CACHE_MAX_STALE_MS)
+            insert(key, body, storedAt, expiresAt);
+    }
+
+    fclose(fp);
+    mDirty = false;
+
+    LS_LOG_INFO("loaded %zu http responses from %s", mEntries.size(), mPath.c_str());
+
+    return true;
+}
+
+bool HttpResponseCache::save() {
+    FILE *fp = NULL;
+    std::string tmpPath = mPath + ".tmp";
+
+    if (!mDirty || mPath.empty())
+        return true;
+
+    if ((fp = fopen(tmpPath.c_str(), "w")) == NULL) {
+        LS_LOG_ERROR("failed to open %s", tmpPath.c_str());
+        return false;
+    }
+
+    fprintf(fp, "%s\n", HTTP_CACHE_MAGIC);
+
+    for (auto it = mLru.rbegin(); it != mLru.rend(); ++it) {
+        const Entry &entry = mEntries[*it];
+
+        fprintf(fp, "%s %lld %lld %zu\n", it->c_str(), (long long) entry.storedAt, (long long) entry.expiresAt,
+                entry.body.size());
+        fwrite(entry.body.data(), 1, entry.body.size(), fp);
+        fputc('\n', fp);
+    }
+
+    if (fclose(fp) != 0 || rename(tmpPath.c_str(), mPath.c_str()) != 0) {
+        LS_LOG_ERROR("failed to write %s", mPath.c_str());
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    mDirty = false;
+    return true;
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+#include <string.h>
+#include <glib.h>
+#include <loc_log.h>
+#include <Gps_stored_data.h>
+#include <LastPositionIndex.h>
+
+LastPositionIndex::LastPositionIndex() {
+    memset(mValid, 0x00, sizeof(mValid));
+    memset(mEntries, 0x00, sizeof(mEntries));
+}
+
+void LastPositionIndex::warmUp() {
+    Position position;
+    Accuracy accuracy;
+
+    memset(&position, 0x00, sizeof(Position));
+    memset(&accuracy, 0x00, sizeof(Accuracy));
+
+    if (get_stored_position(&position, &accuracy, LOCATION_DB_PREF_PATH_GPS) == ERROR_NONE)
+        update(LAST_POSITION_GPS, HANDLER_GPS, position, accuracy);
+
+    memset(&position, 0x00, sizeof(Position));
+    memset(&accuracy, 0x00, sizeof(Accuracy));
+
+    if (get_stored_position(&position, &accuracy, LOCATION_DB_PREF_PATH_NETWORK) == ERROR_NONE)
+        update(LAST_POSITION_NETWORK, HANDLER_NETWORK, position, accuracy);
+}
+
+void LastPositionIndex::update(LastPositionSource source, HandlerTypes handler, const Position &position,
+                               const Accuracy &accuracy) {
+    if (source >= LAST_POSITION_MAX)
+        return;
+
+    if (position.latitude == 0 || position.longitude == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mValid[source] && mEntries[source].position.timestamp > position.timestamp)
+        return;
+
+    mEntries[source].source = source;
+    mEntries[source].handler = handler;
+    mEntries[source].position = position;
+    mEntries[source].accuracy = accuracy;
+    mValid[source] = true;
+}
+
+int LastPositionIndex::getCandidates(HandlerTypes handler, long long maximumAge, double maximumAccuracy,
+                                     std::vector<LastPositionCandidate> &candidates) {
+    long long currentTime = g_get_real_time() / 1000;
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    for (int i = 0; i < LAST_POSITION_MAX; i++) {
+        const LastPositionCandidate &entry = mEntries[i];
+
+        if (!mValid[i])
+            continue;
+
+        if (handler != HANDLER_HYBRID && entry.handler != handler)
+            continue;
+
+        if (maximumAge > 0 && maximumAge < (currentTime - entry.position.timestamp))
+            continue;
+
+        if (maximumAccuracy > 0 && entry.accuracy.horizAccuracy > maximumAccuracy)
+            continue;
+
+        candidates.push_back(entry);
+    }
+
+    return candidates.size();
+}
+
+const char *LastPositionIndex::getSourceName(LastPositionSource source) {
+    switch (source) {
+        case LAST_POSITION_GPS:
+            return "gps";
+        case LAST_POSITION_NETWORK:
+            return "network";
+        case LAST_POSITION_MOCK:
+            return "mock";
+        default:
+            return "unknown";
+    }
+}
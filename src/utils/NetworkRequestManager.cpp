@@ -16,11 +16,57 @@
 
 
 #include <NetworkRequestManager.h>
+#include <DnsResolver.h>
 #include <loc_log.h>
+#include <Location.h>
+#include <algorithm>
+#include <curl/curl.h>
+
+#define HTTP_RETRY_BASE_DELAY_MS    1000
+#define HTTP_RETRY_MAX_DELAY_MS     16000
+#define HTTP_QUEUED_MAX_PER_CLASS   16
+#define HTTP_QUEUED_MAX_AGE_MS      60000
+#define HTTP_REPLAY_INTERVAL_MS     200
+#define HTTP_REPLAY_BURST           2
+#define HTTP_MAX_ACTIVE             6       // transfers handed to loc_http at once
+#define HTTP_WFQ_SCALE              8
 
 using namespace std;
 
-NetworkRequestManager::NetworkRequestManager() {
+typedef struct _HttpPriorityClass {
+    const char *name;
+    unsigned int limit;
+    unsigned int weight;    // share of the dispatches while several classes wait
+} HttpPriorityClass;
+
+static const HttpPriorityClass priorityClasses[HTTP_PRIORITY_MAX] = {
+        {"foregroundPosition", 4, 8},
+        {"backgroundPosition", 2, 4},
+        {"geocoding",          2, 2},
+        {"prefetch",           1, 1},
+};
+
+NetworkRequestManager::NetworkRequestManager()
+    : mConnectionPool(HTTP_POOL_MAX_IDLE_PER_HOST, HTTP_POOL_IDLE_TIMEOUT_MS),
+      mCircuitBreaker(CIRCUIT_FAILURE_THRESHOLD, CIRCUIT_OPEN_MS, CIRCUIT_MAX_OPEN_MS),
+      mOnline(true),
+      mReplaying(false),
+      mDispatchId(0),
+      mActiveTotal(0),
+      mVirtualTime(0),
+      mResponseCache(LOCATION_HTTP_CACHE_PATH, HTTP_CACHE_MAX_BYTES),
+      mCoalescedRequests(0),
+      mRetries(0) {
+    memset(&mDeferredStats, 0, sizeof(mDeferredStats));
+    memset(mActive, 0, sizeof(mActive));
+    memset(mFinishTag, 0, sizeof(mFinishTag));
+    memset(mPriorityStats, 0, sizeof(mPriorityStats));
+
+    for (int i = 0; i < HTTP_PRIORITY_MAX; i++) {
+        mPriorityStats[i].name = priorityClasses[i].name;
+        mPriorityStats[i].limit = priorityClasses[i].limit;
+    }
+
     LS_LOG_DEBUG("NetworkRequestManager ctor");
 }
 
@@ -33,6 +79,7 @@ void NetworkRequestManager::init() {
     loc_http_set_callback(handleDataCb, this);
 
     _attributes.set(Network_Defines::ACTIVE);
+    mResponseCache.load();
 
     LS_LOG_DEBUG("NetworkRequestManager started");
 }
@@ -45,6 +92,49 @@ void NetworkRequestManager::deInit() {
 
     _attributes.reset(Network_Defines::ACTIVE); // clear the active bit
 
+    if (mDispatchId) {
+        g_source_remove(mDispatchId);
+        mDispatchId = 0;
+    }
+
+    // no timer or idle source may reach a client once loc_http and the clients are gone
+    for (auto &entry : httpRequestList) {
+        HttpReqTask *task = entry.first;
+        HttpTransaction &transaction = entry.second;
+
+        if (transaction.timerId)
+            g_source_remove(transaction.timerId);
+
+        if (transaction.retryTimerId)
+            g_source_remove(transaction.retryTimerId);
+
+        if (transaction.deliverId)
+            g_source_remove(transaction.deliverId);
+
+        if (transaction.probe)
+            mCircuitBreaker.cancelProbe(transaction.host);
+
+        if (!transaction.removed)
+            loc_http_remove_request(task);
+
+        loc_http_task_destroy(&task);
+    }
+
+    LS_LOG_INFO("%zu transactions dropped", httpRequestList.size());
+
+    httpRequestList.clear();
+    inflightRequests.clear();
+
+    for (int i = 0; i < HTTP_PRIORITY_MAX; i++) {
+        mQueued[i].clear();
+        mActive[i] = 0;
+    }
+
+    mActiveTotal = 0;
+    mReplaying = false;
+
+    mConnectionPool.clear();
+    mResponseCache.save();
     loc_http_stop();
 
     LS_LOG_DEBUG("NetworkRequestManager stopped");
@@ -59,7 +149,13 @@ void NetworkRequestManager::handleDataCb(HttpReqTask *task, void *user_data) {
 
     NetworkRequestManager *pThis = (NetworkRequestManager *) user_data;
     LS_LOG_DEBUG("handleDataCb task  %p", task);
-    HttpInterface *client = pThis->httpRequestList[task];
+    auto it = pThis->httpRequestList.find(task);
+
+    if (it == pThis->httpRequestList.end()) {
+        //cancelled or timed out while the transfer completed
+        LS_LOG_INFO("handleDataCb for unknown task %p ignored", task);
+        return;
+    }
 
     if (HTTP_STATUS_CODE_SUCCESS == task->curlDesc.httpResponseCode) {
         LS_LOG_DEBUG("cbHttpResponsee %s", task->responseData);
@@ -67,6 +163,68 @@ void NetworkRequestManager::handleDataCb(HttpReqTask *task, void *user_data) {
         LS_LOG_DEBUG("task->curlDesc.curlResultErrorStr %s", task->curlDesc.curlResultErrorStr);
     }
 
+    bool failed = isFailure(task);
+
+    pThis->setActive(it->second, false);
+
+    // curl resolves on its own, the shared resolver learns whether the name exists at all
+    if (task->curlDesc.curlResultCode == CURLE_COULDNT_RESOLVE_HOST)
+        DnsResolver::getInstance()->prefetch(vector<string>(1, DnsResolver::hostOfUrl(it->second.url)));
+
+    pThis->mCircuitBreaker.recordResult(it->second.host, !failed, g_get_monotonic_time());
+    it->second.probe = false;
+
+    if (failed && pThis->scheduleRetry(task, it->second))
+        return;
+
+    pThis->finishTransaction(task);
+}
+
+void NetworkRequestManager::finishTransaction(HttpReqTask *task) {
+    auto it = httpRequestList.find(task);
+
+    if (it == httpRequestList.end())
+        return;
+
+    HttpInterface *client = it->second.client;
+    vector<HttpReqTask *> followers;
+
+    if (it->second.queued)
+        unqueue(task, it->second);
+
+    if (it->second.cacheTtlMs && client)
+        applyCache(task, it->second);
+
+    it->second.completed = true;
+    followers.swap(it->second.followers);
+
+    if (!it->second.key.empty()) {
+        inflightRequests.erase(it->second.key);
+        it->second.key.clear();
+    }
+
+    if (it->second.timerId) {
+        g_source_remove(it->second.timerId);
+        it->second.timerId = 0;
+    }
+
+    // copied before any client runs, the leader's client clears its task
+    for (HttpReqTask *follower : followers) {
+        auto fit = httpRequestList.find(follower);
+
+        if (fit == httpRequestList.end())
+            continue;
+
+        if (fit->second.timerId) {
+            g_source_remove(fit->second.timerId);
+            fit->second.timerId = 0;
+        }
+
+        copyResult(task, follower);
+        fit->second.leader = NULL;
+        fit->second.completed = true;
+    }
+
     LS_LOG_DEBUG("received client address %p", client);
 
     if (client)
@@ -74,28 +232,195 @@ void NetworkRequestManager::handleDataCb(HttpReqTask *task, void *user_data) {
     else {
         //client is removed, clear task
         LS_LOG_INFO("No client to handleResponse");
-        pThis->clearTransaction(task);
+        clearTransaction(task);
     }
 
+    for (HttpReqTask *follower : followers) {
+        auto fit = httpRequestList.find(follower);
+
+        if (fit == httpRequestList.end())
+            continue;
+
+        if (fit->second.client)
+            fit->second.client->handleResponse(follower);
+        else
+            clearTransaction(follower);
+    }
+}
+
+// no answer, or one that says the server cannot serve right now
+bool NetworkRequestManager::isFailure(const HttpReqTask *task) {
+    long code = task->curlDesc.httpResponseCode;
+
+    return task->curlDesc.curlResultCode || code == 0 || code == 429 || code >= 500;
+}
+
+bool NetworkRequestManager::scheduleRetry(HttpReqTask *task, HttpTransaction &transaction) {
+    unsigned int delay = 0;
+
+    if (transaction.retries >= transaction.maxRetries ||
+        mCircuitBreaker.isOpen(transaction.host, g_get_monotonic_time()))
+        return false;
+
+    // exponential backoff with equal jitter, so failing clients do not retry in step
+    delay = MIN(HTTP_RETRY_BASE_DELAY_MS << transaction.retries, HTTP_RETRY_MAX_DELAY_MS);
+    delay = delay / 2 + g_random_int_range(0, delay / 2 + 1);
+
+    transaction.retries++;
+    mRetries++;
+
+    loc_http_remove_request(task);
+    transaction.removed = true;
+
+    if (task->responseData) {
+        g_free(task->responseData);
+        task->responseData = NULL;
+        task->responseSize = 0;
+    }
+
+    transaction.retryTimerId = g_timeout_add(delay, &handleRetryCb, task);
+
+    LS_LOG_INFO("task %p failed, retry %u of %u in %u ms", task, transaction.retries, transaction.maxRetries, delay);
+
+    return true;
+}
+
+gboolean NetworkRequestManager::handleRetryCb(gpointer data) {
+    NetworkRequestManager *pThis = getInstance();
+    HttpReqTask *task = (HttpReqTask *) data;
+    auto it = pThis->httpRequestList.find(task);
+    bool probe = false;
+
+    if (it == pThis->httpRequestList.end())
+        return G_SOURCE_REMOVE;
+
+    it->second.retryTimerId = 0;
+
+    if (DnsResolver::getInstance()->isUnresolvable(DnsResolver::hostOfUrl(it->second.url))) {
+        LS_LOG_INFO("%s does not resolve, retry of task %p dropped", it->second.host.c_str(), task);
+    } else if (!loc_http_task_prepare_connection(&task, (char *) it->second.url.c_str())) {
+        LS_LOG_ERROR("retry of task %p could not be prepared", task);
+    } else if (pThis->mustWait(it->second.priority)) {
+        // a retry takes its turn behind the requests already waiting in its class
+        pThis->queueTransaction(task, NULL, 0);
+        return G_SOURCE_REMOVE;
+    } else if (!pThis->mCircuitBreaker.allowRequest(it->second.host, g_get_monotonic_time(), &probe)) {
+        LS_LOG_INFO("circuit of %s is open, retry of task %p dropped", it->second.host.c_str(), task);
+    } else if (loc_http_add_request(task, false)) {
+        pThis->setActive(it->second, true);
+        it->second.sentAt = g_get_monotonic_time();
+        it->second.removed = false;
+        it->second.probe = probe;
+        return G_SOURCE_REMOVE;
+    } else if (probe) {
+        pThis->mCircuitBreaker.cancelProbe(it->second.host);
+    }
+
+    // the failure of the last attempt is the result
+    pThis->finishTransaction(task);
+
+    return G_SOURCE_REMOVE;
 }
 
 ErrorCodes NetworkRequestManager::initiateTransaction(const char **headers, int size, string url, bool isSync,
-                                                      LSMessage *message, HttpInterface *userdata, char *post_data) {
+                                                      LSMessage *message, HttpInterface *userdata, char *post_data,
+                                                      HttpReqTask **task, const HttpRequestOptions *options) {
+    unsigned int timeoutMs = options ? options->timeoutMs : 0;
+    HttpPriority priority = options ? options->priority : HTTP_PRIORITY_BACKGROUND_POSITION;
+    int64_t cacheTtlMs = 0;
 
     if (!_attributes.test(Network_Defines::ACTIVE)) {
         LS_LOG_DEBUG("Network Manager Inactive");
         return ERROR_MUTLITHREAD;
     }
 
-    HttpReqTask *gHttpReqTask = loc_create_http_task(headers, 0, message, userdata);
+    string host = HttpConnectionPool::hostKey(url);
+    string key;
+    HttpReqTask *gHttpReqTask = NULL;
+    bool probe = false;
+    bool queued = false;
+
+    if (priority < 0 || priority >= HTTP_PRIORITY_MAX)
+        priority = HTTP_PRIORITY_BACKGROUND_POSITION;
+
+    queued = !isSync && mustWait(priority);
+
+    // plain GETs only, as the cache can not see request headers
+    if (options && options->cacheTtlMs > 0 && !headers && !post_data && !isSync) {
+        string body;
+
+        cacheTtlMs = options->cacheTtlMs;
+
+        if (mResponseCache.lookup(url, g_get_real_time() / 1000, false, body))
+            return serveFromCache(body, message, userdata, task);
+    }
+
+    // an identical request in flight or queued is shared instead of sent again
+    if (!headers && !isSync) {
+        key = coalescingKey(url, post_data);
+        auto inflight = inflightRequests.find(key);
+
+        if (inflight != inflightRequests.end())
+            return attachFollower(inflight->second, message, userdata, task, timeoutMs);
+    }
+
+    if (queued && mQueued[priority].size() >= HTTP_QUEUED_MAX_PER_CLASS) {
+        LS_LOG_INFO("queue of %s is full, request to %s failed", priorityClasses[priority].name, host.c_str());
+        mPriorityStats[priority].rejected++;
+
+        if (!mOnline)
+            mDeferredStats.rejected++;
 
-    if (NULL == gHttpReqTask) {
-        LS_LOG_ERROR("Fatal error...loc_create_http failed!!");
         return ERROR_NETWORK_ERROR;
     }
 
+    // a name known not to exist fails here instead of in curl, a queued
+    // request is looked up again when it is dispatched
+    if (!queued && DnsResolver::getInstance()->isUnresolvable(DnsResolver::hostOfUrl(url))) {
+        string body;
+
+        if (cacheTtlMs > 0 && mResponseCache.lookup(url, g_get_real_time() / 1000, true, body)) {
+            LS_LOG_INFO("%s does not resolve, answered from a stale cache entry", host.c_str());
+            return serveFromCache(body, message, userdata, task);
+        }
+
+        LS_LOG_INFO("%s does not resolve, request failed fast", host.c_str());
+        return ERROR_NETWORK_ERROR;
+    }
+
+    // a queued request asks its circuit when it is dispatched
+    if (!queued && !mCircuitBreaker.allowRequest(host, g_get_monotonic_time(), &probe)) {
+        LS_LOG_INFO("circuit of %s is open, request failed fast", host.c_str());
+        return ERROR_NOT_AVAILABLE;
+    }
+
+    // pooled tasks carry no headers, keep the connection of the last request to host
+    if (!headers)
+        gHttpReqTask = mConnectionPool.acquire(host);
+
+    if (gHttpReqTask) {
+        gHttpReqTask->message = message;
+    } else {
+        gHttpReqTask = loc_create_http_task(headers, 0, message, userdata);
+
+        if (NULL == gHttpReqTask) {
+            LS_LOG_ERROR("Fatal error...loc_create_http failed!!");
+
+            if (probe)
+                mCircuitBreaker.cancelProbe(host);
+
+            return ERROR_NETWORK_ERROR;
+        }
+
+        mConnectionPool.recordNewTask();
+    }
+
     if (!loc_http_task_prepare_connection(&gHttpReqTask, (char *) url.c_str())) {
         loc_http_task_destroy(&gHttpReqTask);
+
+        if (probe)
+            mCircuitBreaker.cancelProbe(host);
+
         return ERROR_NETWORK_ERROR;
     }
 
@@ -109,25 +434,690 @@ ErrorCodes NetworkRequestManager::initiateTransaction(const char **headers, int
     if (post_data)
         gHttpReqTask->post_data = strdup(post_data);
 
+    HttpTransaction transaction = HttpTransaction();
+    transaction.client = userdata;
+    transaction.message = message;
+    transaction.key = key;
+    transaction.host = host;
+    transaction.url = url;
+    transaction.pooled = !headers;
+    transaction.probe = probe;
+    transaction.cacheTtlMs = cacheTtlMs;
+    transaction.priority = priority;
+
+    // retries are timer driven, a synchronous caller has its answer already
+    if (!isSync && options)
+        transaction.maxRetries = options->maxRetries;
+
+    httpRequestList[gHttpReqTask] = transaction;
+
+    if (!key.empty())
+        inflightRequests[key] = gHttpReqTask;
+
+    if (queued)
+        return queueTransaction(gHttpReqTask, task, timeoutMs);
+
+    // counted before the request is added, a synchronous one completes inside
+    setActive(httpRequestList[gHttpReqTask], true);
+    httpRequestList[gHttpReqTask].sentAt = g_get_monotonic_time();
+    mPriorityStats[priority].sent++;
+
     if (!loc_http_add_request(gHttpReqTask, isSync)) {
+        auto failed = httpRequestList.find(gHttpReqTask);
+
+        if (failed != httpRequestList.end())
+            setActive(failed->second, false);
+
+        mPriorityStats[priority].sent--;
+
+        if (!key.empty())
+            inflightRequests.erase(key);
+
+        httpRequestList.erase(gHttpReqTask);
         loc_http_task_destroy(&gHttpReqTask);
+
+        if (probe)
+            mCircuitBreaker.cancelProbe(host);
+
         return ERROR_NETWORK_ERROR;
     }
 
-    httpRequestList[gHttpReqTask] = userdata;
+    auto it = httpRequestList.find(gHttpReqTask);
+
+    // a synchronous request has completed by now
+    if (timeoutMs && !isSync && it != httpRequestList.end())
+        it->second.timerId = g_timeout_add(timeoutMs, &handleDeadlineCb, gHttpReqTask);
+
+    if (task)
+        *task = gHttpReqTask;
+
     return ERROR_NONE;
 
 }
 
-void NetworkRequestManager::cancelTransaction(HttpReqTask *) {
-//TBD
+gboolean NetworkRequestManager::handleDeadlineCb(gpointer data) {
+    NetworkRequestManager *pThis = getInstance();
+    HttpReqTask *task = (HttpReqTask *) data;
+    auto it = pThis->httpRequestList.find(task);
+
+    if (it == pThis->httpRequestList.end())
+        return G_SOURCE_REMOVE;
+
+    LS_LOG_INFO("request deadline expired for task %p", task);
+
+    it->second.timerId = 0;
+    task->curlDesc.httpResponseCode = 0;
+
+    // requests coalesced onto a queued one expire with it
+    if (it->second.queued) {
+        LS_LOG_INFO("task %p expired in the queue of %s", task, priorityClasses[it->second.priority].name);
+        pThis->mPriorityStats[it->second.priority].expired++;
+
+        if (it->second.deferred)
+            pThis->mDeferredStats.expired++;
+
+        pThis->finishTransaction(task);
+        return G_SOURCE_REMOVE;
+    }
+
+    if (it->second.leader) {
+        pThis->detachFollower(task, it->second);
+    } else if (it->second.followers.empty()) {
+        if (it->second.retryTimerId) {
+            g_source_remove(it->second.retryTimerId);
+            it->second.retryTimerId = 0;
+        }
+
+        // a hung transfer counts against its endpoint, a failed one already did
+        if (!it->second.removed) {
+            loc_http_remove_request(task);
+            it->second.removed = true;
+            pThis->setActive(it->second, false);
+            pThis->mCircuitBreaker.recordResult(it->second.host, false, g_get_monotonic_time());
+            it->second.probe = false;
+        }
+
+        if (!it->second.key.empty()) {
+            pThis->inflightRequests.erase(it->second.key);
+            it->second.key.clear();
+        }
+    }
+    // else the transfer goes on for the requests coalesced onto it
+
+    if (it->second.client)
+        it->second.client->handleTimeout(task);
+    else
+        pThis->clearTransaction(task);
+
+    return G_SOURCE_REMOVE;
+}
+
+bool NetworkRequestManager::cancelTransaction(HttpReqTask *task) {
+    if (httpRequestList.find(task) == httpRequestList.end())
+        return false;
+
+    LS_LOG_INFO("cancelling task %p", task);
+    clearTransaction(task);
+
+    return true;
+}
+
+int NetworkRequestManager::cancelTransactions(const void *owner) {
+    vector<HttpReqTask *> tasks;
+
+    if (!owner)
+        return 0;
+
+    for (auto &entry : httpRequestList) {
+        if (entry.second.client == owner || entry.second.message == owner)
+            tasks.push_back(entry.first);
+    }
+
+    for (HttpReqTask *task : tasks)
+        cancelTransaction(task);
+
+    return tasks.size();
+}
+
+string NetworkRequestManager::coalescingKey(const string &url, const char *post_data) {
+    string key = (post_data ? "POST " : "GET ") + url;
+
+    if (post_data) {
+        gchar *digest = g_compute_checksum_for_string(G_CHECKSUM_SHA1, post_data, -1);
+
+        key += " ";
+        key += digest;
+        g_free(digest);
+    }
+
+    return key;
+}
+
+void NetworkRequestManager::copyResult(const HttpReqTask *from, HttpReqTask *to) {
+    to->curlDesc.httpResponseCode = from->curlDesc.httpResponseCode;
+    to->curlDesc.curlResultCode = from->curlDesc.curlResultCode;
+    to->curlDesc.httpConnectCode = from->curlDesc.httpConnectCode;
+
+    if (to->responseData) {
+        g_free(to->responseData);
+        to->responseData = NULL;
+        to->responseSize = 0;
+    }
+
+    if (from->responseData) {
+        to->responseData = g_strndup(from->responseData, from->responseSize);
+        to->responseSize = from->responseSize;
+    }
+}
+
+ErrorCodes NetworkRequestManager::attachFollower(HttpReqTask *leader, LSMessage *message, HttpInterface *client,
+                                                 HttpReqTask **task, unsigned int timeoutMs) {
+    HttpReqTask *follower = loc_create_http_task(NULL, 0, message, client);
+
+    if (NULL == follower) {
+        LS_LOG_ERROR("Fatal error...loc_create_http failed!!");
+        return ERROR_NETWORK_ERROR;
+    }
+
+    HttpTransaction transaction = HttpTransaction();
+    transaction.client = client;
+    transaction.message = message;
+    transaction.removed = true;
+    transaction.leader = leader;
+
+    if (timeoutMs)
+        transaction.timerId = g_timeout_add(timeoutMs, &handleDeadlineCb, follower);
+
+    httpRequestList[follower] = transaction;
+    httpRequestList[leader].followers.push_back(follower);
+    mCoalescedRequests++;
+
+    LS_LOG_DEBUG("task %p coalesced onto task %p", follower, leader);
+
+    if (task)
+        *task = follower;
+
+    return ERROR_NONE;
+}
+
+void NetworkRequestManager::detachFollower(HttpReqTask *task, HttpTransaction &transaction) {
+    auto it = httpRequestList.find(transaction.leader);
+
+    transaction.leader = NULL;
+
+    if (it == httpRequestList.end())
+        return;
+
+    vector<HttpReqTask *> &followers = it->second.followers;
+    followers.erase(remove(followers.begin(), followers.end(), task), followers.end());
+
+    // nobody waits on the transfer any more
+    if (followers.empty() && !it->second.client && !it->second.completed)
+        clearTransaction(it->first);
 }
 
 void NetworkRequestManager::clearTransaction(HttpReqTask *task) {
-    httpRequestList.erase(task);
-    loc_http_remove_request(task);
-    loc_http_task_destroy(&task);
+    auto it = httpRequestList.find(task);
+    HttpTransaction transaction = HttpTransaction();
+
+    if (it != httpRequestList.end()) {
+        // the transfer still serves coalesced requests, only its own client leaves
+        if (!it->second.followers.empty() && !it->second.completed) {
+            LS_LOG_DEBUG("task %p kept for %zu coalesced requests", task, it->second.followers.size());
+            it->second.client = NULL;
+            it->second.message = NULL;
+
+            // while queued the deadline still bounds the wait of the others
+            if (it->second.timerId && !it->second.queued) {
+                g_source_remove(it->second.timerId);
+                it->second.timerId = 0;
+            }
+
+            return;
+        }
+
+        if (it->second.timerId) {
+            g_source_remove(it->second.timerId);
+            it->second.timerId = 0;
+        }
+
+        if (it->second.queued)
+            unqueue(task, it->second);
+
+        if (it->second.retryTimerId) {
+            g_source_remove(it->second.retryTimerId);
+            it->second.retryTimerId = 0;
+        }
+
+        if (it->second.deliverId) {
+            g_source_remove(it->second.deliverId);
+            it->second.deliverId = 0;
+        }
+
+        if (it->second.leader)
+            detachFollower(task, it->second);
+
+        if (it->second.probe)
+            mCircuitBreaker.cancelProbe(it->second.host);
+
+        if (!it->second.key.empty())
+            inflightRequests.erase(it->second.key);
+
+        setActive(it->second, false);
+        transaction = it->second;
+        httpRequestList.erase(it);
+    }
+
+    if (!transaction.removed)
+        loc_http_remove_request(task);
+
+    if (!transaction.pooled) {
+        loc_http_task_destroy(&task);
+    } else {
+        // a cancelled or failed transfer may have left its connection half used
+        bool healthy = transaction.completed && !task->curlDesc.curlResultCode &&
+                       task->curlDesc.httpResponseCode != 0;
+
+        mConnectionPool.release(transaction.host, task, healthy);
+    }
 
     LS_LOG_DEBUG("transaction cleared");
 }
 
+int64_t NetworkRequestManager::getAttemptLatencyMs(HttpReqTask *task) const {
+    auto it = httpRequestList.find(task);
+
+    if (it == httpRequestList.end() || !it->second.sentAt)
+        return -1;
+
+    return (g_get_monotonic_time() - it->second.sentAt) / 1000;
+}
+
+void NetworkRequestManager::getConnectionStats(HttpConnectionPoolStats *stats) const {
+    mConnectionPool.getStats(stats);
+}
+
+void NetworkRequestManager::setOnline(bool online) {
+    size_t queued = 0;
+
+    if (online == mOnline)
+        return;
+
+    for (int i = 0; i < HTTP_PRIORITY_MAX; i++)
+        queued += mQueued[i].size();
+
+    mOnline = online;
+    LS_LOG_INFO("network requests %s, %zu queued", online ? "online" : "offline", queued);
+
+    if (online && queued) {
+        mReplaying = true;
+        scheduleDispatch();
+    }
+}
+
+// offline every request waits, online only those of a class at its limit or behind others
+bool NetworkRequestManager::mustWait(HttpPriority priority) const {
+    return !mOnline || !mQueued[priority].empty() || mActive[priority] >= priorityClasses[priority].limit ||
+           mActiveTotal >= HTTP_MAX_ACTIVE;
+}
+
+ErrorCodes NetworkRequestManager::queueTransaction(HttpReqTask *task, HttpReqTask **outTask, unsigned int timeoutMs) {
+    HttpTransaction &transaction = httpRequestList[task];
+    HttpPriority priority = transaction.priority;
+
+    transaction.queued = true;
+    transaction.deferred = !mOnline;
+    transaction.removed = true;
+    transaction.queuedAt = g_get_monotonic_time();
+
+    // every queued request expires, whether or not its caller set a deadline
+    if (!transaction.timerId)
+        transaction.timerId = g_timeout_add(timeoutMs ? timeoutMs : HTTP_QUEUED_MAX_AGE_MS, &handleDeadlineCb, task);
+
+    // a class that had nothing to send does not bank credit for the idle time
+    if (mQueued[priority].empty())
+        mFinishTag[priority] = MAX(mFinishTag[priority], mVirtualTime);
+
+    mQueued[priority].push_back(task);
+
+    if (transaction.deferred) {
+        mDeferredStats.deferred++;
+        LS_LOG_INFO("offline, task %p queued for %s", task, transaction.host.c_str());
+    } else {
+        LS_LOG_INFO("task %p queued behind %u active %s requests", task, mActive[priority],
+                    priorityClasses[priority].name);
+    }
+
+    scheduleDispatch();
+
+    if (outTask)
+        *outTask = task;
+
+    return ERROR_NONE;
+}
+
+void NetworkRequestManager::unqueue(HttpReqTask *task, HttpTransaction &transaction) {
+    deque<HttpReqTask *> &queue = mQueued[transaction.priority];
+
+    transaction.queued = false;
+    queue.erase(remove(queue.begin(), queue.end(), task), queue.end());
+}
+
+void NetworkRequestManager::setActive(HttpTransaction &transaction, bool active) {
+    if (transaction.active == active)
+        return;
+
+    transaction.active = active;
+
+    if (active) {
+        mActive[transaction.priority]++;
+        mActiveTotal++;
+        return;
+    }
+
+    mActive[transaction.priority]--;
+    mActiveTotal--;
+
+    // the freed slot goes to the next waiting request
+    scheduleDispatch();
+}
+
+// start-time fair queueing, the waiting class with the smallest tag goes next
+int NetworkRequestManager::nextPriority() const {
+    int next = -1;
+
+    if (!mOnline || mActiveTotal >= HTTP_MAX_ACTIVE)
+        return -1;
+
+    for (int i = 0; i < HTTP_PRIORITY_MAX; i++) {
+        if (mQueued[i].empty() || mActive[i] >= priorityClasses[i].limit)
+            continue;
+
+        if (next < 0 || mFinishTag[i] < mFinishTag[next])
+            next = i;
+    }
+
+    return next;
+}
+
+// always from the main loop, dispatching may complete transactions and run their clients
+void NetworkRequestManager::scheduleDispatch() {
+    if (mDispatchId || nextPriority() < 0)
+        return;
+
+    if (mReplaying)
+        mDispatchId = g_timeout_add(HTTP_REPLAY_INTERVAL_MS, &dispatchQueuedCb, this);
+    else
+        mDispatchId = g_idle_add(&dispatchQueuedCb, this);
+}
+
+gboolean NetworkRequestManager::dispatchQueuedCb(gpointer data) {
+    NetworkRequestManager *pThis = static_cast<NetworkRequestManager *>(data);
+
+    pThis->mDispatchId = 0;
+    pThis->dispatchQueued();
+    pThis->scheduleDispatch();
+
+    return G_SOURCE_REMOVE;
+}
+
+void NetworkRequestManager::dispatchQueued() {
+    bool empty = true;
+    int next = -1;
+
+    // the backlog of an offline period is paced, not sent at once
+    for (int sent = 0; (!mReplaying || sent < HTTP_REPLAY_BURST) && (next = nextPriority()) >= 0; sent++) {
+        HttpReqTask *task = mQueued[next].front();
+        HttpTransaction &transaction = httpRequestList[task];
+        HttpPriorityStats &stats = mPriorityStats[next];
+        uint64_t waitMs = (g_get_monotonic_time() - transaction.queuedAt) / 1000;
+        bool probe = false;
+
+        unqueue(task, transaction);
+        mVirtualTime = mFinishTag[next];
+        mFinishTag[next] += HTTP_WFQ_SCALE / priorityClasses[next].weight;
+
+        if (!mCircuitBreaker.allowRequest(transaction.host, g_get_monotonic_time(), &probe)) {
+            LS_LOG_INFO("circuit of %s is open, queued task %p failed", transaction.host.c_str(), task);
+        } else if (loc_http_add_request(task, false)) {
+            setActive(transaction, true);
+            transaction.sentAt = g_get_monotonic_time();
+            transaction.removed = false;
+            transaction.probe = probe;
+
+            stats.sent++;
+            stats.waited++;
+            stats.totalWaitMs += waitMs;
+            stats.maxWaitMs = MAX(stats.maxWaitMs, waitMs);
+
+            if (transaction.deferred)
+                mDeferredStats.replayed++;
+
+            continue;
+        } else if (probe) {
+            mCircuitBreaker.cancelProbe(transaction.host);
+        }
+
+        task->curlDesc.httpResponseCode = 0;
+        finishTransaction(task);
+    }
+
+    for (int i = 0; i < HTTP_PRIORITY_MAX; i++)
+        empty = empty && mQueued[i].empty();
+
+    if (empty)
+        mReplaying = false;
+}
+
+void NetworkRequestManager::getDeferredStats(HttpDeferredStats *stats) const {
+    *stats = mDeferredStats;
+    stats->queued = 0;
+
+    for (int i = 0; i < HTTP_PRIORITY_MAX; i++) {
+        for (HttpReqTask *task : mQueued[i]) {
+            auto it = httpRequestList.find(task);
+
+            if (it != httpRequestList.end() && it->second.deferred)
+                stats->queued++;
+        }
+    }
+}
+
+unsigned int NetworkRequestManager::getPriorityLimit(HttpPriority priority) const {
+    if (priority < 0 || priority >= HTTP_PRIORITY_MAX)
+        return 0;
+
+    return priorityClasses[priority].limit;
+}
+
+void NetworkRequestManager::getPriorityStats(std::vector<HttpPriorityStats> &stats) const {
+    for (int i = 0; i < HTTP_PRIORITY_MAX; i++) {
+        HttpPriorityStats entry = mPriorityStats[i];
+
+        entry.active = mActive[i];
+        entry.queued = mQueued[i].size();
+        stats.push_back(entry);
+    }
+}
+
+ErrorCodes NetworkRequestManager::serveFromCache(const string &body, LSMessage *message, HttpInterface *client,
+                                                HttpReqTask **task) {
+    HttpReqTask *cached = loc_create_http_task(NULL, 0, message, client);
+
+    if (NULL == cached) {
+        LS_LOG_ERROR("Fatal error...loc_create_http failed!!");
+        return ERROR_NETWORK_ERROR;
+    }
+
+    cached->responseData = g_strndup(body.c_str(), body.size());
+    cached->responseSize = body.size();
+    cached->curlDesc.httpResponseCode = HTTP_STATUS_CODE_SUCCESS;
+
+    HttpTransaction transaction = HttpTransaction();
+    transaction.client = client;
+    transaction.message = message;
+    transaction.removed = true;
+
+    // answered from the main loop like any transfer, after the caller has set up its state
+    transaction.deliverId = g_idle_add(&deliverCachedCb, cached);
+    httpRequestList[cached] = transaction;
+
+    LS_LOG_DEBUG("task %p served from the http cache", cached);
+
+    if (task)
+        *task = cached;
+
+    return ERROR_NONE;
+}
+
+gboolean NetworkRequestManager::deliverCachedCb(gpointer data) {
+    NetworkRequestManager *pThis = getInstance();
+    HttpReqTask *task = (HttpReqTask *) data;
+    auto it = pThis->httpRequestList.find(task);
+
+    if (it == pThis->httpRequestList.end())
+        return G_SOURCE_REMOVE;
+
+    it->second.deliverId = 0;
+    pThis->finishTransaction(task);
+
+    return G_SOURCE_REMOVE;
+}
+
+void NetworkRequestManager::applyCache(HttpReqTask *task, HttpTransaction &transaction) {
+    int64_t now = g_get_real_time() / 1000;
+    string body;
+
+    if (HTTP_STATUS_CODE_SUCCESS == task->curlDesc.httpResponseCode) {
+        if (transaction.client->isCacheable(task))
+            mResponseCache.store(transaction.url, task->responseData, transaction.cacheTtlMs, now);
+    } else if (isFailure(task) && mResponseCache.lookup(transaction.url, now, true, body)) {
+        // stale if error, an old answer beats none
+        LS_LOG_INFO("task %p failed, answered from a stale cache entry", task);
+
+        if (task->responseData)
+            g_free(task->responseData);
+
+        task->responseData = g_strndup(body.c_str(), body.size());
+        task->responseSize = body.size();
+        task->curlDesc.httpResponseCode = HTTP_STATUS_CODE_SUCCESS;
+    }
+}
+
+void NetworkRequestManager::getCacheStats(HttpResponseCacheStats *stats) const {
+    mResponseCache.getStats(stats);
+}
+
+void NetworkRequestManager::getCircuitStats(std::vector<CircuitBreakerStats> &stats) const {
+    mCircuitBreaker.getStats(stats, g_get_monotonic_time());
+}
+
+bool NetworkRequestManager::appendStats(jvalue_ref parent) const {
+    HttpConnectionPoolStats connectionStats;
+    std::vector<CircuitBreakerStats> circuitStats;
+    HttpDeferredStats deferredStats;
+    HttpResponseCacheStats cacheStats;
+    std::vector<HttpPriorityStats> priorityStats;
+    jvalue_ref connectionsObject = jobject_create();
+    jvalue_ref circuitsArray = jarray_create(NULL);
+    jvalue_ref offlineQueueObject = jobject_create();
+    jvalue_ref cacheObject = jobject_create();
+    jvalue_ref prioritiesArray = jarray_create(NULL);
+
+    // parent owns whatever was created and releases it on failure
+    if (!jis_null(connectionsObject))
+        jobject_put(parent, J_CSTR_TO_JVAL("httpConnections"), connectionsObject);
+
+    if (!jis_null(circuitsArray))
+        jobject_put(parent, J_CSTR_TO_JVAL("circuitBreakers"), circuitsArray);
+
+    if (!jis_null(offlineQueueObject))
+        jobject_put(parent, J_CSTR_TO_JVAL("offlineQueue"), offlineQueueObject);
+
+    if (!jis_null(cacheObject))
+        jobject_put(parent, J_CSTR_TO_JVAL("httpCache"), cacheObject);
+
+    if (!jis_null(prioritiesArray))
+        jobject_put(parent, J_CSTR_TO_JVAL("httpPriorities"), prioritiesArray);
+
+    if (jis_null(connectionsObject) || jis_null(circuitsArray) || jis_null(offlineQueueObject) ||
+        jis_null(cacheObject) || jis_null(prioritiesArray))
+        return false;
+
+    getConnectionStats(&connectionStats);
+
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("requests"), jnumber_create_i64(connectionStats.requests));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("reused"), jnumber_create_i64(connectionStats.reused));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("newTasks"), jnumber_create_i64(connectionStats.newTasks));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("reuseRatio"),
+                jnumber_create_f64(connectionStats.requests ?
+                                   (double) connectionStats.reused / connectionStats.requests : 0));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("unhealthy"), jnumber_create_i64(connectionStats.unhealthy));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("expired"), jnumber_create_i64(connectionStats.expired));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("overflow"), jnumber_create_i64(connectionStats.overflow));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("idleConnections"),
+                jnumber_create_i64(connectionStats.idleConnections));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("hosts"), jnumber_create_i64(connectionStats.hosts));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("coalesced"), jnumber_create_i64(mCoalescedRequests));
+    jobject_put(connectionsObject, J_CSTR_TO_JVAL("retries"), jnumber_create_i64(mRetries));
+
+    getCircuitStats(circuitStats);
+
+    for (const CircuitBreakerStats &circuit : circuitStats) {
+        jvalue_ref circuitObject = jobject_create();
+
+        if (jis_null(circuitObject))
+            return false;
+
+        jobject_put(circuitObject, J_CSTR_TO_JVAL("endpoint"), jstring_create(circuit.endpoint.c_str()));
+        jobject_put(circuitObject, J_CSTR_TO_JVAL("state"), jstring_create(circuit.state));
+        jobject_put(circuitObject, J_CSTR_TO_JVAL("consecutiveFailures"),
+                    jnumber_create_i64(circuit.consecutiveFailures));
+        jobject_put(circuitObject, J_CSTR_TO_JVAL("trips"), jnumber_create_i64(circuit.trips));
+        jobject_put(circuitObject, J_CSTR_TO_JVAL("rejected"), jnumber_create_i64(circuit.rejected));
+        jobject_put(circuitObject, J_CSTR_TO_JVAL("retryInMs"), jnumber_create_i64(circuit.retryInMs));
+        jarray_append(circuitsArray, circuitObject);
+    }
+
+    getDeferredStats(&deferredStats);
+
+    jobject_put(offlineQueueObject, J_CSTR_TO_JVAL("deferred"), jnumber_create_i64(deferredStats.deferred));
+    jobject_put(offlineQueueObject, J_CSTR_TO_JVAL("replayed"), jnumber_create_i64(deferredStats.replayed));
+    jobject_put(offlineQueueObject, J_CSTR_TO_JVAL("expired"), jnumber_create_i64(deferredStats.expired));
+    jobject_put(offlineQueueObject, J_CSTR_TO_JVAL("rejected"), jnumber_create_i64(deferredStats.rejected));
+    jobject_put(offlineQueueObject, J_CSTR_TO_JVAL("queued"), jnumber_create_i64(deferredStats.queued));
+
+    getCacheStats(&cacheStats);
+
+    jobject_put(cacheObject, J_CSTR_TO_JVAL("hits"), jnumber_create_i64(cacheStats.hits));
+    jobject_put(cacheObject, J_CSTR_TO_JVAL("staleHits"), jnumber_create_i64(cacheStats.staleHits));
+    jobject_put(cacheObject, J_CSTR_TO_JVAL("misses"), jnumber_create_i64(cacheStats.misses));
+    jobject_put(cacheObject, J_CSTR_TO_JVAL("stores"), jnumber_create_i64(cacheStats.stores));
+    jobject_put(cacheObject, J_CSTR_TO_JVAL("evictions"), jnumber_create_i64(cacheStats.evictions));
+    jobject_put(cacheObject, J_CSTR_TO_JVAL("entries"), jnumber_create_i64(cacheStats.entries));
+    jobject_put(cacheObject, J_CSTR_TO_JVAL("bytes"), jnumber_create_i64(cacheStats.bytes));
+
+    getPriorityStats(priorityStats);
+
+    for (const HttpPriorityStats &priority : priorityStats) {
+        jvalue_ref priorityObject = jobject_create();
+
+        if (jis_null(priorityObject))
+            return false;
+
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("class"), jstring_create(priority.name));
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("limit"), jnumber_create_i64(priority.limit));
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("active"), jnumber_create_i64(priority.active));
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("queued"), jnumber_create_i64(priority.queued));
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("sent"), jnumber_create_i64(priority.sent));
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("waited"), jnumber_create_i64(priority.waited));
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("expired"), jnumber_create_i64(priority.expired));
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("rejected"), jnumber_create_i64(priority.rejected));
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("averageWaitMs"),
+                    jnumber_create_i64(priority.waited ? priority.totalWaitMs / priority.waited : 0));
+        jobject_put(priorityObject, J_CSTR_TO_JVAL("maxWaitMs"), jnumber_create_i64(priority.maxWaitMs));
+        jarray_append(prioritiesArray, priorityObject);
+    }
+
+    return true;
+}
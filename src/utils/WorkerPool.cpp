@@ -0,0 +1,223 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+#include <string.h>
+#include <algorithm>
+#include <system_error>
+#include <loc_log.h>
+#include <WorkerPool.h>
+
+WorkerPool::WorkerPool(size_t maxThreads, size_t maxQueued)
+    : mMaxThreads(maxThreads),
+      mMaxQueued(maxQueued),
+      mQueued(0),
+      mNextId(0),
+      mStopping(false) {
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+unsigned int WorkerPool::submit(const char *name, WorkerPriority priority, WorkerFunc func, void *data,
+                                WorkerFunc release) {
+    std::lock_guard<std::mutex> lock(mLock);
+    Task task = {0, name, func, release, data};
+
+    if (!func || priority < 0 || priority >= WORKER_PRIORITY_MAX)
+        return 0;
+
+    if (mStopping || mQueued >= mMaxQueued) {
+        LS_LOG_ERROR("worker queue %s, task %s rejected", mStopping ? "stopped" : "full", name);
+        mStats.rejected++;
+        return 0;
+    }
+
+    // a new thread only when every running one is busy
+    if (mThreads.size() < mMaxThreads && mRunning.size() + mQueued >= mThreads.size()) {
+        try {
+            mThreads.push_back(std::thread(&WorkerPool::run, this));
+        } catch (const std::system_error &e) {
+            LS_LOG_ERROR("failed to start a worker thread: %s", e.what());
+
+            if (mThreads.empty()) {
+                mStats.rejected++;
+                return 0;
+            }
+        }
+    }
+
+    // 0 is never handed out, it means rejected
+    if (++mNextId == 0)
+        ++mNextId;
+
+    task.id = mNextId;
+    mQueues[priority].push_back(task);
+    mQueued++;
+    mStats.submitted++;
+    mStats.maxQueued = std::max(mStats.maxQueued, (unsigned int) mQueued);
+    mWork.notify_one();
+
+    LS_LOG_DEBUG("task %s queued as %u", name, task.id);
+
+    return task.id;
+}
+
+bool WorkerPool::isRunning(unsigned int id) const {
+    return std::find(mRunning.begin(), mRunning.end(), id) != mRunning.end();
+}
+
+bool WorkerPool::cancel(unsigned int id, bool wait) {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    if (id == 0)
+        return false;
+
+    for (std::deque<Task> &queue : mQueues) {
+        for (auto it = queue.begin(); it != queue.end(); ++it) {
+            if (it->id != id)
+                continue;
+
+            Task task = *it;
+
+            queue.erase(it);
+            mQueued--;
+            mStats.cancelled++;
+            lock.unlock();
+
+            LS_LOG_INFO("task %s cancelled before it ran", task.name);
+
+            if (task.release)
+                task.release(task.data);
+
+            return true;
+        }
+    }
+
+    // waiting on itself would never return
+    if (wait && std::none_of(mThreads.begin(), mThreads.end(), [](const std::thread &thread) {
+            return thread.get_id() == std::this_thread::get_id();
+        })) {
+        mDone.wait(lock, [this, id]() { return !isRunning(id); });
+    }
+
+    return false;
+}
+
+void WorkerPool::stop() {
+    std::vector<Task> dropped;
+    std::vector<std::thread> threads;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+
+        if (mStopping)
+            return;
+
+        mStopping = true;
+
+        for (std::deque<Task> &queue : mQueues) {
+            dropped.insert(dropped.end(), queue.begin(), queue.end());
+            queue.clear();
+        }
+
+        mQueued = 0;
+        mStats.cancelled += dropped.size();
+        threads.swap(mThreads);
+        mWork.notify_all();
+    }
+
+    for (Task &task : dropped) {
+        if (task.release)
+            task.release(task.data);
+    }
+
+    for (std::thread &thread : threads) {
+        if (thread.get_id() == std::this_thread::get_id())
+            thread.detach();
+        else
+            thread.join();
+    }
+
+    LS_LOG_INFO("worker pool stopped, %zu queued tasks dropped", dropped.size());
+}
+
+void WorkerPool::run() {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    while (true) {
+        Task task;
+        int priority = 0;
+
+        mWork.wait(lock, [this]() { return mStopping || mQueued > 0; });
+
+        if (mStopping)
+            return;
+
+        while (mQueues[priority].empty())
+            priority++;
+
+        task = mQueues[priority].front();
+        mQueues[priority].pop_front();
+        mQueued--;
+        mRunning.push_back(task.id);
+        lock.unlock();
+
+        LS_LOG_DEBUG("running task %s (%u)", task.name, task.id);
+        task.func(task.data);
+
+        lock.lock();
+        mRunning.erase(std::remove(mRunning.begin(), mRunning.end(), task.id), mRunning.end());
+        mStats.completed++;
+        mDone.notify_all();
+    }
+}
+
+void WorkerPool::getStats(WorkerPoolStats *stats) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    *stats = mStats;
+    stats->threads = mThreads.size();
+    stats->maxThreads = mMaxThreads;
+    stats->busy = mRunning.size();
+    stats->queued = mQueued;
+    stats->queueLimit = mMaxQueued;
+}
+
+bool WorkerPool::appendStats(jvalue_ref parent) {
+    jvalue_ref object = jobject_create();
+    WorkerPoolStats stats;
+
+    if (jis_null(object))
+        return false;
+
+    getStats(&stats);
+
+    jobject_put(object, J_CSTR_TO_JVAL("threads"), jnumber_create_i64(stats.threads));
+    jobject_put(object, J_CSTR_TO_JVAL("maxThreads"), jnumber_create_i64(stats.maxThreads));
+    jobject_put(object, J_CSTR_TO_JVAL("busy"), jnumber_create_i64(stats.busy));
+    jobject_put(object, J_CSTR_TO_JVAL("queued"), jnumber_create_i64(stats.queued));
+    jobject_put(object, J_CSTR_TO_JVAL("maxQueued"), jnumber_create_i64(stats.maxQueued));
+    jobject_put(object, J_CSTR_TO_JVAL("queueLimit"), jnumber_create_i64(stats.queueLimit));
+    jobject_put(object, J_CSTR_TO_JVAL("submitted"), jnumber_create_i64(stats.submitted));
+    jobject_put(object, J_CSTR_TO_JVAL("completed"), jnumber_create_i64(stats.completed));
+    jobject_put(object, J_CSTR_TO_JVAL("cancelled"), jnumber_create_i64(stats.cancelled));
+    jobject_put(object, J_CSTR_TO_JVAL("rejected"), jnumber_create_i64(stats.rejected));
+    jobject_put(parent, J_CSTR_TO_JVAL("workerPool"), object);
+
+    return true;
+}
@@ -16,6 +16,7 @@
 
 
 #include <db_util.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 int get(DBHandle *handle, const char *keyVal, xmlChar **result) {
@@ -93,6 +94,40 @@ int commit(DBHandle *handle) {
   return SUCCESS;
 }
 
+int commitSync(DBHandle *handle, int syncToDisk, int *bytesWritten) {
+  int written;
+  int fd;
+  int ret = SUCCESS;
+
+  if (!handle || !handle->fileName || !handle->doc) {
+    return INIT_ERROR;
+  }
+
+  written = xmlSaveFormatFileEnc(handle->fileName, handle->doc, "UTF-8", 1);
+  xmlFreeDoc(handle->doc);
+  xmlCleanupParser();
+
+  if (written < 0)
+    return IO_ERROR;
+
+  if (bytesWritten)
+    *bytesWritten = written;
+
+  if (syncToDisk) {
+    fd = open(handle->fileName, O_RDONLY);
+
+    if (fd < 0)
+      return IO_ERROR;
+
+    if (fsync(fd) != 0)
+      ret = IO_ERROR;
+
+    close(fd);
+  }
+
+  return ret;
+}
+
 int isFileExists(const char *fname) {
      return (access(fname, F_OK) == 0);
 }
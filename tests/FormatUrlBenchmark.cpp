@@ -0,0 +1,209 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+// Timing harness for MapServicesImpl::formatUrl: a set of geocode and reverse
+// geocode queries is formatted by the former path (base64 decode of the key and
+// an HMAC-SHA1 signature per request) and by the current one (key decoded once
+// the way WSPConfigurationFileParser::parseFile does, URL appended into one
+// reserved string). Both must produce the same URLs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <glib.h>
+
+#define BENCH_QUERIES       1000
+#define BENCH_ROUNDS        20
+
+static const char geocodeUrl[] = "https://maps.googleapis.com/maps/api/geocode/json?";
+
+// what formatUrl did for every request before the key was decoded at load
+static std::string legacyFormatUrl(const std::string &geoData, const std::string &url, const char *key) {
+    guchar *decodedKey = NULL;
+    gsize size = 0;
+    gsize len;
+    GHmac *hmac = NULL;
+    gchar *encodedSignature = NULL;
+    guint8 *buffer = NULL;
+    std::string finalURL;
+    std::string encodedSignatureStr;
+    std::string urlToSign;
+    std::string subUrlToSign;
+    std::string stDecodeKey;
+    std::string tmpDecodeKey;
+    std::size_t pos;
+
+    pos = url.find(".com/");
+    if (pos == std::string::npos)
+        goto EXIT;
+
+    subUrlToSign = url.substr(pos + strlen(".com"));
+
+    decodedKey = g_base64_decode(key, &size);
+    if (NULL == decodedKey)
+        goto EXIT;
+
+    tmpDecodeKey = std::string(reinterpret_cast<const char *>(decodedKey));
+    stDecodeKey.assign(tmpDecodeKey, 0, size - 1);
+    urlToSign = subUrlToSign + geoData + "&key=" + stDecodeKey;
+
+    hmac = g_hmac_new(G_CHECKSUM_SHA1, decodedKey, size);
+    if (NULL == hmac)
+        goto EXIT;
+
+    g_hmac_update(hmac, (const unsigned char *) urlToSign.c_str(), -1);
+    buffer = (guint8 *) g_malloc(strlen(urlToSign.c_str()) + 1);
+
+    len = urlToSign.length();
+    g_hmac_get_digest(hmac, buffer, &len);
+
+    encodedSignature = g_base64_encode(buffer, len);
+    if (NULL == encodedSignature)
+        goto EXIT;
+
+    encodedSignatureStr = std::string((const char *) encodedSignature);
+    std::replace(encodedSignatureStr.begin(), encodedSignatureStr.end(), '/', '_');
+    std::replace(encodedSignatureStr.begin(), encodedSignatureStr.end(), '+', '-');
+
+    finalURL = url;
+    finalURL.append(geoData);
+    finalURL.append("&key=");
+    finalURL.append(stDecodeKey);
+
+    EXIT:
+    g_free(decodedKey);
+
+    if (hmac != NULL)
+        g_hmac_unref(hmac);
+
+    g_free(encodedSignature);
+    g_free(buffer);
+
+    return finalURL;
+}
+
+static std::string decodeKey(const char *apiKey) {
+    std::string decodedKey;
+    gsize size = 0;
+    guchar *decoded = g_base64_decode(apiKey, &size);
+
+    if (decoded && size > 1)
+        decodedKey.assign((const char *) decoded, strnlen((const char *) decoded, size - 1));
+
+    g_free(decoded);
+
+    return decodedKey;
+}
+
+static std::string currentFormatUrl(const std::string &geoData, const std::string &url, const std::string &key) {
+    std::string finalURL;
+
+    if (url.empty() || url.find(".com/") == std::string::npos || key.empty())
+        return finalURL;
+
+    finalURL.reserve(url.size() + geoData.size() + strlen("&key=") + key.size());
+    finalURL.append(url);
+    finalURL.append(geoData);
+    finalURL.append("&key=");
+    finalURL.append(key);
+
+    return finalURL;
+}
+
+// half forward queries with an address, half reverse queries with a position
+static std::vector<std::string> buildQueries() {
+    std::vector<std::string> queries;
+    gchar *query;
+
+    g_random_set_seed(48);
+
+    for (int i = 0; i < BENCH_QUERIES; i++) {
+        if (i % 2)
+            query = g_strdup_printf("latlng=%.6f,%.6f&language=en", g_random_double_range(-90, 90),
+                                    g_random_double_range(-180, 180));
+        else
+            query = g_strdup_printf("address=%d+Seocho-daero+Seocho-gu+Seoul&region=kr",
+                                    g_random_int_range(1, 2000));
+
+        queries.push_back(query);
+        g_free(query);
+    }
+
+    return queries;
+}
+
+int main() {
+    std::vector<std::string> queries = buildQueries();
+    std::vector<std::string> legacyUrls;
+    std::vector<std::string> currentUrls;
+    std::string url(geocodeUrl);
+    gchar *apiKey;
+    std::string decodedKey;
+    gint64 start;
+    gint64 legacyUs;
+    gint64 currentUs;
+    int formats = BENCH_QUERIES * BENCH_ROUNDS;
+    int mismatches = 0;
+
+    // the configuration stores the key base64 encoded with the encoder's line end
+    apiKey = g_base64_encode((const guchar *) "AIzaSyBenchmarkKey0123456789abcdefghij\n",
+                             strlen("AIzaSyBenchmarkKey0123456789abcdefghij\n"));
+
+    start = g_get_monotonic_time();
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        legacyUrls.clear();
+
+        for (const std::string &query : queries)
+            legacyUrls.push_back(legacyFormatUrl(query, url, apiKey));
+    }
+
+    legacyUs = g_get_monotonic_time() - start;
+    start = g_get_monotonic_time();
+
+    // the decode is paid once per configuration load, not per request
+    decodedKey = decodeKey(apiKey);
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        currentUrls.clear();
+
+        for (const std::string &query : queries)
+            currentUrls.push_back(currentFormatUrl(query, url, decodedKey));
+    }
+
+    currentUs = g_get_monotonic_time() - start;
+
+    for (size_t i = 0; i < queries.size(); i++) {
+        if (legacyUrls[i].empty() || legacyUrls[i] != currentUrls[i]) {
+            fprintf(stderr, "query %zu: legacy '%s', current '%s'\n", i, legacyUrls[i].c_str(),
+                    currentUrls[i].c_str());
+            mismatches++;
+        }
+    }
+
+    printf("%d queries, %d rounds\n", BENCH_QUERIES, BENCH_ROUNDS);
+    printf("decode and sign per request: %8.2f us/url\n", (double) legacyUs / formats);
+    printf("key decoded once:            %8.2f us/url\n", (double) currentUs / formats);
+
+    g_free(apiKey);
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
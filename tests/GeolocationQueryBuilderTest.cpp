@@ -0,0 +1,206 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+// Golden tests for GeolocationQueryBuilder: every query is built both the way
+// NetworkPositionProvider built it with pbnjson before the builder existed and
+// with the builder, from the same cell and access point data, and the two
+// strings must be identical. The literal queries below pin the exact bytes sent
+// to the backends. NetworkPositionProvider passes the access points of a scan
+// sorted by bssid, lowercased, and without the ones that do not parse.
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include <pbnjson.h>
+#include <GeolocationQueryBuilder.h>
+
+typedef std::vector<std::pair<std::string, int>> AccessPoints;
+
+static const char cellTowersJson[] =
+        "[{\"cellId\":21532831,\"locationAreaCode\":2862,\"mobileCountryCode\":214,"
+        "\"mobileNetworkCode\":7,\"age\":0,\"signalStrength\":-60,\"registered\":true},"
+        "{\"cellId\":21532832,\"locationAreaCode\":2862,\"mobileCountryCode\":214,"
+        "\"mobileNetworkCode\":7,\"registered\":false}]";
+
+static AccessPoints accessPoints() {
+    AccessPoints aps;
+
+    aps.push_back(std::make_pair("00:25:9c:cf:1c:ac", -43));
+    aps.push_back(std::make_pair("00:25:9c:cf:1c:ad", -55));
+    aps.push_back(std::make_pair("3c:a8:2a:0b:11:f0", -71));
+    aps.push_back(std::make_pair("f8:1a:67:2e:90:01", -92));
+    // never seen from the wifi service, but the escaping must match as well
+    aps.push_back(std::make_pair("ab\"cd\\ef\t01", 0));
+
+    return aps;
+}
+
+static const char cellQueryJson[] =
+        "{\"cellTowers\":[{\"cellId\":21532831,\"locationAreaCode\":2862,\"mobileCountryCode\":214,"
+        "\"mobileNetworkCode\":7,\"age\":0,\"signalStrength\":-60,\"registered\":true},"
+        "{\"cellId\":21532832,\"locationAreaCode\":2862,\"mobileCountryCode\":214,"
+        "\"mobileNetworkCode\":7,\"registered\":false}]}";
+
+static const char wifiQueryJson[] =
+        "{\"wifiAccessPoints\":["
+        "{\"macAddress\":\"00:25:9c:cf:1c:ac\",\"signalStrength\":-43},"
+        "{\"macAddress\":\"00:25:9c:cf:1c:ad\",\"signalStrength\":-55},"
+        "{\"macAddress\":\"3c:a8:2a:0b:11:f0\",\"signalStrength\":-71},"
+        "{\"macAddress\":\"f8:1a:67:2e:90:01\",\"signalStrength\":-92},"
+        "{\"macAddress\":\"ab\\\"cd\\\\ef\\t01\",\"signalStrength\":0}]}";
+
+static const char combinedQueryJson[] =
+        "{\"cellTowers\":[{\"cellId\":21532831,\"locationAreaCode\":2862,\"mobileCountryCode\":214,"
+        "\"mobileNetworkCode\":7,\"age\":0,\"signalStrength\":-60,\"registered\":true},"
+        "{\"cellId\":21532832,\"locationAreaCode\":2862,\"mobileCountryCode\":214,"
+        "\"mobileNetworkCode\":7,\"registered\":false}],"
+        "\"wifiAccessPoints\":["
+        "{\"macAddress\":\"00:25:9c:cf:1c:ac\",\"signalStrength\":-43},"
+        "{\"macAddress\":\"00:25:9c:cf:1c:ad\",\"signalStrength\":-55},"
+        "{\"macAddress\":\"3c:a8:2a:0b:11:f0\",\"signalStrength\":-71},"
+        "{\"macAddress\":\"f8:1a:67:2e:90:01\",\"signalStrength\":-92},"
+        "{\"macAddress\":\"ab\\\"cd\\\\ef\\t01\",\"signalStrength\":0}]}";
+
+class GeolocationQueryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        JSchemaInfo schemaInfo;
+
+        jschema_info_init(&schemaInfo, jschema_all(), NULL, NULL);
+        mCellTowers = jdom_parse(j_cstr_to_buffer(cellTowersJson), DOMOPT_NOOPT, &schemaInfo);
+        ASSERT_FALSE(jis_null(mCellTowers));
+    }
+
+    void TearDown() override {
+        if (!jis_null(mCellTowers))
+            j_release(&mCellTowers);
+    }
+
+    // the pbnjson query of parseCellData and parseWifiData before the builder
+    static std::string legacyQuery(jvalue_ref cellTowers, const AccessPoints *aps) {
+        jvalue_ref query = jobject_create();
+        std::string result;
+
+        if (!jis_null(cellTowers))
+            jobject_put(query, J_CSTR_TO_JVAL("cellTowers"), jvalue_duplicate(cellTowers));
+
+        if (aps) {
+            jvalue_ref wifiAccessPointsList = jarray_create(NULL);
+
+            for (const auto &ap : *aps) {
+                jvalue_ref item = jobject_create();
+
+                jobject_put(item, J_CSTR_TO_JVAL("macAddress"), jstring_create(ap.first.c_str()));
+                jobject_put(item, J_CSTR_TO_JVAL("signalStrength"), jnumber_create_i32(ap.second));
+                jarray_append(wifiAccessPointsList, item);
+            }
+
+            jobject_put(query, J_CSTR_TO_JVAL("wifiAccessPoints"), wifiAccessPointsList);
+        }
+
+        result = jvalue_tostring_simple(query);
+        j_release(&query);
+
+        return result;
+    }
+
+    static std::string builderQuery(GeolocationQueryBuilder &builder, jvalue_ref cellTowers,
+                                    const AccessPoints *aps) {
+        return rawBuilderQuery(builder, jis_null(cellTowers) ? NULL : jvalue_tostring_simple(cellTowers), aps);
+    }
+
+    // cellTowers is serialized JSON here, as the telephony service sends it
+    static std::string rawBuilderQuery(GeolocationQueryBuilder &builder, const char *cellTowers,
+                                       const AccessPoints *aps) {
+        builder.begin();
+
+        if (cellTowers)
+            builder.appendRawMember("cellTowers", cellTowers);
+
+        if (aps) {
+            builder.beginArray("wifiAccessPoints");
+
+            for (const auto &ap : *aps)
+                builder.appendAccessPoint(ap.first.c_str(), ap.second);
+
+            builder.endArray();
+        }
+
+        return builder.finish();
+    }
+
+    jvalue_ref mCellTowers;
+};
+
+TEST_F(GeolocationQueryTest, CellQueryMatchesPbnjson) {
+    GeolocationQueryBuilder builder;
+
+    EXPECT_EQ(legacyQuery(mCellTowers, NULL), builderQuery(builder, mCellTowers, NULL));
+}
+
+TEST_F(GeolocationQueryTest, WifiQueryMatchesPbnjson) {
+    GeolocationQueryBuilder builder;
+    AccessPoints aps = accessPoints();
+
+    EXPECT_EQ(legacyQuery(NULL, &aps), builderQuery(builder, NULL, &aps));
+}
+
+TEST_F(GeolocationQueryTest, CombinedQueryMatchesPbnjson) {
+    GeolocationQueryBuilder builder;
+    AccessPoints aps = accessPoints();
+
+    EXPECT_EQ(legacyQuery(mCellTowers, &aps), builderQuery(builder, mCellTowers, &aps));
+}
+
+TEST_F(GeolocationQueryTest, ReusedBufferMatchesPbnjson) {
+    GeolocationQueryBuilder builder;
+    AccessPoints aps = accessPoints();
+    AccessPoints fewer(aps.begin(), aps.begin() + 2);
+
+    // a long query followed by shorter ones must not leave anything behind
+    builderQuery(builder, mCellTowers, &aps);
+
+    EXPECT_EQ(legacyQuery(NULL, &fewer), builderQuery(builder, NULL, &fewer));
+    EXPECT_EQ(legacyQuery(mCellTowers, NULL), builderQuery(builder, mCellTowers, NULL));
+}
+
+TEST_F(GeolocationQueryTest, CellQueryMatchesGolden) {
+    GeolocationQueryBuilder builder;
+
+    EXPECT_EQ(cellQueryJson, rawBuilderQuery(builder, cellTowersJson, NULL));
+}
+
+TEST_F(GeolocationQueryTest, WifiQueryMatchesGolden) {
+    GeolocationQueryBuilder builder;
+    AccessPoints aps = accessPoints();
+
+    EXPECT_EQ(wifiQueryJson, rawBuilderQuery(builder, NULL, &aps));
+}
+
+TEST_F(GeolocationQueryTest, CombinedQueryMatchesGolden) {
+    GeolocationQueryBuilder builder;
+    AccessPoints aps = accessPoints();
+
+    EXPECT_EQ(combinedQueryJson, rawBuilderQuery(builder, cellTowersJson, &aps));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,173 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+// Timing harness for NetworkPositionProvider::parseHTTPResponse: a set of
+// geolocation replies in the shapes backends send (compact, pretty printed, with
+// extra members) is read through the former pbnjson DOM path and through
+// geolocationResponseExtract. Both must agree on every fix.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <glib.h>
+#include <pbnjson.h>
+#include <GeolocationResponseParser.h>
+
+#define BENCH_BODIES        300
+#define BENCH_ROUNDS        20
+
+typedef struct {
+    bool ok;
+    double latitude;
+    double longitude;
+    double accuracy;
+} ResponseFix;
+
+// what parseHTTPResponse did for every reply before the single pass scanner
+static ResponseFix legacyParse(const char *body) {
+    jschema_ref inputSchema = NULL;
+    jvalue_ref parsedObj = NULL;
+    jvalue_ref locObj = NULL;
+    jvalue_ref errorObj = NULL;
+    JSchemaInfo schemaInfo;
+    ResponseFix fix = {false, 0, 0, 0};
+
+    inputSchema = jschema_parse(j_cstr_to_buffer("{}"), DOMOPT_NOOPT, NULL);
+
+    if (!inputSchema)
+        return fix;
+
+    jschema_info_init(&schemaInfo, inputSchema, NULL, NULL);
+    parsedObj = jdom_parse(j_cstr_to_buffer(body), DOMOPT_NOOPT, &schemaInfo);
+    jschema_release(&inputSchema);
+
+    if (jis_null(parsedObj))
+        return fix;
+
+    if (!jobject_get_exists(parsedObj, J_CSTR_TO_BUF("error"), &errorObj)) {
+        jnumber_get_f64(jobject_get(parsedObj, J_CSTR_TO_BUF("accuracy")), &fix.accuracy);
+
+        locObj = jobject_get(parsedObj, J_CSTR_TO_BUF("location"));
+        jnumber_get_f64(jobject_get(locObj, J_CSTR_TO_BUF("lat")), &fix.latitude);
+        jnumber_get_f64(jobject_get(locObj, J_CSTR_TO_BUF("lng")), &fix.longitude);
+        fix.ok = true;
+    }
+
+    j_release(&parsedObj);
+
+    return fix;
+}
+
+static ResponseFix scannerParse(const char *body) {
+    ResponseFix fix = {false, 0, 0, 0};
+
+    fix.ok = geolocationResponseExtract(body, &fix.latitude, &fix.longitude, &fix.accuracy) == GEO_RESPONSE_OK;
+
+    return fix;
+}
+
+// a third of the replies each in the compact, pretty printed and decorated shapes
+static std::vector<std::string> buildBodies() {
+    std::vector<std::string> bodies;
+    gchar *body;
+
+    g_random_set_seed(33);
+
+    for (int i = 0; i < BENCH_BODIES; i++) {
+        double latitude = g_random_double_range(-90, 90);
+        double longitude = g_random_double_range(-180, 180);
+        double accuracy = g_random_double_range(5, 5000);
+
+        switch (i % 3) {
+            case 0:
+                body = g_strdup_printf("{\"location\":{\"lat\":%.7f,\"lng\":%.7f},\"accuracy\":%.1f}",
+                                       latitude, longitude, accuracy);
+                break;
+            case 1:
+                body = g_strdup_printf("{\n  \"location\": {\n    \"lat\": %.7f,\n    \"lng\": %.7f\n  },\n"
+                                       "  \"accuracy\": %.1f\n}\n", latitude, longitude, accuracy);
+                break;
+            default:
+                body = g_strdup_printf("{\"fallback\":\"ipCountry\",\"debug\":{\"cells\":[1,2,3],"
+                                       "\"note\":\"served \\\"stale\\\"\"},\"accuracy\":%.1f,"
+                                       "\"location\":{\"lng\":%.7f,\"lat\":%.7f}}",
+                                       accuracy, longitude, latitude);
+                break;
+        }
+
+        bodies.push_back(body);
+        g_free(body);
+    }
+
+    return bodies;
+}
+
+int main() {
+    std::vector<std::string> bodies = buildBodies();
+    std::vector<ResponseFix> legacyFixes;
+    std::vector<ResponseFix> scannerFixes;
+    gint64 start;
+    gint64 legacyUs;
+    gint64 scannerUs;
+    int parses = BENCH_BODIES * BENCH_ROUNDS;
+    int mismatches = 0;
+
+    legacyFixes.reserve(bodies.size());
+    scannerFixes.reserve(bodies.size());
+
+    start = g_get_monotonic_time();
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        legacyFixes.clear();
+
+        for (const std::string &body : bodies)
+            legacyFixes.push_back(legacyParse(body.c_str()));
+    }
+
+    legacyUs = g_get_monotonic_time() - start;
+    start = g_get_monotonic_time();
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        scannerFixes.clear();
+
+        for (const std::string &body : bodies)
+            scannerFixes.push_back(scannerParse(body.c_str()));
+    }
+
+    scannerUs = g_get_monotonic_time() - start;
+
+    for (size_t i = 0; i < bodies.size(); i++) {
+        if (!legacyFixes[i].ok || !scannerFixes[i].ok ||
+            legacyFixes[i].latitude != scannerFixes[i].latitude ||
+            legacyFixes[i].longitude != scannerFixes[i].longitude ||
+            legacyFixes[i].accuracy != scannerFixes[i].accuracy) {
+            fprintf(stderr, "body %zu: legacy %d %f,%f/%f, scanner %d %f,%f/%f\n", i,
+                    legacyFixes[i].ok, legacyFixes[i].latitude, legacyFixes[i].longitude, legacyFixes[i].accuracy,
+                    scannerFixes[i].ok, scannerFixes[i].latitude, scannerFixes[i].longitude,
+                    scannerFixes[i].accuracy);
+            mismatches++;
+        }
+    }
+
+    printf("%d replies, %d rounds\n", BENCH_BODIES, BENCH_ROUNDS);
+    printf("pbnjson DOM:      %8.2f us/reply\n", (double) legacyUs / parses);
+    printf("response scanner: %8.2f us/reply\n", (double) scannerUs / parses);
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+// geolocationResponseExtract against bodies a backend or a broken proxy may send:
+// a body it can not read in full must never come out as GEO_RESPONSE_OK, so that
+// NetworkPositionProvider hands it to the DOM parser instead of using it.
+
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+#include <gtest/gtest.h>
+#include <GeolocationResponseParser.h>
+
+#define FUZZ_ITERATIONS     20000
+
+static const char validBody[] =
+        "{\n  \"location\": {\n    \"lat\": 37.4219983,\n    \"lng\": -122.084\n  },\n  \"accuracy\": 13.5\n}\n";
+
+static GeoResponseResult extract(const std::string &body, double *latitude = NULL, double *longitude = NULL,
+                                 double *accuracy = NULL) {
+    double lat = 0;
+    double lng = 0;
+    double acc = 0;
+    GeoResponseResult result = geolocationResponseExtract(body.c_str(), &lat, &lng, &acc);
+
+    if (latitude)
+        *latitude = lat;
+
+    if (longitude)
+        *longitude = lng;
+
+    if (accuracy)
+        *accuracy = acc;
+
+    return result;
+}
+
+static std::string nested(int depth, const std::string &inner) {
+    std::string body;
+
+    for (int i = 0; i < depth; i++)
+        body += "{\"n\":";
+
+    body += inner;
+    body.append(depth, '}');
+
+    return body;
+}
+
+TEST(GeolocationResponseParserTest, ValidBody) {
+    double latitude, longitude, accuracy;
+
+    ASSERT_EQ(GEO_RESPONSE_OK, extract(validBody, &latitude, &longitude, &accuracy));
+    EXPECT_DOUBLE_EQ(37.4219983, latitude);
+    EXPECT_DOUBLE_EQ(-122.084, longitude);
+    EXPECT_DOUBLE_EQ(13.5, accuracy);
+}
+
+TEST(GeolocationResponseParserTest, ErrorBody) {
+    EXPECT_EQ(GEO_RESPONSE_ERROR_BODY,
+              extract("{\"error\":{\"code\":404,\"message\":\"Not Found\",\"errors\":[]}}"));
+}
+
+TEST(GeolocationResponseParserTest, TruncatedBodies) {
+    std::string body(validBody);
+
+    // every prefix up to the closing brace is cut inside the object
+    for (size_t len = 0; len < body.rfind('}') + 1; len++)
+        EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract(body.substr(0, len))) << "prefix of " << len << " bytes";
+}
+
+TEST(GeolocationResponseParserTest, TrailingGarbage) {
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract(std::string(validBody) + "}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract(std::string(validBody) + "{}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("<html><body>502 Bad Gateway</body></html>"));
+}
+
+TEST(GeolocationResponseParserTest, NestedValues) {
+    std::string location = "\"location\":{\"lat\":1.5,\"lng\":2.5},\"accuracy\":3";
+
+    // deep but bounded values beside the members we want are skipped
+    EXPECT_EQ(GEO_RESPONSE_OK, extract("{\"extra\":" + nested(20, "[[[1,{\"a\":[]}]]]") + "," + location + "}"));
+
+    // beyond the nesting limit the body is given up on, not recursed into
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"extra\":" + nested(100, "1") + "," + location + "}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract(std::string(100000, '[')));
+
+    // a location deeper than the top level is not the location
+    EXPECT_EQ(GEO_RESPONSE_INCOMPLETE, extract("{\"wrapper\":{" + location + "}}"));
+}
+
+TEST(GeolocationResponseParserTest, EscapedStrings) {
+    // escaped keys are left to the DOM parser, which decodes them
+    EXPECT_EQ(GEO_RESPONSE_INCOMPLETE,
+              extract("{\"location\":{\"l\\u0061t\":1,\"lng\":2},\"accuracy\":3}"));
+
+    EXPECT_EQ(GEO_RESPONSE_OK,
+              extract("{\"note\":\"a \\\"quoted\\\" \\\\ \\/ \\b\\f\\n\\r\\t \\u00e9\","
+                      "\"location\":{\"lat\":1,\"lng\":2},\"accuracy\":3}"));
+
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"note\":\"\\x41\",\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"note\":\"\\u12\",\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"note\":\"line\nbreak\",\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"note\":\"unterminated\\"));
+}
+
+TEST(GeolocationResponseParserTest, NonNumericFields) {
+    EXPECT_EQ(GEO_RESPONSE_INCOMPLETE, extract("{\"location\":{\"lat\":\"1.5\",\"lng\":2},\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_INCOMPLETE, extract("{\"location\":{\"lat\":null,\"lng\":2},\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_INCOMPLETE, extract("{\"location\":{\"lat\":1,\"lng\":[2]},\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_INCOMPLETE, extract("{\"location\":[1,2],\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_INCOMPLETE, extract("{\"location\":{\"lat\":1,\"lng\":2},\"accuracy\":true}"));
+
+    // not JSON numbers at all
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"location\":{\"lat\":01,\"lng\":2},\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"location\":{\"lat\":1.,\"lng\":2},\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"location\":{\"lat\":+1,\"lng\":2},\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"location\":{\"lat\":NaN,\"lng\":2},\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_MALFORMED, extract("{\"location\":{\"lat\":1e,\"lng\":2},\"accuracy\":3}"));
+}
+
+TEST(GeolocationResponseParserTest, HugeValues) {
+    std::string digits(400, '9');
+    std::string padding(1 << 20, ' ');
+    std::string array = "[";
+
+    // numbers strtod turns into infinity never make a fix
+    EXPECT_EQ(GEO_RESPONSE_INCOMPLETE, extract("{\"location\":{\"lat\":1e400,\"lng\":2},\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_INCOMPLETE,
+              extract("{\"location\":{\"lat\":1,\"lng\":2},\"accuracy\":" + digits + "}"));
+
+    // a long but finite mantissa is still a number
+    EXPECT_EQ(GEO_RESPONSE_OK, extract("{\"location\":{\"lat\":1." + digits + ",\"lng\":2},\"accuracy\":3}"));
+
+    for (int i = 0; i < 100000; i++)
+        array += i ? ",1.25" : "1.25";
+
+    array += "]";
+
+    EXPECT_EQ(GEO_RESPONSE_OK,
+              extract("{\"debug\":" + array + ",\"location\":{\"lat\":1,\"lng\":2},\"accuracy\":3}"));
+    EXPECT_EQ(GEO_RESPONSE_OK, extract(padding + validBody + padding));
+}
+
+TEST(GeolocationResponseParserTest, RandomMutations) {
+    std::string body(validBody);
+
+    srand(33);
+
+    // whatever a flipped byte turns the body into, a fix that comes out is a real one
+    for (int i = 0; i < FUZZ_ITERATIONS; i++) {
+        std::string mutated = body;
+        int flips = 1 + rand() % 4;
+        double latitude, longitude, accuracy;
+
+        for (int j = 0; j < flips; j++)
+            mutated[rand() % mutated.size()] = (char) (1 + rand() % 255);
+
+        if (extract(mutated, &latitude, &longitude, &accuracy) == GEO_RESPONSE_OK) {
+            EXPECT_TRUE(isfinite(latitude) && isfinite(longitude) && isfinite(accuracy)) << mutated;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
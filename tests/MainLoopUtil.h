@@ -0,0 +1,42 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#ifndef MAINLOOPUTIL_H_
+#define MAINLOOPUTIL_H_
+
+#include <functional>
+#include <glib.h>
+
+// runs the default main context until done() holds or timeoutMs passed,
+// returns whether done() holds
+static inline bool runMainLoopUntil(std::function<bool()> done, unsigned int timeoutMs) {
+    gint64 deadline = g_get_monotonic_time() + timeoutMs * 1000LL;
+
+    while (!done() && g_get_monotonic_time() < deadline) {
+        if (!g_main_context_iteration(NULL, FALSE))
+            g_usleep(1000);
+    }
+
+    return done();
+}
+
+static inline void runMainLoopFor(unsigned int ms) {
+    runMainLoopUntil([]() { return false; }, ms);
+}
+
+#endif /* MAINLOOPUTIL_H_ */
@@ -0,0 +1,252 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+// MapServicesImpl with many geocoding requests in flight against a local HTTP
+// server that echoes each query: every request must be answered once, through
+// its own callback and message, whether its answer came from its own transfer,
+// from a coalesced one, from the geocode caches or not at all once cancelled.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <vector>
+#include <gtest/gtest.h>
+#include <MapServicesImpl.h>
+#include <WSPConfigurationFileParser.h>
+#include "MainLoopUtil.h"
+#include "StubHttpServer.h"
+
+#define CONCURRENT_REQUESTS     100
+#define DISTINCT_QUERIES        16      // one transfer each, the rest coalesce; fits the geocoding queue
+#define ANSWER_DELAY_MS         20
+#define SLOW_ANSWER_MS          5000
+#define ANSWER_WAIT_MS          10000
+#define API_KEY_BASE64          "dGVzdGtleQo="  // "testkey\n"
+
+typedef struct _Answer {
+    int error;
+    std::string body;
+} Answer;
+
+class MapServicesConcurrencyTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(mServer.start([](const std::string &request) {
+            // "GET /maps.com/geocode?address=a&key=testkey HTTP/1.1" is answered with {"query":"address=a"}
+            size_t start = request.find('?') + 1;
+            size_t end = request.find("&key=");
+            std::string query = request.substr(start, end - start);
+            StubHttpResponse response = {200, "{\"status\":\"OK\",\"query\":\"" + query + "\"}", ANSWER_DELAY_MS};
+
+            if (query.find("slow") != std::string::npos)
+                response.delayMs = SLOW_ANSWER_MS;
+
+            return response;
+        }));
+
+        writeConfiguration();
+
+        mManager = NetworkRequestManager::getInstance();
+        mManager->init();
+        mMessages.resize(CONCURRENT_REQUESTS);
+        mImpl = new MapServicesImpl(mConfiguration);
+    }
+
+    void TearDown() override {
+        mManager->deInit();
+        delete mImpl;
+        delete mConfiguration;
+        unlink(mConfigurationPath);
+        mServer.stop();
+    }
+
+    // formatUrl takes only URLs with ".com/" in them, the path carries it
+    void writeConfiguration() {
+        FILE *file = NULL;
+        int fd = -1;
+
+        snprintf(mConfigurationPath, sizeof(mConfigurationPath), "/tmp/wspconfXXXXXX");
+        ASSERT_NE(-1, fd = mkstemp(mConfigurationPath));
+        ASSERT_TRUE(file = fdopen(fd, "w"));
+
+        fprintf(file, "{\"wpsName\":\"stub\",\"apiKey\":\"%s\",\"services\":["
+                      "{\"url\":\"%s\",\"features\":[\"geocode\"]},"
+                      "{\"url\":\"%s\",\"features\":[\"reverseGeocode\"]}]}",
+                API_KEY_BASE64, mServer.url("/maps.com/geocode?").c_str(),
+                mServer.url("/maps.com/reverse?").c_str());
+        fclose(file);
+
+        mConfiguration = new WSPConfigurationFileParser(mConfigurationPath);
+        ASSERT_EQ(WSP_CONF_SUCCESS, mConfiguration->parseFile());
+    }
+
+    LSMessage *message(unsigned int i) {
+        return reinterpret_cast<LSMessage *>(&mMessages[i]);
+    }
+
+    // even requests geocode, odd ones reverse geocode; test is part of the
+    // query, the caches outlive each test
+    std::string query(unsigned int i, const char *test) {
+        unsigned int q = (i / 2) % (DISTINCT_QUERIES / 2);
+
+        if (i % 2)
+            return "latlng=" + std::to_string(10 + q) + ".5," + std::to_string(20 + q) + ".5&test=" + test;
+
+        return "address=" + std::string(test) + "-" + std::to_string(q);
+    }
+
+    ErrorCodes send(unsigned int i, const std::string &query, unsigned int timeoutMs = GEOCODE_TIMEOUT_MS,
+                    bool isSync = false) {
+        LSMessage *msg = message(i);
+
+        if (query.compare(0, strlen("latlng="), "latlng=") == 0) {
+            GeoLocation location(query);
+
+            return mImpl->reverseGeoCode(location, [this](GeoAddress &address, int error, LSMessage *message) {
+                record(message, error, address.toString());
+            }, isSync, msg, timeoutMs);
+        }
+
+        GeoAddress address(query);
+
+        return mImpl->geoCode(address, [this](GeoLocation &location, int error, LSMessage *message) {
+            record(message, error, location.toString());
+        }, isSync, msg, timeoutMs);
+    }
+
+    void record(LSMessage *message, int error, const std::string &body) {
+        Answer answer = {error, body};
+
+        mAnswers[message].push_back(answer);
+        mAnswerCount++;
+    }
+
+    bool waitForAnswers(unsigned int count) {
+        return runMainLoopUntil([this, count]() { return mAnswerCount >= count; }, ANSWER_WAIT_MS);
+    }
+
+    // exactly one answer, and the one to its own query
+    void expectOwnAnswer(unsigned int i, const std::string &query) {
+        auto it = mAnswers.find(message(i));
+
+        ASSERT_NE(mAnswers.end(), it) << "request " << i << " was not answered";
+        ASSERT_EQ(1u, it->second.size()) << "request " << i << " was answered more than once";
+        EXPECT_EQ(ERROR_NONE, it->second[0].error);
+        EXPECT_NE(std::string::npos, it->second[0].body.find("\"query\":\"" + query + "\""))
+            << "request " << i << " got " << it->second[0].body;
+    }
+
+    StubHttpServer mServer;
+    NetworkRequestManager *mManager;
+    WSPConfigurationFileParser *mConfiguration;
+    char mConfigurationPath[64];
+    MapServicesImpl *mImpl;
+    std::vector<int> mMessages;
+    std::map<LSMessage *, std::vector<Answer>> mAnswers;
+    unsigned int mAnswerCount = 0;
+};
+
+// pooled tasks come back for later transfers, followers share the answer of their leader
+TEST_F(MapServicesConcurrencyTest, EveryRequestGetsItsOwnAnswer) {
+    for (unsigned int i = 0; i < CONCURRENT_REQUESTS; i++)
+        ASSERT_EQ(ERROR_NONE, send(i, query(i, "own")));
+
+    EXPECT_TRUE(waitForAnswers(CONCURRENT_REQUESTS));
+    runMainLoopFor(100);
+
+    for (unsigned int i = 0; i < CONCURRENT_REQUESTS; i++)
+        expectOwnAnswer(i, query(i, "own"));
+
+    EXPECT_EQ((unsigned int) CONCURRENT_REQUESTS, mAnswerCount);
+    EXPECT_EQ((unsigned int) DISTINCT_QUERIES, mServer.requests());
+}
+
+TEST_F(MapServicesConcurrencyTest, CachedAnswersGoToTheirOwnRequest) {
+    const unsigned int warm = DISTINCT_QUERIES;
+
+    for (unsigned int i = 0; i < warm; i++)
+        ASSERT_EQ(ERROR_NONE, send(i, query(i, "cached")));
+
+    ASSERT_TRUE(waitForAnswers(warm));
+    mAnswers.clear();
+    mAnswerCount = 0;
+
+    // answered from the geocode caches on the main loop, cancelled ones never
+    for (unsigned int i = 0; i < CONCURRENT_REQUESTS; i++)
+        ASSERT_EQ(ERROR_NONE, send(i, query(i, "cached")));
+
+    for (unsigned int i = 0; i < CONCURRENT_REQUESTS; i += 10)
+        EXPECT_TRUE(mImpl->cancelRequest(message(i)));
+
+    EXPECT_TRUE(waitForAnswers(CONCURRENT_REQUESTS - CONCURRENT_REQUESTS / 10));
+    runMainLoopFor(100);
+
+    for (unsigned int i = 0; i < CONCURRENT_REQUESTS; i++) {
+        if (i % 10 == 0)
+            EXPECT_EQ(0u, mAnswers.count(message(i))) << "cancelled request " << i << " was answered";
+        else
+            expectOwnAnswer(i, query(i, "cached"));
+    }
+
+    EXPECT_EQ(warm, mServer.requests());
+}
+
+// a leader whose own request is cancelled still serves its followers
+TEST_F(MapServicesConcurrencyTest, CancelledRequestsAreNeverAnswered) {
+    for (unsigned int i = 0; i < CONCURRENT_REQUESTS; i++)
+        ASSERT_EQ(ERROR_NONE, send(i, query(i, "cancel")));
+
+    for (unsigned int i = 0; i < CONCURRENT_REQUESTS; i += 3)
+        EXPECT_TRUE(mImpl->cancelRequest(message(i)));
+
+    EXPECT_FALSE(mImpl->cancelRequest(message(0)));
+    EXPECT_TRUE(waitForAnswers(CONCURRENT_REQUESTS - (CONCURRENT_REQUESTS + 2) / 3));
+    runMainLoopFor(100);
+
+    for (unsigned int i = 0; i < CONCURRENT_REQUESTS; i++) {
+        if (i % 3 == 0)
+            EXPECT_EQ(0u, mAnswers.count(message(i))) << "cancelled request " << i << " was answered";
+        else
+            expectOwnAnswer(i, query(i, "cancel"));
+    }
+}
+
+TEST_F(MapServicesConcurrencyTest, TimeoutIsReportedToItsRequestOnly) {
+    ASSERT_EQ(ERROR_NONE, send(0, "address=slow", 300));
+    ASSERT_EQ(ERROR_NONE, send(1, "address=fast"));
+
+    EXPECT_TRUE(waitForAnswers(2));
+    expectOwnAnswer(1, "address=fast");
+
+    ASSERT_EQ(1u, mAnswers[message(0)].size());
+    EXPECT_EQ(ERROR_TIMEOUT, mAnswers[message(0)][0].error);
+    EXPECT_TRUE(mServer.waitForAbandoned(1, 1000));
+}
+
+// answered inside initiateTransaction, before there is a task to key it by
+TEST_F(MapServicesConcurrencyTest, SyncRequestIsAnsweredInline) {
+    ASSERT_EQ(ERROR_NONE, send(0, "address=sync", GEOCODE_TIMEOUT_MS, true));
+
+    expectOwnAnswer(0, "address=sync");
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,207 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+// NetworkRequestManager against a local slow HTTP server: a cancelled or expired
+// transfer has to close its connection at once and never reach its client, and
+// deInit must not leave a timer behind that could. Against a keep-alive HTTPS
+// server, requests to one host have to share its connection.
+
+#include <stdlib.h>
+#include <vector>
+#include <gtest/gtest.h>
+#include <NetworkRequestManager.h>
+#include "MainLoopUtil.h"
+#include "StubHttpServer.h"
+
+#define SLOW_RESPONSE_MS    5000
+#define SEQUENTIAL_REQUESTS 5
+
+class RecordingClient : public HttpInterface {
+public:
+    void handleResponse(HttpReqTask *task) override {
+        responses.push_back(task->curlDesc.httpResponseCode);
+        NetworkRequestManager::getInstance()->clearTransaction(task);
+    }
+
+    void handleTimeout(HttpReqTask *task) override {
+        timeouts++;
+        NetworkRequestManager::getInstance()->clearTransaction(task);
+    }
+
+    std::vector<long> responses;
+    unsigned int timeouts = 0;
+};
+
+class NetworkRequestManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(mServer.start([](const std::string &request) {
+            StubHttpResponse response = {200, "{}", 0};
+
+            if (request.find("/slow") != std::string::npos)
+                response.delayMs = SLOW_RESPONSE_MS;
+
+            return response;
+        }));
+
+        mManager = NetworkRequestManager::getInstance();
+        mManager->init();
+    }
+
+    void TearDown() override {
+        mManager->deInit();
+        mServer.stop();
+    }
+
+    ErrorCodes send(const char *path, RecordingClient *client, unsigned int timeoutMs, unsigned int maxRetries,
+                    HttpReqTask **task) {
+        HttpRequestOptions options = {timeoutMs, maxRetries, 0, HTTP_PRIORITY_FOREGROUND_POSITION};
+
+        return mManager->initiateTransaction(NULL, 0, mServer.url(path), false, NULL, client, NULL, task, &options);
+    }
+
+    unsigned int activeTransfers() {
+        std::vector<HttpPriorityStats> stats;
+        unsigned int active = 0;
+
+        mManager->getPriorityStats(stats);
+
+        for (const HttpPriorityStats &entry : stats)
+            active += entry.active;
+
+        return active;
+    }
+
+    StubHttpServer mServer;
+    NetworkRequestManager *mManager;
+};
+
+TEST_F(NetworkRequestManagerTest, FastRequestIsAnswered) {
+    RecordingClient client;
+    HttpReqTask *task = NULL;
+
+    ASSERT_EQ(ERROR_NONE, send("/fast", &client, 0, 0, &task));
+    ASSERT_TRUE(runMainLoopUntil([&client]() { return !client.responses.empty(); }, 2000));
+
+    EXPECT_EQ(HTTP_STATUS_CODE_SUCCESS, client.responses[0]);
+    EXPECT_EQ(0u, activeTransfers());
+}
+
+TEST_F(NetworkRequestManagerTest, CancelledRequestClosesItsConnection) {
+    RecordingClient client;
+    HttpReqTask *task = NULL;
+
+    ASSERT_EQ(ERROR_NONE, send("/slow", &client, 0, 0, &task));
+    ASSERT_TRUE(runMainLoopUntil([this]() { return mServer.requests() == 1; }, 2000));
+    ASSERT_EQ(1u, activeTransfers());
+
+    EXPECT_EQ(1, mManager->cancelTransactions(&client));
+    EXPECT_EQ(0u, activeTransfers());
+
+    // the server sees the connection go away long before it would have answered
+    EXPECT_TRUE(mServer.waitForAbandoned(1, 1000));
+
+    runMainLoopFor(200);
+    EXPECT_TRUE(client.responses.empty());
+    EXPECT_EQ(0u, client.timeouts);
+    EXPECT_FALSE(mManager->cancelTransaction(task));
+}
+
+TEST_F(NetworkRequestManagerTest, CancelTransactionsOnlyTouchesItsOwner) {
+    RecordingClient cancelled;
+    RecordingClient kept;
+
+    ASSERT_EQ(ERROR_NONE, send("/slow?a", &cancelled, 0, 0, NULL));
+    ASSERT_EQ(ERROR_NONE, send("/fast?b", &kept, 0, 0, NULL));
+
+    EXPECT_EQ(1, mManager->cancelTransactions(&cancelled));
+    ASSERT_TRUE(runMainLoopUntil([&kept]() { return !kept.responses.empty(); }, 2000));
+
+    EXPECT_TRUE(cancelled.responses.empty());
+    EXPECT_EQ(HTTP_STATUS_CODE_SUCCESS, kept.responses[0]);
+}
+
+TEST_F(NetworkRequestManagerTest, DeadlineStopsSlowTransfer) {
+    RecordingClient client;
+    gint64 start = g_get_monotonic_time();
+
+    ASSERT_EQ(ERROR_NONE, send("/slow", &client, 300, 0, NULL));
+    ASSERT_TRUE(runMainLoopUntil([&client]() { return client.timeouts == 1; }, 2000));
+
+    EXPECT_LT(g_get_monotonic_time() - start, 1000 * 1000);
+    EXPECT_TRUE(client.responses.empty());
+    EXPECT_EQ(0u, activeTransfers());
+    EXPECT_TRUE(mServer.waitForAbandoned(1, 1000));
+}
+
+TEST_F(NetworkRequestManagerTest, DeInitDropsPendingTransactions) {
+    RecordingClient client;
+
+    ASSERT_EQ(ERROR_NONE, send("/slow", &client, 300, 2, NULL));
+    ASSERT_TRUE(runMainLoopUntil([this]() { return mServer.requests() == 1; }, 2000));
+
+    mManager->deInit();
+    EXPECT_TRUE(mServer.waitForAbandoned(1, 1000));
+
+    // past the deadline, the client must not hear of the request any more
+    runMainLoopFor(600);
+    EXPECT_TRUE(client.responses.empty());
+    EXPECT_EQ(0u, client.timeouts);
+    EXPECT_EQ(0u, activeTransfers());
+
+    mManager->init();
+}
+
+TEST_F(NetworkRequestManagerTest, SequentialRequestsShareTlsConnection) {
+    StubHttpServer tlsServer;
+    HttpConnectionPoolStats before;
+    HttpConnectionPoolStats after;
+
+    ASSERT_TRUE(tlsServer.startTls([](const std::string &) {
+        StubHttpResponse response = {200, "{}", 0};
+
+        return response;
+    }));
+
+    // curl trusts the stub's own certificate through OpenSSL's default verify path
+    setenv("SSL_CERT_FILE", tlsServer.certificateFile().c_str(), 1);
+    mManager->getConnectionStats(&before);
+
+    for (int i = 0; i < SEQUENTIAL_REQUESTS; i++) {
+        RecordingClient client;
+        HttpRequestOptions options = {0, 0, 0, HTTP_PRIORITY_FOREGROUND_POSITION};
+        std::string url = tlsServer.url("/geolocate?n=" + std::to_string(i));
+
+        ASSERT_EQ(ERROR_NONE, mManager->initiateTransaction(NULL, 0, url, false, NULL, &client, NULL, NULL, &options));
+        ASSERT_TRUE(runMainLoopUntil([&client]() { return !client.responses.empty(); }, 2000));
+        ASSERT_EQ(HTTP_STATUS_CODE_SUCCESS, client.responses[0]);
+    }
+
+    EXPECT_EQ((unsigned int) SEQUENTIAL_REQUESTS, tlsServer.requests());
+    EXPECT_LT(tlsServer.connections(), (unsigned int) SEQUENTIAL_REQUESTS);
+
+    // the pool hands the one task back, curl keeps its connection
+    mManager->getConnectionStats(&after);
+    EXPECT_EQ(1u, after.newTasks - before.newTasks);
+    EXPECT_EQ((uint64_t) SEQUENTIAL_REQUESTS - 1, after.reused - before.reused);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,286 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+// The hedge of NetworkPositionProvider against two local backends: the primary's
+// p95, learned from its own answers, decides when a query is also sent to the
+// secondary. Only the time an attempt spent on the wire counts towards the p95,
+// not the time it waited offline or for a retry. The client below settles a
+// race the way NetworkPositionProvider::settleBackendQuery does.
+
+#include <stdio.h>
+#include <unistd.h>
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+#include <NetworkRequestManager.h>
+#include <PositioningBackends.h>
+#include "MainLoopUtil.h"
+#include "StubHttpServer.h"
+
+#define TRAINING_QUERIES    POSITIONING_BACKEND_LATENCY_SAMPLES
+#define FAST_ANSWER_MS      30
+#define SLOW_ANSWER_MS      2000
+#define OFFLINE_MS          800
+#define ANSWER_WAIT_MS      5000
+#define QUERY_BODY          "{\"considerIp\":false,\"wifiAccessPoints\":[]}"
+#define FIX_BODY            "{\"location\":{\"lat\":37.5,\"lng\":127.0},\"accuracy\":20}"
+
+class HedgeClient : public HttpInterface {
+public:
+    explicit HedgeClient(PositioningBackends &backends) : mBackends(backends) {}
+
+    void handleResponse(HttpReqTask *task) override {
+        NetworkRequestManager *manager = NetworkRequestManager::getInstance();
+        bool success = (HTTP_STATUS_CODE_SUCCESS == task->curlDesc.httpResponseCode);
+        size_t backend = 0;
+
+        for (size_t i = 0; i < sent.size(); i++) {
+            if (sent[i] == task)
+                backend = i == 0 ? 0 : 1;
+        }
+
+        lastLatencyMs = manager->getAttemptLatencyMs(task);
+        mBackends.recordResult(backend, success, lastLatencyMs);
+
+        if (success && winner < 0) {
+            winner = (int) backend;
+
+            if (sent.size() > 1)
+                mBackends.recordWin(backend);
+        }
+
+        manager->clearTransaction(task);
+    }
+
+    void handleTimeout(HttpReqTask *task) override {
+        NetworkRequestManager::getInstance()->clearTransaction(task);
+    }
+
+    std::vector<HttpReqTask *> sent;
+    int winner = -1;
+    int64_t lastLatencyMs = -1;
+
+private:
+    PositioningBackends &mBackends;
+};
+
+class PositioningHedgeTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        mPrimaryDelayMs = FAST_ANSWER_MS;
+        mPrimaryFailures = 0;
+
+        ASSERT_TRUE(mPrimary.start([this](const std::string &) {
+            StubHttpResponse response = {200, FIX_BODY, mPrimaryDelayMs};
+
+            if (mPrimaryFailures > 0) {
+                mPrimaryFailures--;
+                response.status = 503;
+                response.delayMs = 0;
+            }
+
+            return response;
+        }));
+
+        ASSERT_TRUE(mSecondary.start([](const std::string &) {
+            StubHttpResponse response = {200, FIX_BODY, FAST_ANSWER_MS};
+
+            return response;
+        }));
+
+        writeBackends();
+        ASSERT_TRUE(mBackends.load(mBackendsPath));
+        ASSERT_EQ(2u, mBackends.size());
+
+        mManager = NetworkRequestManager::getInstance();
+        mManager->init();
+    }
+
+    void TearDown() override {
+        mManager->setOnline(true);
+        mManager->deInit();
+        unlink(mBackendsPath);
+        mPrimary.stop();
+        mSecondary.stop();
+    }
+
+    void writeBackends() {
+        FILE *file;
+        int fd;
+
+        snprintf(mBackendsPath, sizeof(mBackendsPath), "/tmp/positioning-backends-XXXXXX");
+        fd = mkstemp(mBackendsPath);
+        ASSERT_GE(fd, 0);
+        close(fd);
+
+        file = fopen(mBackendsPath, "w");
+        ASSERT_TRUE(file != NULL);
+        fprintf(file, "{ \"backends\": [ { \"name\": \"secondary\", \"url\": \"%s\", \"apiKey\": \"test\" } ] }",
+                mSecondary.url("/geolocate?key=").c_str());
+        fclose(file);
+    }
+
+    bool send(size_t backend, HedgeClient &client, unsigned int maxRetries) {
+        HttpRequestOptions options = {ANSWER_WAIT_MS, maxRetries, 0, HTTP_PRIORITY_FOREGROUND_POSITION};
+        std::string url = backend == 0 ? mPrimary.url("/geolocate?key=test") : mBackends.getUrl(backend);
+        HttpReqTask *task = NULL;
+
+        mBackends.recordRequest(backend, backend != 0);
+
+        if (ERROR_NONE != mManager->initiateTransaction(NULL, 0, url, false, NULL, &client,
+                                                        const_cast<char *>(QUERY_BODY), &task, &options))
+            return false;
+
+        client.sent.push_back(task);
+        return true;
+    }
+
+    // the primary goes first, the secondary once the primary is past its hedge delay
+    int hedgedQuery(HedgeClient &client) {
+        struct Hedge {
+            PositioningHedgeTest *test;
+            HedgeClient *client;
+        } hedge = {this, &client};
+        guint timerId;
+
+        if (!send(0, client, 0))
+            return -1;
+
+        timerId = g_timeout_add(mBackends.getHedgeDelayMs(0), [](gpointer data) -> gboolean {
+            Hedge *hedge = static_cast<Hedge *>(data);
+
+            if (hedge->client->winner < 0)
+                hedge->test->send(1, *hedge->client, 0);
+
+            return G_SOURCE_REMOVE;
+        }, &hedge);
+
+        runMainLoopUntil([&client]() { return client.winner >= 0; }, ANSWER_WAIT_MS);
+
+        if (client.winner >= 0 && client.sent.size() == 1)
+            g_source_remove(timerId);
+
+        mManager->cancelTransactions(&client);
+
+        return client.winner;
+    }
+
+    void train() {
+        for (int i = 0; i < TRAINING_QUERIES; i++) {
+            HedgeClient client(mBackends);
+
+            ASSERT_TRUE(send(0, client, 0));
+            ASSERT_TRUE(runMainLoopUntil([&client]() { return client.winner >= 0; }, ANSWER_WAIT_MS));
+        }
+    }
+
+    int64_t primaryP95() {
+        std::vector<PositioningBackendStats> stats;
+
+        mBackends.getStats(stats);
+
+        return stats[0].p95LatencyMs;
+    }
+
+    StubHttpServer mPrimary;
+    StubHttpServer mSecondary;
+    std::atomic<unsigned int> mPrimaryDelayMs;
+    std::atomic<int> mPrimaryFailures;
+    PositioningBackends mBackends;
+    NetworkRequestManager *mManager;
+    char mBackendsPath[64];
+};
+
+TEST_F(PositioningHedgeTest, PrimaryWithinP95Wins) {
+    HedgeClient client(mBackends);
+
+    train();
+
+    // a delay learned from answers, well below the default of an untrained backend
+    EXPECT_GE(primaryP95(), FAST_ANSWER_MS);
+    EXPECT_LT(mBackends.getHedgeDelayMs(0), SLOW_ANSWER_MS / 2);
+
+    EXPECT_EQ(0, hedgedQuery(client));
+    EXPECT_EQ(1u, client.sent.size());
+    EXPECT_EQ(0u, mSecondary.requests());
+}
+
+TEST_F(PositioningHedgeTest, SlowPrimaryLosesToSecondary) {
+    HedgeClient client(mBackends);
+    std::vector<PositioningBackendStats> stats;
+    gint64 start;
+
+    train();
+
+    mPrimaryDelayMs = SLOW_ANSWER_MS;
+    start = g_get_monotonic_time();
+
+    EXPECT_EQ(1, hedgedQuery(client));
+    EXPECT_LT(g_get_monotonic_time() - start, SLOW_ANSWER_MS * 1000LL / 2);
+    EXPECT_EQ(2u, client.sent.size());
+    EXPECT_EQ(1u, mSecondary.requests());
+
+    // the slow primary was cancelled, it left no sample behind
+    mBackends.getStats(stats);
+    EXPECT_EQ(1u, stats[1].wins);
+    EXPECT_EQ(1u, stats[1].hedgedRequests);
+    EXPECT_EQ((uint64_t) TRAINING_QUERIES, stats[0].successes);
+    EXPECT_TRUE(mPrimary.waitForAbandoned(1, 1000));
+}
+
+TEST_F(PositioningHedgeTest, OfflineWaitIsNotLatency) {
+    HedgeClient client(mBackends);
+    gint64 start = g_get_monotonic_time();
+
+    mManager->setOnline(false);
+    ASSERT_TRUE(send(0, client, 0));
+
+    runMainLoopFor(OFFLINE_MS);
+    EXPECT_EQ(0u, mPrimary.requests());
+    mManager->setOnline(true);
+
+    ASSERT_TRUE(runMainLoopUntil([&client]() { return client.winner >= 0; }, ANSWER_WAIT_MS));
+    EXPECT_GE(g_get_monotonic_time() - start, OFFLINE_MS * 1000LL);
+
+    EXPECT_GE(client.lastLatencyMs, FAST_ANSWER_MS);
+    EXPECT_LT(client.lastLatencyMs, OFFLINE_MS / 2);
+    EXPECT_LT(primaryP95(), OFFLINE_MS / 2);
+}
+
+TEST_F(PositioningHedgeTest, RetryBackoffIsNotLatency) {
+    HedgeClient client(mBackends);
+    gint64 start = g_get_monotonic_time();
+
+    // the first attempt is refused, the retry after its backoff answers
+    mPrimaryFailures = 1;
+    ASSERT_TRUE(send(0, client, 1));
+
+    ASSERT_TRUE(runMainLoopUntil([&client]() { return client.winner >= 0; }, ANSWER_WAIT_MS));
+    EXPECT_EQ(2u, mPrimary.requests());
+
+    int64_t totalMs = (g_get_monotonic_time() - start) / 1000;
+
+    EXPECT_GE(client.lastLatencyMs, FAST_ANSWER_MS);
+    EXPECT_LT(client.lastLatencyMs, totalMs - FAST_ANSWER_MS);
+    EXPECT_LT(primaryP95(), totalMs - FAST_ANSWER_MS);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
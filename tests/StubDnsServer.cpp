@@ -0,0 +1,196 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <chrono>
+#include "StubDnsServer.h"
+
+#define STUB_POLL_SLICE_MS      50
+#define STUB_DNS_HEADER_BYTES   12
+#define STUB_DNS_MAX_BYTES      512
+#define STUB_DNS_RCODE_SERVFAIL 2
+#define STUB_DNS_RCODE_NXDOMAIN 3
+
+StubDnsServer::StubDnsServer()
+    : mFd(-1),
+      mStopping(false) {
+    memset(&mAddress, 0, sizeof(mAddress));
+}
+
+StubDnsServer::~StubDnsServer() {
+    stop();
+}
+
+bool StubDnsServer::start() {
+    socklen_t length = sizeof(mAddress);
+
+    mFd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (mFd < 0)
+        return false;
+
+    mAddress.sin_family = AF_INET;
+    mAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    mAddress.sin_port = 0;
+
+    if (bind(mFd, (struct sockaddr *) &mAddress, sizeof(mAddress)) < 0 ||
+        getsockname(mFd, (struct sockaddr *) &mAddress, &length) < 0) {
+        close(mFd);
+        mFd = -1;
+        return false;
+    }
+
+    mStopping = false;
+    mReceiveThread = std::thread(&StubDnsServer::receiveLoop, this);
+
+    return true;
+}
+
+void StubDnsServer::stop() {
+    if (mFd < 0)
+        return;
+
+    mStopping = true;
+
+    if (mReceiveThread.joinable())
+        mReceiveThread.join();
+
+    for (std::thread &answer : mAnswers) {
+        if (answer.joinable())
+            answer.join();
+    }
+
+    mAnswers.clear();
+    close(mFd);
+    mFd = -1;
+}
+
+void StubDnsServer::setRecord(const std::string &name, const StubDnsRecord &record) {
+    std::lock_guard<std::mutex> lock(mLock);
+
+    mRecords[name] = record;
+}
+
+unsigned int StubDnsServer::queries(const std::string &name) {
+    std::lock_guard<std::mutex> lock(mLock);
+    auto it = mQueries.find(name);
+
+    return it == mQueries.end() ? 0 : it->second;
+}
+
+void StubDnsServer::receiveLoop() {
+    while (!mStopping) {
+        struct pollfd pfd = {mFd, POLLIN, 0};
+        unsigned char buffer[STUB_DNS_MAX_BYTES];
+        struct sockaddr_in client;
+        socklen_t length = sizeof(client);
+
+        if (poll(&pfd, 1, STUB_POLL_SLICE_MS) <= 0)
+            continue;
+
+        ssize_t received = recvfrom(mFd, buffer, sizeof(buffer), 0, (struct sockaddr *) &client, &length);
+
+        if (received <= STUB_DNS_HEADER_BYTES)
+            continue;
+
+        mAnswers.push_back(std::thread(&StubDnsServer::answer, this,
+                                       std::vector<unsigned char>(buffer, buffer + received), client));
+    }
+}
+
+// the question is echoed, followed by one A record per address
+void StubDnsServer::answer(std::vector<unsigned char> query, struct sockaddr_in client) {
+    std::vector<unsigned char> response;
+    std::string name;
+    size_t pos = STUB_DNS_HEADER_BYTES;
+    StubDnsRecord record;
+    unsigned int rcode = 0;
+    bool known = false;
+
+    while (pos < query.size() && query[pos] != 0) {
+        size_t label = query[pos++];
+
+        if (pos + label > query.size())
+            return;
+
+        if (!name.empty())
+            name += '.';
+
+        name.append((const char *) &query[pos], label);
+        pos += label;
+    }
+
+    // terminating zero, type and class
+    pos += 5;
+
+    if (pos > query.size())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = mRecords.find(name);
+
+        mQueries[name]++;
+
+        if ((known = (it != mRecords.end())))
+            record = it->second;
+    }
+
+    if (known && record.delayMs) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(record.delayMs);
+
+        while (!mStopping && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::milliseconds(STUB_POLL_SLICE_MS / 5));
+    }
+
+    if (known && record.serverFailure)
+        rcode = STUB_DNS_RCODE_SERVFAIL;
+    else if (!known || record.addresses.empty())
+        rcode = STUB_DNS_RCODE_NXDOMAIN;
+
+    unsigned int count = rcode ? 0 : record.addresses.size();
+
+    response.assign(query.begin(), query.begin() + pos);
+    response[2] = 0x80 | (query[2] & 0x01);     // QR, RD copied
+    response[3] = 0x80 | rcode;                 // RA
+    response[6] = 0;
+    response[7] = count;
+    response[8] = response[9] = response[10] = response[11] = 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        struct in_addr address;
+        const unsigned char rr[] = {
+            0xc0, STUB_DNS_HEADER_BYTES,        // name, pointer to the question
+            0, 1, 0, 1,                         // A, IN
+            (unsigned char) (record.ttl >> 24), (unsigned char) (record.ttl >> 16),
+            (unsigned char) (record.ttl >> 8), (unsigned char) record.ttl,
+            0, 4
+        };
+
+        inet_pton(AF_INET, record.addresses[i].c_str(), &address);
+        response.insert(response.end(), rr, rr + sizeof(rr));
+        response.insert(response.end(), (unsigned char *) &address, (unsigned char *) &address + 4);
+    }
+
+    sendto(mFd, response.data(), response.size(), 0, (struct sockaddr *) &client, sizeof(client));
+}
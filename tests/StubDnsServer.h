@@ -0,0 +1,77 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+
+#ifndef STUBDNSSERVER_H_
+#define STUBDNSSERVER_H_
+
+#include <stdint.h>
+#include <netinet/in.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef struct _StubDnsRecord {
+    std::vector<std::string> addresses;     // dotted quads, empty answers NXDOMAIN
+    uint32_t ttl;
+    unsigned int delayMs;                   // before the answer is sent
+    bool serverFailure;                     // SERVFAIL instead of an answer
+} StubDnsRecord;
+
+// DNS server on an ephemeral loopback UDP port for the resolver tests. It
+// answers A queries of the names it was given, every query on its own thread
+// so delayed answers overlap, and counts the queries per name.
+class StubDnsServer {
+public:
+    StubDnsServer();
+
+    ~StubDnsServer();
+
+    StubDnsServer(const StubDnsServer &) = delete;
+
+    StubDnsServer &operator=(const StubDnsServer &) = delete;
+
+    bool start();
+
+    void stop();
+
+    void setRecord(const std::string &name, const StubDnsRecord &record);
+
+    const struct sockaddr_in &address() const { return mAddress; }
+
+    unsigned int queries(const std::string &name);
+
+private:
+    void receiveLoop();
+
+    void answer(std::vector<unsigned char> query, struct sockaddr_in client);
+
+    int mFd;
+    struct sockaddr_in mAddress;
+    std::atomic<bool> mStopping;
+    std::thread mReceiveThread;
+    std::vector<std::thread> mAnswers;
+    std::mutex mLock;
+    std::map<std::string, StubDnsRecord> mRecords;
+    std::map<std::string, unsigned int> mQueries;
+};
+
+#endif /* STUBDNSSERVER_H_ */
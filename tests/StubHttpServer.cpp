@@ -0,0 +1,338 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include "StubHttpServer.h"
+
+#define STUB_POLL_SLICE_MS      50
+#define STUB_REQUEST_MAX_BYTES  65536
+#define STUB_CERTIFICATE_DAYS   1
+
+StubHttpServer::StubHttpServer()
+    : mListenFd(-1),
+      mPort(0),
+      mTls(NULL),
+      mStopping(false),
+      mAccepted(0),
+      mRequests(0),
+      mAnswered(0),
+      mAbandoned(0),
+      mOpen(0),
+      mMaxConcurrent(0) {
+}
+
+StubHttpServer::~StubHttpServer() {
+    stop();
+
+    if (mTls)
+        SSL_CTX_free(mTls);
+
+    if (!mCertificateFile.empty())
+        unlink(mCertificateFile.c_str());
+}
+
+// a self-signed P-256 certificate for 127.0.0.1, written out for the clients to trust
+bool StubHttpServer::createTlsContext() {
+    EVP_PKEY_CTX *keyContext = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+    EVP_PKEY *key = NULL;
+    X509 *certificate = X509_new();
+    X509_EXTENSION *altName = NULL;
+    char path[] = "/tmp/stub-https-XXXXXX";
+    FILE *file = NULL;
+    int fd = -1;
+    bool created = false;
+
+    if (!keyContext || !certificate || EVP_PKEY_keygen_init(keyContext) <= 0 ||
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyContext, NID_X9_62_prime256v1) <= 0 ||
+        EVP_PKEY_keygen(keyContext, &key) <= 0)
+        goto EXIT;
+
+    X509_set_version(certificate, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+    X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+    X509_gmtime_adj(X509_getm_notAfter(certificate), STUB_CERTIFICATE_DAYS * 24 * 3600L);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(certificate), "CN", MBSTRING_ASC,
+                               (const unsigned char *) "127.0.0.1", -1, -1, 0);
+    X509_set_issuer_name(certificate, X509_get_subject_name(certificate));
+    X509_set_pubkey(certificate, key);
+
+    altName = X509V3_EXT_conf_nid(NULL, NULL, NID_subject_alt_name, (char *) "IP:127.0.0.1");
+
+    if (!altName || !X509_add_ext(certificate, altName, -1) || !X509_sign(certificate, key, EVP_sha256()))
+        goto EXIT;
+
+    if ((fd = mkstemp(path)) < 0 || !(file = fdopen(fd, "w")))
+        goto EXIT;
+
+    fd = -1;
+    mCertificateFile = path;
+
+    if (!PEM_write_X509(file, certificate))
+        goto EXIT;
+
+    mTls = SSL_CTX_new(TLS_server_method());
+
+    created = mTls && SSL_CTX_use_certificate(mTls, certificate) == 1 && SSL_CTX_use_PrivateKey(mTls, key) == 1;
+
+    EXIT:
+    if (file)
+        fclose(file);
+
+    if (fd >= 0)
+        close(fd);
+
+    X509_EXTENSION_free(altName);
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(keyContext);
+
+    return created;
+}
+
+bool StubHttpServer::startTls(Handler handler) {
+    if (!mTls && !createTlsContext())
+        return false;
+
+    // SSL_write has no MSG_NOSIGNAL, a client gone mid answer must not end the test
+    signal(SIGPIPE, SIG_IGN);
+
+    return start(handler);
+}
+
+bool StubHttpServer::start(Handler handler) {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    int reuse = 1;
+
+    mHandler = handler;
+    mListenFd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (mListenFd < 0)
+        return false;
+
+    setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+
+    if (bind(mListenFd, (struct sockaddr *) &address, sizeof(address)) < 0 ||
+        listen(mListenFd, 128) < 0 ||
+        getsockname(mListenFd, (struct sockaddr *) &address, &length) < 0) {
+        close(mListenFd);
+        mListenFd = -1;
+        return false;
+    }
+
+    mPort = ntohs(address.sin_port);
+    mStopping = false;
+    mAcceptThread = std::thread(&StubHttpServer::acceptLoop, this);
+
+    return true;
+}
+
+void StubHttpServer::stop() {
+    if (mListenFd < 0)
+        return;
+
+    mStopping = true;
+    shutdown(mListenFd, SHUT_RDWR);
+
+    if (mAcceptThread.joinable())
+        mAcceptThread.join();
+
+    for (std::thread &connection : mConnections) {
+        if (connection.joinable())
+            connection.join();
+    }
+
+    mConnections.clear();
+    close(mListenFd);
+    mListenFd = -1;
+}
+
+std::string StubHttpServer::url(const std::string &path) const {
+    return std::string(mTls ? "https" : "http") + "://127.0.0.1:" + std::to_string(mPort) + path;
+}
+
+bool StubHttpServer::waitForAbandoned(unsigned int count, unsigned int timeoutMs) {
+    std::unique_lock<std::mutex> lock(mLock);
+
+    return mChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, count]() {
+        return mAbandoned >= count;
+    });
+}
+
+void StubHttpServer::acceptLoop() {
+    while (!mStopping) {
+        struct pollfd pfd = {mListenFd, POLLIN, 0};
+
+        if (poll(&pfd, 1, STUB_POLL_SLICE_MS) <= 0)
+            continue;
+
+        int fd = accept(mListenFd, NULL, NULL);
+
+        if (fd < 0)
+            continue;
+
+        mConnections.push_back(std::thread(&StubHttpServer::serve, this, fd));
+    }
+}
+
+ssize_t StubHttpServer::receive(int fd, SSL *ssl, char *buffer, size_t size) {
+    if (ssl)
+        return SSL_read(ssl, buffer, size);
+
+    return recv(fd, buffer, size, 0);
+}
+
+// headers and, when announced, the body of one request
+bool StubHttpServer::readRequest(int fd, SSL *ssl, std::string &requestLine) {
+    std::string data;
+    char buffer[4096];
+    size_t headerEnd = std::string::npos;
+    size_t contentLength = 0;
+
+    while (!mStopping && data.size() < STUB_REQUEST_MAX_BYTES) {
+        if (headerEnd != std::string::npos && data.size() >= headerEnd + 4 + contentLength)
+            break;
+
+        struct pollfd pfd = {fd, POLLIN, 0};
+
+        // TLS may hold a decrypted record the socket no longer shows
+        if ((!ssl || !SSL_pending(ssl)) && poll(&pfd, 1, STUB_POLL_SLICE_MS) <= 0)
+            continue;
+
+        ssize_t received = receive(fd, ssl, buffer, sizeof(buffer));
+
+        if (received <= 0)
+            return false;
+
+        data.append(buffer, received);
+
+        if (headerEnd == std::string::npos && (headerEnd = data.find("\r\n\r\n")) != std::string::npos) {
+            const char *length = strcasestr(data.c_str(), "\r\nContent-Length:");
+
+            if (length && length < data.c_str() + headerEnd)
+                contentLength = strtoul(length + strlen("\r\nContent-Length:"), NULL, 10);
+        }
+    }
+
+    if (headerEnd == std::string::npos)
+        return false;
+
+    requestLine = data.substr(0, data.find("\r\n"));
+    return true;
+}
+
+// false when the client went away before the delay was over
+bool StubHttpServer::waitDelay(int fd, SSL *ssl, unsigned int delayMs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs);
+    char buffer[256];
+
+    while (!mStopping && std::chrono::steady_clock::now() < deadline) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+
+        if (poll(&pfd, 1, STUB_POLL_SLICE_MS) <= 0)
+            continue;
+
+        if (ssl ? SSL_read(ssl, buffer, sizeof(buffer)) <= 0 : recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT) <= 0)
+            return false;
+    }
+
+    return !mStopping;
+}
+
+void StubHttpServer::serve(int fd) {
+    std::string requestLine;
+    StubHttpResponse response;
+    SSL *ssl = NULL;
+    unsigned int open = 0;
+    unsigned int seen = 0;
+
+    if (mTls) {
+        ssl = SSL_new(mTls);
+
+        if (!ssl || SSL_set_fd(ssl, fd) != 1 || SSL_accept(ssl) != 1) {
+            SSL_free(ssl);
+            close(fd);
+            return;
+        }
+    }
+
+    mAccepted++;
+
+    // a plain connection answers one request, a TLS one until the client closes it
+    while (readRequest(fd, ssl, requestLine)) {
+        mRequests++;
+        open = ++mOpen;
+
+        // lock free maximum, another connection may raise it meanwhile
+        while (open > (seen = mMaxConcurrent) && !mMaxConcurrent.compare_exchange_weak(seen, open))
+            ;
+
+        response = mHandler(requestLine);
+
+        if (!waitDelay(fd, ssl, response.delayMs)) {
+            mOpen--;
+
+            std::lock_guard<std::mutex> lock(mLock);
+            mAbandoned++;
+            mChanged.notify_all();
+            break;
+        }
+
+        std::string reply = "HTTP/1.1 " + std::to_string(response.status) + " Stub\r\n"
+                            "Content-Type: application/json\r\n"
+                            "Content-Length: " + std::to_string(response.body.size()) + "\r\n" +
+                            (ssl ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n") + response.body;
+
+        if (ssl)
+            SSL_write(ssl, reply.c_str(), reply.size());
+        else
+            send(fd, reply.c_str(), reply.size(), MSG_NOSIGNAL);
+
+        mOpen--;
+        mAnswered++;
+
+        if (!ssl)
+            break;
+    }
+
+    if (ssl) {
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+    }
+
+    close(fd);
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+#ifndef STUBHTTPSERVER_H_
+#define STUBHTTPSERVER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <openssl/ssl.h>
+
+typedef struct _StubHttpResponse {
+    int status;
+    std::string body;
+    unsigned int delayMs;   // before the response is written
+} StubHttpResponse;
+
+// HTTP/1.1 server on an ephemeral loopback port for the network tests. Every
+// connection is served on its own thread, one request per connection. A client
+// that closes its connection while the response is still delayed is counted as
+// abandoned, which is how a test sees that a cancelled transfer was torn down.
+// Started with startTls, it speaks HTTPS with a certificate of its own for
+// 127.0.0.1 and keeps each connection alive until the client closes it, so
+// connections() tells how many TLS handshakes the clients paid for.
+class StubHttpServer {
+public:
+    // request is the request line, e.g. "GET /geocode?address=1 HTTP/1.1"
+    typedef std::function<StubHttpResponse(const std::string &request)> Handler;
+
+    StubHttpServer();
+
+    ~StubHttpServer();
+
+    StubHttpServer(const StubHttpServer &) = delete;
+
+    StubHttpServer &operator=(const StubHttpServer &) = delete;
+
+    bool start(Handler handler);
+
+    bool startTls(Handler handler);
+
+    void stop();
+
+    std::string url(const std::string &path) const;
+
+    // PEM of the certificate startTls serves, for clients that verify it
+    const std::string &certificateFile() const { return mCertificateFile; }
+
+    unsigned int requests() const { return mRequests; }
+
+    // accepted connections, with TLS only those that completed the handshake
+    unsigned int connections() const { return mAccepted; }
+
+    unsigned int answered() const { return mAnswered; }
+
+    unsigned int abandoned() const { return mAbandoned; }
+
+    // the most requests that were open at the same time
+    unsigned int maxConcurrent() const { return mMaxConcurrent; }
+
+    bool waitForAbandoned(unsigned int count, unsigned int timeoutMs);
+
+private:
+    bool createTlsContext();
+
+    void acceptLoop();
+
+    void serve(int fd);
+
+    bool readRequest(int fd, SSL *ssl, std::string &requestLine);
+
+    bool waitDelay(int fd, SSL *ssl, unsigned int delayMs);
+
+    static ssize_t receive(int fd, SSL *ssl, char *buffer, size_t size);
+
+    int mListenFd;
+    unsigned short mPort;
+    Handler mHandler;
+    SSL_CTX *mTls;
+    std::string mCertificateFile;
+    std::atomic<bool> mStopping;
+    std::thread mAcceptThread;
+    std::vector<std::thread> mConnections;
+    std::mutex mLock;
+    std::condition_variable mChanged;
+    std::atomic<unsigned int> mAccepted;
+    std::atomic<unsigned int> mRequests;
+    std::atomic<unsigned int> mAnswered;
+    std::atomic<unsigned int> mAbandoned;
+    std::atomic<unsigned int> mOpen;
+    std::atomic<unsigned int> mMaxConcurrent;
+};
+
+#endif /* STUBHTTPSERVER_H_ */
@@ -0,0 +1,187 @@
+// Copyright (c) 2024 LG Electronics, Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// SPDX-License-Identifier: Apache-2.0
+
+
+
+// Timing harness for the wifi scan diff in NetworkPositionProvider: a sequence of
+// 200 access point scans is run through the former GHashTable path (copy of the
+// incoming table with g_strdup'd bssids, lookup diff, copy into the posted table)
+// and through the packed sorted WifiScan path. Both must agree on every diff.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <glib.h>
+#include <WifiScan.h>
+
+#define BENCH_ACCESS_POINTS     200
+#define BENCH_SCANS             500
+#define BENCH_CHURN_PERCENT     15
+
+typedef struct {
+    unsigned int vanished;
+    int signalChangeSum;
+} ScanDiff;
+
+static GHashTable *newBssidTable() {
+    return g_hash_table_new_full(g_str_hash, g_str_equal, (GDestroyNotify) g_free, NULL);
+}
+
+static void copyTable(GHashTable *from, GHashTable *to) {
+    GHashTableIter iter;
+    gpointer key = NULL;
+    gpointer value = NULL;
+
+    g_hash_table_remove_all(to);
+    g_hash_table_iter_init(&iter, from);
+
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        g_hash_table_insert(to, g_strdup((const gchar *) key), value);
+}
+
+// what onUpdateWifiData and parseWifiData did per scan before the packed scans
+static ScanDiff legacyDiff(GHashTable *incoming, GHashTable *current, GHashTable *lastAps) {
+    GHashTableIter iter;
+    gpointer key = NULL;
+    gpointer newValue = NULL;
+    gpointer oldValue = NULL;
+    ScanDiff diff = {0, 0};
+
+    copyTable(incoming, current);
+
+    g_hash_table_iter_init(&iter, current);
+
+    while (g_hash_table_iter_next(&iter, &key, &newValue)) {
+        if ((oldValue = g_hash_table_lookup(lastAps, key)))
+            diff.signalChangeSum += abs(GPOINTER_TO_INT(newValue) - GPOINTER_TO_INT(oldValue));
+        else
+            diff.signalChangeSum += abs(GPOINTER_TO_INT(newValue));
+    }
+
+    g_hash_table_iter_init(&iter, lastAps);
+
+    while (g_hash_table_iter_next(&iter, &key, &oldValue)) {
+        if (!g_hash_table_lookup(current, key)) {
+            diff.signalChangeSum += abs(GPOINTER_TO_INT(oldValue));
+            diff.vanished++;
+        }
+    }
+
+    copyTable(current, lastAps);
+
+    return diff;
+}
+
+static ScanDiff packedDiff(GHashTable *incoming, WifiScan &current, WifiScan &lastAps) {
+    ScanDiff diff = {0, 0};
+
+    wifiScanFromTable(incoming, current);
+    diff.signalChangeSum = wifiScanSignalChange(current, lastAps, &diff.vanished);
+    lastAps = current;
+
+    return diff;
+}
+
+// an urban scan sequence: most access points stay with a few dB of jitter,
+// BENCH_CHURN_PERCENT of them are replaced by new ones on every scan
+static std::vector<GHashTable *> buildScans() {
+    std::vector<GHashTable *> scans;
+    std::vector<std::string> bssids;
+    std::vector<int> signals;
+    unsigned int nextBssid = 0;
+    char bssid[WIFI_BSSID_STR_LEN];
+
+    g_random_set_seed(31);
+
+    for (int i = 0; i < BENCH_ACCESS_POINTS; i++, nextBssid++) {
+        wifiBssidUnpack(0x001a2b000000ULL + nextBssid * 7919ULL, bssid, sizeof(bssid));
+        bssids.push_back(bssid);
+        signals.push_back(g_random_int_range(-95, -30));
+    }
+
+    for (int scan = 0; scan < BENCH_SCANS; scan++) {
+        GHashTable *table = newBssidTable();
+
+        for (int i = 0; i < BENCH_ACCESS_POINTS; i++) {
+            if (g_random_int_range(0, 100) < BENCH_CHURN_PERCENT) {
+                wifiBssidUnpack(0x001a2b000000ULL + nextBssid++ * 7919ULL, bssid, sizeof(bssid));
+                bssids[i] = bssid;
+                signals[i] = g_random_int_range(-95, -30);
+            } else {
+                signals[i] = CLAMP(signals[i] + g_random_int_range(-3, 4), -100, -20);
+            }
+
+            g_hash_table_insert(table, g_strdup(bssids[i].c_str()), GINT_TO_POINTER(signals[i]));
+        }
+
+        scans.push_back(table);
+    }
+
+    return scans;
+}
+
+int main() {
+    std::vector<GHashTable *> scans = buildScans();
+    GHashTable *legacyCurrent = newBssidTable();
+    GHashTable *legacyLast = newBssidTable();
+    WifiScan packedCurrent;
+    WifiScan packedLast;
+    std::vector<ScanDiff> legacyDiffs;
+    std::vector<ScanDiff> packedDiffs;
+    gint64 start;
+    gint64 legacyUs;
+    gint64 packedUs;
+    int mismatches = 0;
+
+    legacyDiffs.reserve(scans.size());
+    packedDiffs.reserve(scans.size());
+
+    start = g_get_monotonic_time();
+
+    for (GHashTable *scan : scans)
+        legacyDiffs.push_back(legacyDiff(scan, legacyCurrent, legacyLast));
+
+    legacyUs = g_get_monotonic_time() - start;
+    start = g_get_monotonic_time();
+
+    for (GHashTable *scan : scans)
+        packedDiffs.push_back(packedDiff(scan, packedCurrent, packedLast));
+
+    packedUs = g_get_monotonic_time() - start;
+
+    for (size_t i = 0; i < scans.size(); i++) {
+        if (legacyDiffs[i].signalChangeSum != packedDiffs[i].signalChangeSum ||
+            legacyDiffs[i].vanished != packedDiffs[i].vanished) {
+            fprintf(stderr, "scan %zu: legacy sum %d vanished %u, packed sum %d vanished %u\n", i,
+                    legacyDiffs[i].signalChangeSum, legacyDiffs[i].vanished,
+                    packedDiffs[i].signalChangeSum, packedDiffs[i].vanished);
+            mismatches++;
+        }
+    }
+
+    printf("%d scans of %d access points\n", BENCH_SCANS, BENCH_ACCESS_POINTS);
+    printf("hash table diff: %8.2f us/scan\n", (double) legacyUs / BENCH_SCANS);
+    printf("packed diff:     %8.2f us/scan\n", (double) packedUs / BENCH_SCANS);
+
+    for (GHashTable *scan : scans)
+        g_hash_table_unref(scan);
+
+    g_hash_table_unref(legacyCurrent);
+    g_hash_table_unref(legacyLast);
+
+    return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}